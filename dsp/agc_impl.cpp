@@ -7,6 +7,7 @@
 //	2010-09-15  Initial creation MSW
 //	2011-03-27  Initial release
 //      2011-09-24  Adapted for gqrx
+//      2012-12-10  Float implementation operating on gr_complex
 //////////////////////////////////////////////////////////////////////
 //==========================================================================================
 // + + +   This Software is released under the "Simplified BSD License"  + + +
@@ -37,8 +38,10 @@
 //or implied, of Moe Wheatley.
 //==========================================================================================
 
-#include <dsp/agc_impl.h>
 #include <math.h>
+#include <algorithm>
+#include <dsp/agc_impl.h>
+#include <dsp/fast_math.h>
 
 //////////////////////////////////////////////////////////////////////
 // Local Defines
@@ -66,13 +69,15 @@
 #define AGC_OUTSCALE 0.7
 
 // keep max in and out the same
-#define MAX_AMPLITUDE 1.0 //32767.0
 #define MAX_MANUAL_AMPLITUDE 1.0 //32767.0
 
 #define MIN_CONSTANT 3.2767e-4	// const for calc log() so that a value of 0 magnitude == -8
 //corresponding to -160dB.
 //K = 10^( -8 + log(32767) )
 
+#define LOG10_2 0.30102999566f	// log10(x) = log2(x) * LOG10_2
+#define LOG2_10 3.32192809489f	// 10^x = 2^(x * LOG2_10)
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -85,7 +90,10 @@ CAgc::CAgc()
     m_ManualGain = 0;
     m_SlopeFactor = 0;
     m_Decay = 0;
-    m_SampleRate = 100.0;
+    m_SampleRate = 0.0;
+    m_DelaySamples = 1;
+    m_WindowSamples = 1;
+    ResetState();
 }
 
 CAgc::~CAgc()
@@ -111,7 +119,6 @@ void CAgc::SetParameters(bool AgcOn,  bool UseHang, int Threshold, int ManualGai
     {
         return;		//just return if no parameter changed
     }
-    //m_Mutex.lock();
     m_AgcOn = AgcOn;
     m_UseHang = UseHang;
     m_Threshold = Threshold;
@@ -119,31 +126,22 @@ void CAgc::SetParameters(bool AgcOn,  bool UseHang, int Threshold, int ManualGai
     m_SlopeFactor = SlopeFactor;
     m_Decay = Decay;
     if (m_SampleRate != SampleRate)
-    {	//clear out delay buffer and init some things if sample rate changes
+    {	//resize delay and peak buffers and init some things if sample rate changes
         m_SampleRate = SampleRate;
-        for (int i=0; i<MAX_DELAY_BUF; i++)
-        {
-            m_SigDelayBuf[i].re = 0.0;
-            m_SigDelayBuf[i].im = 0.0;
-            m_MagBuf[i] = -16.0;
-        }
-        m_SigDelayPtr = 0;
-        m_HangTimer = 0;
-        m_Peak = -16.0;
-        m_DecayAve = -5.0;
-        m_AttackAve = -5.0;
-        m_MagBufPos = 0;
+        m_DelaySamples = std::max(1, (int)(m_SampleRate*DELAY_TIMECONST));
+        m_WindowSamples = std::max(1, (int)(m_SampleRate*WINDOW_TIMECONST));
+        ResetState();
     }
 
     //convert m_ThreshGain to linear manual gain value
-    //m_ManualAgcGain = MAX_MANUAL_AMPLITUDE*pow(10.0, -(100-(double)m_ManualGain)/20.0);
     m_ManualAgcGain = MAX_MANUAL_AMPLITUDE * pow(10.0, (double)m_ManualGain / 20.0);
 
-    //calculate parameters for AGC gain as a function of input magnitude
+    //calculate parameters for AGC gain as a function of input magnitude.
+    //gain = AGC_OUTSCALE * 10^(max(mag, knee) * (slope - 1)) where mag and knee
+    //are log10 magnitudes; evaluated as a power of 2 in ProcessData()
     m_Knee = (double)m_Threshold/20.0;
-    m_GainSlope = m_SlopeFactor/(100.0);
-    m_FixedGain = AGC_OUTSCALE * pow(10.0, m_Knee*(m_GainSlope - 1.0) );	//fixed gain value used below knee threshold
-    //qDebug()<<"m_Knee = "<<m_Knee<<" m_GainSlope = "<<m_GainSlope<< "m_FixedGain = "<<m_FixedGain;
+    m_GainExp = ((double)m_SlopeFactor/100.0 - 1.0) * LOG2_10;
+    m_GainOffset = log(AGC_OUTSCALE) / log(2.0);
 
     //calculate fast and slow filter values.
     m_AttackRiseAlpha = (1.0-exp(-1.0/(m_SampleRate*ATTACK_RISE_TIMECONST)) );
@@ -156,259 +154,211 @@ void CAgc::SetParameters(bool AgcOn,  bool UseHang, int Threshold, int ManualGai
         m_DecayFallAlpha = (1.0-exp(-1.0/(m_SampleRate * RELEASE_TIMECONST)) );
     else
         m_DecayFallAlpha = (1.0-exp(-1.0/(m_SampleRate * (double)m_Decay *.001)) );
+}
 
-    m_DelaySamples = (int)(m_SampleRate*DELAY_TIMECONST);
-    m_WindowSamples = (int)(m_SampleRate*WINDOW_TIMECONST);
+//////////////////////////////////////////////////////////////////////
+// Clear delay line, peak detector and averagers
+//////////////////////////////////////////////////////////////////////
+void CAgc::ResetState()
+{
+    m_SigDelayBuf.assign(m_DelaySamples, gr_complex(0.0f, 0.0f));
+    m_SigDelayNew.assign(m_DelaySamples, gr_complex(0.0f, 0.0f));
+    m_PeakVal.assign(m_WindowSamples, 0.0f);
+    m_PeakPos.assign(m_WindowSamples, 0);
+    m_PeakHead = 0;
+    m_PeakCount = 0;
+    m_SamplePos = 0;
+    m_HangTimer = 0;
+    m_DecayAve = -5.0;
+    m_AttackAve = -5.0;
+}
 
-    //clamp Delay samples within buffer limit
-    if(m_DelaySamples >= MAX_DELAY_BUF-1)
-        m_DelaySamples = MAX_DELAY_BUF-1;
+//////////////////////////////////////////////////////////////////////
+// Automatic Gain Control calculator for COMPLEX data
+//
+// The block is processed in three passes:
+//  1. log10 magnitude of each input sample (vectorizable)
+//  2. sliding window peak detector and attack/decay averagers
+//  3. gain from the averaged level (vectorizable) applied to the
+//     delayed input signal
+// pInData and pOutData may point to the same buffer.
+//////////////////////////////////////////////////////////////////////
+void CAgc::ProcessData(int Length, const gr_complex* pInData, gr_complex* pOutData)
+{
+    int i;
 
-    //m_Mutex.unlock();
-}
+    if (!m_AgcOn)
+    {	//manual gain just multiply by m_ManualGain
+        const float *in = (const float *) pInData;
+        float *out = (float *) pOutData;
 
+        for (i=0; i<2*Length; i++)
+            out[i] = m_ManualAgcGain * in[i];
+        return;
+    }
 
+    if ((int)m_Level.size() < Length)
+        m_Level.resize(Length);
+    float *level = &m_Level[0];
+
+    //pass 1: |mag| to log |mag|, 0==max  -8 is min==-160dB
+    const float *iq = (const float *) pInData;
+    for (i=0; i<Length; i++)
+    {
+        float mre = fabsf(iq[2*i]);
+        float mim = fabsf(iq[2*i+1]);
+        float mag = (mim > mre ? mim : mre) + (float)MIN_CONSTANT;
+        level[i] = fast_log2f(mag) * LOG10_2;
+    }
+
+    //pass 2: peak detector and averagers
+    CalcLevel(Length, level);
+
+    //pass 3: gain depending on which side of knee the magnitude is on
+    const float knee = m_Knee;
+    const float gain_offset = m_GainOffset;
+    const float gain_exp = m_GainExp;
+    for (i=0; i<Length; i++)
+    {
+        float mag = level[i] > knee ? level[i] : knee;
+        level[i] = fast_exp2f(gain_offset + mag * gain_exp);
+    }
+
+    ApplyGain(Length, pInData, pOutData, level);
+}
 
 //////////////////////////////////////////////////////////////////////
-// Automatic Gain Control calculator for COMPLEX data
+// Convert log magnitudes to AGC level in place
+//
+// The peak within the sliding window of 'm_WindowSamples' magnitudes is
+// tracked with a monotonic deque: the values are decreasing from head
+// to tail, so the head is always the peak. Each sample is pushed and
+// popped at most once regardless of the window length.
 //////////////////////////////////////////////////////////////////////
-void CAgc::ProcessData(int Length, TYPECPX* pInData, TYPECPX* pOutData)
+void CAgc::CalcLevel(int Length, float* pLevel)
 {
-    double gain;
-    double mag;
-    TYPECPX delayedin;
-
-    //m_Mutex.lock();
-    if (m_AgcOn)
+    const int window = m_WindowSamples;
+    float *pkval = &m_PeakVal[0];
+    unsigned int *pkpos = &m_PeakPos[0];
+    int head = m_PeakHead;
+    int count = m_PeakCount;
+    unsigned int pos = m_SamplePos;
+    double peak;
+    int tail;
+
+    for (int i=0; i<Length; i++, pos++)
     {
-        for (int i=0; i<Length; i++)
+        float mag = pLevel[i];
+
+        //drop oldest peak if it left the window
+        if ((count > 0) && (pos - pkpos[head] >= (unsigned int)window))
         {
-            TYPECPX in = pInData[i];	//get latest input sample
-            //Get delayed sample of input signal
-            delayedin = m_SigDelayBuf[m_SigDelayPtr];
-            //put new input sample into signal delay buffer
-            m_SigDelayBuf[m_SigDelayPtr++] = in;
-            if( m_SigDelayPtr >= m_DelaySamples)	//deal with delay buffer wrap around
-                m_SigDelayPtr = 0;
-
-            //TYPEREAL dmag = 0.5* log10(  (dsig.re*dsig.re+dsig.im*dsig.im)/(MAX_AMPLITUDE*MAX_AMPLITUDE) + 1e-16);	//clamped to -160dBfs
-            //pOutData[i].re = 3000*dmag;
-#if 1
-            mag = fabs(in.re);
-            double mim = fabs(in.im);
-            if (mim>mag)
-                mag = mim;
-            mag = log10( mag + MIN_CONSTANT ) - log10(MAX_AMPLITUDE); //0==max  -8 is min==-160dB
-#else
-            mag = in.re*in.re+in.im*in.im;
-            //mag is power so 0.5 factor takes square root of power
-            mag = 0.5* log10( mag/(MAX_AMPLITUDE*MAX_AMPLITUDE) + 1e-16); //clamped to -160dBfs
-#endif
-            //pOutData[i].re = 3000*mag;
-
-            //pOutData[i].re = 1500*log10( ((delayedin.re*delayedin.re)+(delayedin.im*delayedin.im))/(MAX_AMPLITUDE*MAX_AMPLITUDE) + 1e-16);;
-
-            //create a sliding window of 'm_WindowSamples' magnitudes and output the peak value within the sliding window
-            double tmp = m_MagBuf[m_MagBufPos];  // get oldest mag sample from buffer into tmp
-            m_MagBuf[m_MagBufPos++] = mag;       // put latest mag sample in buffer;
-            if (m_MagBufPos >= m_WindowSamples)  // deal with magnitude buffer wrap around
-                m_MagBufPos = 0;
-            if (mag > m_Peak)
-            {
-                m_Peak = mag;	//if new sample is larger than current peak then use it, no need to look at buffer values
-            }
-            else
-            {
-                if (tmp == m_Peak)    //tmp is oldest sample pulled out of buffer
-                {                     //if oldest sample pulled out was last peak then need to find next highest peak in buffer
-                    m_Peak = -8.0;    //set to lowest value to find next max peak
-                    //search all buffer for maximum value and set as new peak
-                    for (int i=0; i<m_WindowSamples; i++)
-                    {
-                        tmp = m_MagBuf[i];
-                        if (tmp > m_Peak)
-                            m_Peak = tmp;
-                    }
-                }
-            }
+            if (++head == window)
+                head = 0;
+            count--;
+        }
 
-            //pOutData[i].im = 3000*m_Peak;
-
-            if (m_UseHang)
-            {	//using hang timer mode
-                if (m_Peak>m_AttackAve)	//if power is rising (use m_AttackRiseAlpha time constant)
-                    m_AttackAve = (1.0-m_AttackRiseAlpha)*m_AttackAve + m_AttackRiseAlpha*m_Peak;
-                else					//else magnitude is falling (use  m_AttackFallAlpha time constant)
-                    m_AttackAve = (1.0-m_AttackFallAlpha)*m_AttackAve + m_AttackFallAlpha*m_Peak;
-
-                if (m_Peak>m_DecayAve)	//if magnitude is rising (use m_DecayRiseAlpha time constant)
-                {
-                    m_DecayAve = (1.0-m_DecayRiseAlpha)*m_DecayAve + m_DecayRiseAlpha*m_Peak;
-                    m_HangTimer = 0;	//reset hang timer
-                }
-                else
-                {	//here if decreasing signal
-                    if (m_HangTimer<m_HangTime)
-                        m_HangTimer++;	//just inc and hold current m_DecayAve
-                    else	//else decay with m_DecayFallAlpha which is RELEASE_TIMECONST
-                        m_DecayAve = (1.0-m_DecayFallAlpha)*m_DecayAve + m_DecayFallAlpha*m_Peak;
-                }
+        //drop all candidates that can no longer be the peak
+        while (count > 0)
+        {
+            tail = head + count - 1;
+            if (tail >= window)
+                tail -= window;
+            if (pkval[tail] > mag)
+                break;
+            count--;
+        }
+
+        tail = head + count;
+        if (tail >= window)
+            tail -= window;
+        pkval[tail] = mag;
+        pkpos[tail] = pos;
+        count++;
+
+        peak = pkval[head];
+
+        // perform average of magnitude using 2 averagers each with separate rise and fall time constants
+        if (peak > m_AttackAve)	//if magnitude is rising (use m_AttackRiseAlpha time constant)
+            m_AttackAve = (1.0-m_AttackRiseAlpha)*m_AttackAve + m_AttackRiseAlpha*peak;
+        else					//else magnitude is falling (use  m_AttackFallAlpha time constant)
+            m_AttackAve = (1.0-m_AttackFallAlpha)*m_AttackAve + m_AttackFallAlpha*peak;
+
+        if (m_UseHang)
+        {	//using hang timer mode
+            if (peak > m_DecayAve)	//if magnitude is rising (use m_DecayRiseAlpha time constant)
+            {
+                m_DecayAve = (1.0-m_DecayRiseAlpha)*m_DecayAve + m_DecayRiseAlpha*peak;
+                m_HangTimer = 0;	//reset hang timer
             }
             else
-            {	//using exponential decay mode
-                // perform average of magnitude using 2 averagers each with separate rise and fall time constants
-                if (m_Peak>m_AttackAve)	//if magnitude is rising (use m_AttackRiseAlpha time constant)
-                    m_AttackAve = (1.0-m_AttackRiseAlpha)*m_AttackAve + m_AttackRiseAlpha*m_Peak;
-                else					//else magnitude is falling (use  m_AttackFallAlpha time constant)
-                    m_AttackAve = (1.0-m_AttackFallAlpha)*m_AttackAve + m_AttackFallAlpha*m_Peak;
-
-                //pOutData[i].im = 3000*m_AttackAve;
-                if (m_Peak>m_DecayAve)	//if magnitude is rising (use m_DecayRiseAlpha time constant)
-                    m_DecayAve = (1.0-m_DecayRiseAlpha)*m_DecayAve + m_DecayRiseAlpha*(m_Peak);
-                else					//else magnitude is falling (use m_DecayFallAlpha time constant)
-                    m_DecayAve = (1.0-m_DecayFallAlpha)*m_DecayAve + m_DecayFallAlpha*(m_Peak);
-                //pOutData[i].im = 3000*m_DecayAve;
+            {	//here if decreasing signal
+                if (m_HangTimer<m_HangTime)
+                    m_HangTimer++;	//just inc and hold current m_DecayAve
+                else	//else decay with m_DecayFallAlpha which is RELEASE_TIMECONST
+                    m_DecayAve = (1.0-m_DecayFallAlpha)*m_DecayAve + m_DecayFallAlpha*peak;
             }
-            //use greater magnitude of attack or Decay Averager
-            if (m_AttackAve>m_DecayAve)
-                mag = m_AttackAve;
-            else
-                mag = m_DecayAve;
-
-            //pOutData[i].im = 3000*mag;
-            //calc gain depending on which side of knee the magnitude is on
-            if (mag<=m_Knee)		//use fixed gain if below knee
-                gain = m_FixedGain;
-            else				//use variable gain if above knee
-                gain = AGC_OUTSCALE * pow(10.0, mag*(m_GainSlope - 1.0) );
-            //pOutData[i].re = .5*gain;
-            pOutData[i].re = delayedin.re * gain;
-            pOutData[i].im = delayedin.im * gain;
         }
-    }
-    else
-    {	//manual gain just multiply by m_ManualGain
-        for (int i=0; i<Length; i++)
-        {
-            pOutData[i].re = m_ManualAgcGain * pInData[i].re;
-            pOutData[i].im = m_ManualAgcGain * pInData[i].im;
+        else
+        {	//using exponential decay mode
+            if (peak > m_DecayAve)	//if magnitude is rising (use m_DecayRiseAlpha time constant)
+                m_DecayAve = (1.0-m_DecayRiseAlpha)*m_DecayAve + m_DecayRiseAlpha*peak;
+            else					//else magnitude is falling (use m_DecayFallAlpha time constant)
+                m_DecayAve = (1.0-m_DecayFallAlpha)*m_DecayAve + m_DecayFallAlpha*peak;
         }
+
+        //use greater magnitude of attack or Decay Averager
+        pLevel[i] = (float)((m_AttackAve > m_DecayAve) ? m_AttackAve : m_DecayAve);
     }
-    //m_Mutex.unlock();
+
+    m_PeakHead = head;
+    m_PeakCount = count;
+    m_SamplePos = pos;
 }
 
 //////////////////////////////////////////////////////////////////////
-// Automatic Gain Control calculator for REAL data
+// Multiply the input delayed by 'm_DelaySamples' with the gain
 //////////////////////////////////////////////////////////////////////
-void CAgc::ProcessData(int Length, double* pInData, double* pOutData)
+void CAgc::ApplyGain(int Length, const gr_complex* pInData, gr_complex* pOutData, const float* pGain)
 {
-    double gain;
-    double mag;
-    double delayedin;
+    const int delay = m_DelaySamples;
+    const float *in = (const float *) pInData;
+    const float *hist = (const float *) &m_SigDelayBuf[0];
+    float *out = (float *) pOutData;
+    int i;
 
-    //m_Mutex.lock();
-    if (m_AgcOn)
+    if (Length >= delay)
     {
-        for (int i=0; i<Length; i++)
-        {
-            double in = pInData[i]; //get latest input sample
-
-            //Get delayed sample of input signal
-            delayedin = m_SigDelayBuf[m_SigDelayPtr].re;
-            //put new input sample into signal delay buffer
-            m_SigDelayBuf[m_SigDelayPtr++].re = in;
-            if (m_SigDelayPtr >= m_DelaySamples) //deal with delay buffer wrap around
-                m_SigDelayPtr = 0;
-
-            //convert |mag| to log |mag|
-            mag = log10( fabs(in) + MIN_CONSTANT ) - log10(MAX_AMPLITUDE); //0==max  -8 is min==-160dB
-
-            //create a sliding window of 'm_WindowSamples' magnitudes and output the peak value within the sliding window
-            double tmp = m_MagBuf[m_MagBufPos];  // get oldest mag sample from buffer into tmp
-            m_MagBuf[m_MagBufPos++] = mag;       // put latest mag sample in buffer;
-            if (m_MagBufPos >= m_WindowSamples)  // deal with magnitude buffer wrap around
-                m_MagBufPos = 0;
-            if (mag > m_Peak)
-            {
-                m_Peak = mag;  // if new sample is larger than current peak then use it, no need to look at buffer values
-            }
-            else
-            {
-                if (tmp == m_Peak)   // tmp is oldest sample pulled out of buffer
-                {                    // if oldest sample pulled out was last peak then need to find next highest peak in buffer
-                    m_Peak = -8.0;   // set to lowest value to find next max peak
-                    // search all buffer for maximum value and set as new peak
-                    for (int i=0; i<m_WindowSamples; i++)
-                    {
-                        tmp = m_MagBuf[i];
-                        if (tmp > m_Peak)
-                            m_Peak = tmp;
-                    }
-                }
-            }
+        //the newest input samples become the delay line for the next call
+        std::copy(pInData + Length - delay, pInData + Length, m_SigDelayNew.begin());
 
-            if (m_UseHang)
-            {	//using hang timer mode
-                if (m_Peak>m_AttackAve)
-                    // if magnitude is rising (use m_AttackRiseAlpha time constant)
-                    m_AttackAve = (1.0-m_AttackRiseAlpha)*m_AttackAve + m_AttackRiseAlpha*m_Peak;
-                else
-                    // else magnitude is falling (use  m_AttackFallAlpha time constant)
-                    m_AttackAve = (1.0-m_AttackFallAlpha)*m_AttackAve + m_AttackFallAlpha*m_Peak;
-
-                if (m_Peak>m_DecayAve)
-                {
-                    // if magnitude is rising (use m_DecayRiseAlpha time constant)
-                    m_DecayAve = (1.0-m_DecayRiseAlpha)*m_DecayAve + m_DecayRiseAlpha*m_Peak;
-                    m_HangTimer = 0; // reset hang timer
-                }
-                else
-                { // here if decreasing signal
-                    if (m_HangTimer<m_HangTime)
-                        m_HangTimer++; // just inc and hold current m_DecayAve
-                    else
-                        // else decay with m_DecayFallAlpha which is RELEASE_TIMECONST
-                        m_DecayAve = (1.0-m_DecayFallAlpha)*m_DecayAve + m_DecayFallAlpha*m_Peak;
-                }
-            }
-            else
-            {	// using exponential decay mode
-                // perform average of magnitude using 2 averagers each with separate rise and fall time constants
-                if (m_Peak>m_AttackAve)
-                    // if magnitude is rising (use m_AttackRiseAlpha time constant)
-                    m_AttackAve = (1.0-m_AttackRiseAlpha)*m_AttackAve + m_AttackRiseAlpha*m_Peak;
-                else
-                    // else magnitude is falling (use  m_AttackFallAlpha time constant)
-                    m_AttackAve = (1.0-m_AttackFallAlpha)*m_AttackAve + m_AttackFallAlpha*m_Peak;
-
-                if (m_Peak>m_DecayAve)
-                    // if magnitude is rising (use m_DecayRiseAlpha time constant)
-                    m_DecayAve = (1.0-m_DecayRiseAlpha)*m_DecayAve + m_DecayRiseAlpha*(m_Peak);
-                else
-                    // else magnitude is falling (use m_DecayFallAlpha time constant)
-                    m_DecayAve = (1.0-m_DecayFallAlpha)*m_DecayAve + m_DecayFallAlpha*(m_Peak);
-            }
-
-            // use greater magnitude of attack or Decay Averager
-            if (m_AttackAve>m_DecayAve)
-                mag = m_AttackAve;
-            else
-                mag = m_DecayAve;
-
-            // calc gain depending on which side of knee the magnitude is on
-            if (mag <= m_Knee)
-                // use fixed gain if below knee
-                gain = m_FixedGain;
-            else
-                // use variable gain if above knee
-                gain = AGC_OUTSCALE * pow(10.0, mag*(m_GainSlope - 1.0) );
-            pOutData[i] = delayedin * gain;
+        //backwards so that the input is read before it is overwritten
+        for (i=Length-1; i>=delay; i--)
+        {
+            out[2*i] = in[2*(i-delay)] * pGain[i];
+            out[2*i+1] = in[2*(i-delay)+1] * pGain[i];
+        }
+        for (i=0; i<delay; i++)
+        {
+            out[2*i] = hist[2*i] * pGain[i];
+            out[2*i+1] = hist[2*i+1] * pGain[i];
         }
+
+        m_SigDelayBuf.swap(m_SigDelayNew);
     }
     else
-    {	// manual gain just multiply by m_ManualGain
-        for (int i=0; i<Length; i++)
-            pOutData[i] = m_ManualAgcGain * pInData[i];
+    {
+        std::copy(pInData, pInData + Length, m_SigDelayNew.begin());
+
+        for (i=0; i<Length; i++)
+        {
+            out[2*i] = hist[2*i] * pGain[i];
+            out[2*i+1] = hist[2*i+1] * pGain[i];
+        }
+
+        //shift delay line and append the new samples
+        std::copy(m_SigDelayBuf.begin() + Length, m_SigDelayBuf.end(), m_SigDelayBuf.begin());
+        std::copy(m_SigDelayNew.begin(), m_SigDelayNew.begin() + Length,
+                  m_SigDelayBuf.end() - Length);
     }
-    //m_Mutex.unlock();
 }
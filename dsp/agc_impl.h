@@ -7,22 +7,13 @@
 //	2010-09-15  Initial creation MSW
 //	2011-03-27  Initial release
 //      2011-09-24  Adapted for gqrx
+//      2012-12-10  Float implementation operating on gr_complex
 //////////////////////////////////////////////////////////////////////
 #ifndef AGC_IMPL_H
 #define AGC_IMPL_H
 
-//#include "dsp/datatypes.h"
-//#include <QMutex>
-
-#define MAX_DELAY_BUF 2048
-
-typedef struct _dCplx
-{
-    double re;
-    double im;
-} tDComplex;
-
-#define TYPECPX tDComplex
+#include <vector>
+#include <gr_complex.h>
 
 
 class CAgc
@@ -31,21 +22,26 @@ public:
     CAgc();
     virtual ~CAgc();
     void SetParameters(bool AgcOn, bool UseHang, int Threshold, int ManualGain, int Slope, int Decay, double SampleRate);
-    void ProcessData(int Length, TYPECPX* pInData, TYPECPX* pOutData);
-    void ProcessData(int Length, double* pInData, double* pOutData);
+    void ProcessData(int Length, const gr_complex* pInData, gr_complex* pOutData);
+    void ResetState();
+    int DelaySamples() const { return m_DelaySamples; }
 
 private:
+    void CalcLevel(int Length, float* pLevel);
+    void ApplyGain(int Length, const gr_complex* pInData, gr_complex* pOutData, const float* pGain);
+
     bool m_AgcOn;				//internal copy of AGC settings parameters
     bool m_UseHang;
     int m_Threshold;
     int m_ManualGain;
-    int m_Slope;
+    int m_SlopeFactor;
     int m_Decay;
     double m_SampleRate;
 
-    double m_SlopeFactor;
-    double m_ManualAgcGain;
+    float m_ManualAgcGain;
 
+    //the averagers are kept in double so that hang timing matches the
+    //original implementation (they only run in the scalar pass)
     double m_DecayAve;
     double m_AttackAve;
 
@@ -54,22 +50,26 @@ private:
     double m_DecayRiseAlpha;
     double m_DecayFallAlpha;
 
-    double m_FixedGain;
-    double m_Knee;
-    double m_GainSlope;
-    double m_Peak;
+    float m_Knee;
+    float m_GainExp;			//log2 gain per log10 magnitude above the knee
+    float m_GainOffset;			//log2 of AGC_OUTSCALE
 
-    int m_SigDelayPtr;
-    int m_MagBufPos;
-    int m_DelaySize;
     int m_DelaySamples;
     int m_WindowSamples;
     int m_HangTime;
     int m_HangTimer;
 
-    //QMutex m_Mutex;		//for keeping threads from stomping on each other
-    TYPECPX m_SigDelayBuf[MAX_DELAY_BUF];
-    double m_MagBuf[MAX_DELAY_BUF];
+    std::vector<gr_complex> m_SigDelayBuf;	//last m_DelaySamples input samples, oldest first
+    std::vector<gr_complex> m_SigDelayNew;	//scratch buffer for the next delay line
+    std::vector<float> m_Level;			//per sample magnitude, level and gain
+
+    //monotonic deque holding the candidates for the peak within the window
+    //stored as a ring buffer of m_WindowSamples entries
+    std::vector<float> m_PeakVal;
+    std::vector<unsigned int> m_PeakPos;
+    int m_PeakHead;
+    int m_PeakCount;
+    unsigned int m_SamplePos;
 };
 
 #endif //  AGC_IMPL_H
@@ -20,78 +20,292 @@
 #include <math.h>
 #include <gr_io_signature.h>
 #include <gr_complex.h>
-#include <iostream>
 #include "dsp/correct_iq_cc.h"
 
 
-dc_corr_cc_sptr make_dc_corr_cc(float alpha)
+#define DC_TIMECONST  0.2   /* DC averaging time constant in seconds. */
+#define IQ_TIMECONST  1.0   /* I/Q statistics time constant in seconds. */
+#define MAX_SIN_PHI   0.5   /* Largest phase error we try to correct (30 deg). */
+
+/* Number of independent accumulators in the work loop. */
+#define LANES 4
+
+
+correct_iq_cc_sptr make_correct_iq_cc(double sample_rate)
 {
-    return gnuradio::get_initial_sptr(new dc_corr_cc(alpha));
+    return gnuradio::get_initial_sptr(new correct_iq_cc(sample_rate));
 }
 
 
-/*! \brief Create DC correction object object.
+/*! \brief Create I/Q correction object.
  *
- * Use make_dc_corr_cc() instead.
+ * Use make_correct_iq_cc() instead.
  */
-dc_corr_cc::dc_corr_cc(float alpha)
-    : gr_sync_block ("dc_corr_cc",
+correct_iq_cc::correct_iq_cc(double sample_rate)
+    : gr_sync_block ("correct_iq_cc",
           gr_make_io_signature(1, 1, sizeof(gr_complex)),
           gr_make_io_signature(1, 1, sizeof(gr_complex))),
-      d_alpha(alpha),
-      d_avg_i(0.0),
-      d_avg_q(0.0),
-      d_cnt(0)
+      d_params_seen(0),
+      d_dci(0.0),
+      d_dcq(0.0),
+      d_gain(1.0),
+      d_phase(0.0),
+      d_ii(0.0),
+      d_qq(0.0),
+      d_iq(0.0)
 {
+    d_set.sample_rate = sample_rate;
+    d_set.dc_auto = true;
+    d_set.iq_auto = true;
+    d_set.dc_set = 0;
+    d_set.dci = 0.0;
+    d_set.dcq = 0.0;
+    d_set.iq_set = 0;
+    d_set.gain = 1.0;
+    d_set.phase = 0.0;
+    d_params.write(d_set);
+    d_cur = d_set;
 
+    update_coeffs();
+    publish_state();
 }
 
-dc_corr_cc::~dc_corr_cc()
+correct_iq_cc::~correct_iq_cc()
 {
 
 }
 
 
-/*! \brief DC correction block work method.
+/*! \brief I/Q correction block work method.
  *  \param moutput_items
  *  \param input_items
  *  \param output_items
+ *
+ * The samples are processed in groups of LANES with separate accumulators
+ * for each lane so that the loop has no dependency between consecutive
+ * samples and can be vectorized.
  */
-int dc_corr_cc::work(int noutput_items,
-                     gr_vector_const_void_star &input_items,
-                     gr_vector_void_star &output_items)
+int correct_iq_cc::work(int noutput_items,
+                        gr_vector_const_void_star &input_items,
+                        gr_vector_void_star &output_items)
 {
-    const gr_complex *in = (const gr_complex *) input_items[0];
-    gr_complex *out = (gr_complex *) output_items[0];
-    int i;
+    const float *in = (const float *) input_items[0];
+    float *out = (float *) output_items[0];
+    float dci, dcq, k1, k2;
+    float xi, xq;
+    float s_i[LANES] = {0}, s_q[LANES] = {0};
+    float s_ii[LANES] = {0}, s_qq[LANES] = {0}, s_iq[LANES] = {0};
+    float m_i, m_q, m_ii, m_qq, m_iq;
+    int   i, k;
+
+    /* pick up new parameters and manual settings, if any */
+    correct_iq_params p;
+    if (d_params.read(p, d_params_seen))
+    {
+        if (p.dc_set != d_cur.dc_set)
+        {
+            d_dci = p.dci;
+            d_dcq = p.dcq;
+        }
+        if (p.iq_set != d_cur.iq_set)
+        {
+            d_gain = p.gain;
+            d_phase = p.phase;
+            update_coeffs();
+        }
+        d_cur = p;
+    }
+
+    dci = d_dci;
+    dcq = d_dcq;
+    k1 = d_k1;
+    k2 = d_k2;
+
+    for (i = 0; i < noutput_items; i += LANES)
+    {
+        /* the last group may be incomplete */
+        int lanes = (noutput_items - i < LANES) ? noutput_items - i : LANES;
+
+        for (k = 0; k < lanes; k++)
+        {
+            xi = in[2*(i+k)] - dci;
+            xq = in[2*(i+k)+1] - dcq;
 
-    float sum_i = 0.0;
-    float sum_q = 0.0;
+            out[2*(i+k)] = xi;
+            out[2*(i+k)+1] = k1 * xq + k2 * xi;
 
+            s_i[k] += xi;
+            s_q[k] += xq;
+            s_ii[k] += xi * xi;
+            s_qq[k] += xq * xq;
+            s_iq[k] += xi * xq;
+        }
+    }
 
-    for (i = 0; i < noutput_items; i++)
+    for (k = 1; k < LANES; k++)
     {
-        sum_q += in[i].imag();
-        sum_i += in[i].real();
+        s_i[0] += s_i[k];
+        s_q[0] += s_q[k];
+        s_ii[0] += s_ii[k];
+        s_qq[0] += s_qq[k];
+        s_iq[0] += s_iq[k];
     }
 
-    d_avg_i = d_avg_i*(1.f-d_alpha) + d_alpha*(sum_i/noutput_items);
-    d_avg_q = d_avg_q*(1.f-d_alpha) + d_alpha*(sum_q/noutput_items);
+    /* block averages of the DC free input */
+    m_i = s_i[0] / noutput_items;
+    m_q = s_q[0] / noutput_items;
+    m_ii = s_ii[0] / noutput_items - m_i * m_i;
+    m_qq = s_qq[0] / noutput_items - m_q * m_q;
+    m_iq = s_iq[0] / noutput_items - m_i * m_q;
 
-#ifndef QT_NO_DEBUG_OUTPUT
-    if (d_cnt == 100)
+    /* update estimates */
+    if (d_cur.dc_auto)
     {
-        std::cout << "AVG I/Q: " << d_avg_i << "/" << d_avg_q << std::endl;
-        d_cnt = 0;
+        float alpha = 1.0 - exp(-noutput_items / (d_cur.sample_rate * DC_TIMECONST));
+        d_dci += alpha * m_i;
+        d_dcq += alpha * m_q;
     }
-    else
+
+    if (d_cur.iq_auto)
     {
-        d_cnt++;
+        float alpha = 1.0 - exp(-noutput_items / (d_cur.sample_rate * IQ_TIMECONST));
+        d_ii += alpha * (m_ii - d_ii);
+        d_qq += alpha * (m_qq - d_qq);
+        d_iq += alpha * (m_iq - d_iq);
+
+        if ((d_ii > 1.0e-12) && (d_qq > 1.0e-12))
+        {
+            float sin_phi = d_iq / sqrt(d_ii * d_qq);
+
+            if (sin_phi > MAX_SIN_PHI)
+                sin_phi = MAX_SIN_PHI;
+            else if (sin_phi < -MAX_SIN_PHI)
+                sin_phi = -MAX_SIN_PHI;
+
+            d_gain = sqrt(d_qq / d_ii);
+            d_phase = asin(sin_phi);
+            update_coeffs();
+        }
     }
-#endif
 
-    for (i = 0; i < noutput_items; i++)
-	out[i] = gr_complex(in[i].real() - d_avg_i, in[i].imag() - d_avg_q);
+    publish_state();
 
     return noutput_items;
 }
+
+
+/*! \brief Publish the current estimates to the getters. */
+void correct_iq_cc::publish_state()
+{
+    correct_iq_state state;
+
+    state.dci = d_dci;
+    state.dcq = d_dcq;
+    state.gain = d_gain;
+    state.phase = d_phase;
+
+    d_state.publish(state);
+}
+
+
+/*! \brief Set new sample rate.
+ *
+ * The sample rate is used to convert the time constants of the
+ * estimators to per block coefficients.
+ */
+void correct_iq_cc::set_sample_rate(double sample_rate)
+{
+    d_set.sample_rate = sample_rate;
+    d_params.write(d_set);
+}
+
+
+/*! \brief Enable or disable automatic DC offset estimation.
+ *
+ * When disabled the current estimate (or manual setting) is kept.
+ */
+void correct_iq_cc::set_dc_auto(bool dc_auto)
+{
+    d_set.dc_auto = dc_auto;
+    d_params.write(d_set);
+}
+
+
+/*! \brief Enable or disable automatic I/Q imbalance estimation.
+ *
+ * When disabled the current estimate (or manual setting) is kept.
+ */
+void correct_iq_cc::set_iq_auto(bool iq_auto)
+{
+    d_set.iq_auto = iq_auto;
+    d_params.write(d_set);
+}
+
+
+/*! \brief Set DC offset manually.
+ *  \param dci The DC offset of the I channel.
+ *  \param dcq The DC offset of the Q channel.
+ *
+ * This disables automatic DC estimation.
+ */
+void correct_iq_cc::set_dc_offset(float dci, float dcq)
+{
+    d_set.dc_auto = false;
+    d_set.dci = dci;
+    d_set.dcq = dcq;
+    d_set.dc_set++;
+    d_params.write(d_set);
+}
+
+
+/*! \brief Get current DC offset. */
+void correct_iq_cc::get_dc_offset(float &dci, float &dcq)
+{
+    correct_iq_state state = d_state.get();
+
+    dci = state.dci;
+    dcq = state.dcq;
+}
+
+
+/*! \brief Set I/Q imbalance manually.
+ *  \param gain The Q/I amplitude ratio (1.0 means balanced).
+ *  \param phase The phase error in radians.
+ *
+ * This disables automatic I/Q imbalance estimation.
+ */
+void correct_iq_cc::set_iq_imbalance(float gain, float phase)
+{
+    if ((gain <= 0.0) || (fabs(phase) > asin(MAX_SIN_PHI)))
+        return;
+
+    d_set.iq_auto = false;
+    d_set.gain = gain;
+    d_set.phase = phase;
+    d_set.iq_set++;
+    d_params.write(d_set);
+}
+
+
+/*! \brief Get current I/Q imbalance.
+ *  \param gain The Q/I amplitude ratio (output).
+ *  \param phase The phase error in radians (output).
+ */
+void correct_iq_cc::get_iq_imbalance(float &gain, float &phase)
+{
+    correct_iq_state state = d_state.get();
+
+    gain = state.gain;
+    phase = state.phase;
+}
+
+
+/*! \brief Calculate correction coefficients from gain and phase.
+ *
+ * Called by work() (and the constructor) only.
+ */
+void correct_iq_cc::update_coeffs()
+{
+    d_k1 = 1.0 / (d_gain * cos(d_phase));
+    d_k2 = -tan(d_phase);
+}
@@ -22,53 +22,128 @@
 
 #include <gr_sync_block.h>
 #include <gr_complex.h>
-#include <boost/thread/mutex.hpp>
+#include "dsp/lockfree.h"
 
-class dc_corr_cc;
+class correct_iq_cc;
 
-typedef boost::shared_ptr<dc_corr_cc> dc_corr_cc_sptr;
+typedef boost::shared_ptr<correct_iq_cc> correct_iq_cc_sptr;
 
 
-/*! \brief Return a shared_ptr to a new instance of dc_corr_cc.
- *  \param alpha The "speed" of averaging between 0.0 and 1.0
+/*! \brief Return a shared_ptr to a new instance of correct_iq_cc.
+ *  \param sample_rate The sample rate.
  *
- * This is effectively the public constructor for a new DC correction block.
- * To avoid accidental use of raw pointers, the dc_corr_cc constructor
+ * This is effectively the public constructor for a new I/Q correction block.
+ * To avoid accidental use of raw pointers, the correct_iq_cc constructor
  * is private.
- * make_dc_corr_cc is the public interface for creating new instances.
+ * make_correct_iq_cc is the public interface for creating new instances.
  */
-dc_corr_cc_sptr make_dc_corr_cc(float alpha=0.01);
+correct_iq_cc_sptr make_correct_iq_cc(double sample_rate);
 
 
-/*! \brief Long time average-based DC offset correction block.
+/*! \brief I/Q correction parameters passed from the setters to work(). */
+struct correct_iq_params
+{
+    double        sample_rate;
+    bool          dc_auto;
+    bool          iq_auto;
+    unsigned int  dc_set;   /*!< Incremented when the DC offset is set manually. */
+    float         dci;
+    float         dcq;
+    unsigned int  iq_set;   /*!< Incremented when the I/Q imbalance is set manually. */
+    float         gain;
+    float         phase;
+};
+
+
+/*! \brief Current I/Q correction published by work(). */
+struct correct_iq_state
+{
+    float dci;
+    float dcq;
+    float gain;
+    float phase;
+};
+
+
+/*! \brief DC offset and I/Q imbalance correction block.
  *  \ingroup DSP
  *
- * This block performs automatic gain control.
- * To be written...
+ * This block removes the DC offset and corrects the gain and phase imbalance
+ * between the I and Q channels in a single pass over the samples. The
+ * received signal is modelled as
+ *
+ *   I' = I + dci
+ *   Q' = g * (Q cos(phi) + I sin(phi)) + dcq
+ *
+ * and the corrected output is
+ *
+ *   out.re = I' - dci
+ *   out.im = (Q' - dcq) / (g cos(phi)) - (I' - dci) tan(phi)
  *
+ * The parameters are estimated blindly from the statistics of the DC free
+ * input signal, assuming that the received spectrum has no DC component and
+ * that I and Q have equal power and no correlation on average:
+ *
+ *   g = sqrt(E[Q^2] / E[I^2])
+ *   sin(phi) = E[IQ] / sqrt(E[I^2] E[Q^2])
+ *
+ * The statistics are accumulated in the same pass as the correction and the
+ * estimates are updated once per call to work(), so the correction lags the
+ * estimates by one block. Automatic estimation can be disabled separately for
+ * DC and I/Q imbalance, in which case the manually set values are used.
+ *
+ * The estimates are owned by work(). Setters publish a parameter snapshot
+ * that work() picks up at the beginning of the next call, and work()
+ * publishes the current estimates for the getters, so work() never waits
+ * for the GUI thread.
  */
-class dc_corr_cc : public gr_sync_block
+class correct_iq_cc : public gr_sync_block
 {
-    friend dc_corr_cc_sptr make_dc_corr_cc(float alpha);
+    friend correct_iq_cc_sptr make_correct_iq_cc(double sample_rate);
 
 protected:
-    dc_corr_cc(float alpha=0.01);
+    correct_iq_cc(double sample_rate);
 
 public:
-    ~dc_corr_cc();
+    ~correct_iq_cc();
 
     int work(int noutput_items,
              gr_vector_const_void_star &input_items,
              gr_vector_void_star &output_items);
 
+    void set_sample_rate(double sample_rate);
+
+    void set_dc_auto(bool dc_auto);
+    void set_iq_auto(bool iq_auto);
+
+    void set_dc_offset(float dci, float dcq);
+    void get_dc_offset(float &dci, float &dcq);
+
+    void set_iq_imbalance(float gain, float phase);
+    void get_iq_imbalance(float &gain, float &phase);
+
 private:
-    boost::mutex  d_mutex;
+    void update_coeffs();
+    void publish_state();
+
+private:
+    correct_iq_params               d_set;          /*! Parameters set by the setters. */
+    rx_seqlock<correct_iq_params>   d_params;       /*! Parameters published to work(). */
+    unsigned int                    d_params_seen;  /*! Last snapshot used by work(). */
+    correct_iq_params               d_cur;          /*! Parameters used by work(). */
+    rx_seqlock<correct_iq_state>    d_state;        /*! Estimates published by work(). */
+
+    float  d_dci;           /*! DC offset of the I channel. */
+    float  d_dcq;           /*! DC offset of the Q channel. */
+    float  d_gain;          /*! Q/I amplitude ratio (1.0 is balanced). */
+    float  d_phase;         /*! Phase error in radians. */
 
-    float d_alpha;
-    float d_avg_i;  /*! Long time average of the I channel. */
-    float d_avg_q;  /*! Long time average of the Q channel. */
+    float  d_k1;            /*! Correction coefficient for Q. */
+    float  d_k2;            /*! Correction coefficient for I leaking into Q. */
 
-    int d_cnt;
+    float  d_ii;            /*! Average E[I^2] of the DC free input. */
+    float  d_qq;            /*! Average E[Q^2] of the DC free input. */
+    float  d_iq;            /*! Average E[IQ] of the DC free input. */
 };
 
 
@@ -0,0 +1,131 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <math.h>
+#include <gr_complex.h>
+
+/*! \file fast_math.h
+ *  \brief Simple vector kernels used by the DSP blocks.
+ *
+ * The kernels are plain loops over contiguous float arrays without
+ * dependencies between iterations so that the compiler can vectorize
+ * them (-O3 or -ftree-vectorize, -fno-math-errno for sqrtf and
+ * -fno-trapping-math for the clamps in fast_exp2f).
+ * gr_complex arrays are accessed as interleaved float arrays.
+ */
+
+
+/*! \brief Calculate the magnitude of complex samples.
+ *  \param in The input samples.
+ *  \param out The output buffer (num floats).
+ *  \param num The number of samples.
+ */
+static inline void fm_mag(const gr_complex *in, float *out, int num)
+{
+    const float *iq = (const float *) in;
+
+    for (int i = 0; i < num; i++)
+        out[i] = sqrtf(iq[2*i] * iq[2*i] + iq[2*i+1] * iq[2*i+1]);
+}
+
+
+/*! \brief Fast base-2 logarithm.
+ *  \param x The argument, must be positive and normal.
+ *
+ * The exponent is taken directly from the IEEE-754 representation and
+ * log2 of the mantissa is approximated with a 5th order polynomial.
+ * The absolute error is less than 1.5e-5.
+ */
+static inline float fast_log2f(float x)
+{
+    union { float f; int i; } v;
+    float e, m;
+
+    v.f = x;
+    e = (float) (((v.i >> 23) & 0xff) - 127);
+    v.i = (v.i & 0x007fffff) | 0x3f800000;
+    m = v.f;
+
+    return e + (-2.7941524f + m * (5.0697517f + m * (-3.5202124f + m * (1.6101732f +
+                m * (-0.40947411f + m * 0.043928432f)))));
+}
+
+
+/*! \brief Fast base-2 exponential.
+ *  \param x The argument, clamped to +/- 126.
+ *
+ * 2^x is split into 2^int(x), which is written directly into the exponent
+ * of the result, and 2^frac(x), which is approximated with a 5th order
+ * polynomial. The relative error is less than 1.2e-7.
+ */
+static inline float fast_exp2f(float x)
+{
+    union { float f; int i; } v;
+    float f;
+    int n;
+
+    x = x < -126.0f ? -126.0f : x;
+    x = x > 126.0f ? 126.0f : x;
+
+    /* floor() without calling libm; x + 127 is always positive */
+    n = (int) (x + 127.0f) - 127;
+    f = x - (float) n;
+
+    v.f = 0.99999990f + f * (0.69315462f + f * (0.24014077f + f * (0.055863282f +
+          f * (0.0089462153f + f * 0.0018951070f))));
+    v.i += n * (1 << 23);
+
+    return v.f;
+}
+
+
+/*! \brief Fast four-quadrant arctangent.
+ *  \param y The imaginary part.
+ *  \param x The real part.
+ *
+ * atan(a) with a = min(|x|,|y|) / max(|x|,|y|) in [0, 1] is approximated
+ * with an 11th order odd minimax polynomial and mapped to the right octant
+ * using selects instead of branches, so loops calling it can be vectorized.
+ * The absolute error is less than 2e-6 rad; atan2(0, 0) returns 0.
+ */
+static inline float fast_atan2f(float y, float x)
+{
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float mx = ax > ay ? ax : ay;
+    float mn = ax > ay ? ay : ax;
+    float a, s, r;
+
+    a = mn / (mx + 1.0e-30f);
+    s = a * a;
+    r = a * (0.99997722f + s * (-0.33262283f + s * (0.19354038f + s * (-0.11642648f +
+        s * (0.052647352f + s * -0.011719136f)))));
+
+    r = ay > ax ? 1.5707964f - r : r;
+    r = x < 0.0f ? 3.1415927f - r : r;
+    r = y < 0.0f ? -r : r;
+
+    return r;
+}
+
+
+#endif /* FAST_MATH_H */
@@ -0,0 +1,189 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <map>
+#include <fftw3.h>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include "dsp/fft_cache.h"
+
+
+static boost::mutex                            cache_mutex;    /*! Protects the data below. */
+static std::multimap<int, gri_fft_complex *>   complex_cache;  /*! Unused complex FFTs by size. */
+static std::multimap<int, gri_fft_real_fwd *>  real_cache;     /*! Unused real FFTs by size. */
+static boost::thread                          *planner = 0;    /*! Background planning thread. */
+static volatile bool                           planner_stop = false;
+
+
+/*! \brief Get a forward complex FFT object.
+ *  \param size The FFT size.
+ *
+ * Creates a new one if none is cached. Give it back using release().
+ */
+gri_fft_complex *rx_fft_cache::get_complex(int size)
+{
+    {
+        boost::mutex::scoped_lock lock(cache_mutex);
+        std::multimap<int, gri_fft_complex *>::iterator it = complex_cache.find(size);
+
+        if (it != complex_cache.end()) {
+            gri_fft_complex *fft = it->second;
+            complex_cache.erase(it);
+            return fft;
+        }
+    }
+
+    /* not cached; plan a new one (gri_fft_complex takes the planner lock) */
+    return new gri_fft_complex(size, true);
+}
+
+/*! \brief Get a real forward FFT object.
+ *  \param size The FFT size.
+ *
+ * Creates a new one if none is cached. Give it back using release().
+ */
+gri_fft_real_fwd *rx_fft_cache::get_real(int size)
+{
+    {
+        boost::mutex::scoped_lock lock(cache_mutex);
+        std::multimap<int, gri_fft_real_fwd *>::iterator it = real_cache.find(size);
+
+        if (it != real_cache.end()) {
+            gri_fft_real_fwd *fft = it->second;
+            real_cache.erase(it);
+            return fft;
+        }
+    }
+
+    return new gri_fft_real_fwd(size);
+}
+
+/*! \brief Return a complex FFT object obtained from get_complex(). */
+void rx_fft_cache::release(gri_fft_complex *fft, int size)
+{
+    if (!fft)
+        return;
+
+    boost::mutex::scoped_lock lock(cache_mutex);
+    complex_cache.insert(std::make_pair(size, fft));
+}
+
+/*! \brief Return a real FFT object obtained from get_real(). */
+void rx_fft_cache::release(gri_fft_real_fwd *fft, int size)
+{
+    if (!fft)
+        return;
+
+    boost::mutex::scoped_lock lock(cache_mutex);
+    real_cache.insert(std::make_pair(size, fft));
+}
+
+/*! \brief Load FFTW wisdom from file.
+ *  \param filename The wisdom file.
+ *  \return true if the wisdom has been loaded.
+ *
+ * This should be called before the first FFT is created.
+ */
+bool rx_fft_cache::load_wisdom(const std::string &filename)
+{
+    /* the FFTW planner is not thread safe */
+    gri_fft_planner::scoped_lock lock(gri_fft_planner::mutex());
+
+    return fftwf_import_wisdom_from_filename(filename.c_str()) != 0;
+}
+
+/*! \brief Save FFTW wisdom to file.
+ *  \param filename The wisdom file.
+ *  \return true if the wisdom has been saved.
+ */
+bool rx_fft_cache::save_wisdom(const std::string &filename)
+{
+    gri_fft_planner::scoped_lock lock(gri_fft_planner::mutex());
+
+    return fftwf_export_wisdom_to_filename(filename.c_str()) != 0;
+}
+
+/*! \brief Plan FFT sizes in the background.
+ *  \param complex_sizes Sizes of complex FFTs to prepare.
+ *  \param real_sizes Sizes of real FFTs to prepare.
+ *  \param wisdom_file File to save the FFTW wisdom to when done.
+ *
+ * Creates one FFT object of each size that is not already in the cache
+ * in a background thread. Sizes requested with get_complex() or
+ * get_real() while the thread is running are planned by the caller; with
+ * the planner lock held by the thread this may take as long as planning
+ * one size.
+ */
+void rx_fft_cache::prepare(const std::vector<int> &complex_sizes,
+                           const std::vector<int> &real_sizes,
+                           const std::string &wisdom_file)
+{
+    stop();
+
+    planner_stop = false;
+    planner = new boost::thread(boost::bind(&rx_fft_cache::prepare_thread,
+                                            complex_sizes, real_sizes, wisdom_file));
+}
+
+/*! \brief Stop background planning.
+ *
+ * Waits until the size being planned is done. Must be called before the
+ * application exits.
+ */
+void rx_fft_cache::stop()
+{
+    if (!planner)
+        return;
+
+    planner_stop = true;
+    planner->join();
+    delete planner;
+    planner = 0;
+}
+
+/*! \brief Background planning thread. */
+void rx_fft_cache::prepare_thread(std::vector<int> complex_sizes,
+                                  std::vector<int> real_sizes,
+                                  std::string wisdom_file)
+{
+    unsigned int i;
+    bool cached;
+
+    for (i = 0; (i < complex_sizes.size()) && !planner_stop; i++) {
+        {
+            boost::mutex::scoped_lock lock(cache_mutex);
+            cached = (complex_cache.count(complex_sizes[i]) > 0);
+        }
+        if (!cached)
+            release(new gri_fft_complex(complex_sizes[i], true), complex_sizes[i]);
+    }
+
+    for (i = 0; (i < real_sizes.size()) && !planner_stop; i++) {
+        {
+            boost::mutex::scoped_lock lock(cache_mutex);
+            cached = (real_cache.count(real_sizes[i]) > 0);
+        }
+        if (!cached)
+            release(new gri_fft_real_fwd(real_sizes[i]), real_sizes[i]);
+    }
+
+    if (!wisdom_file.empty())
+        save_wisdom(wisdom_file);
+}
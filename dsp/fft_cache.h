@@ -0,0 +1,66 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef FFT_CACHE_H
+#define FFT_CACHE_H
+
+#include <string>
+#include <vector>
+#include <gri_fft.h>
+
+
+/*! \brief Cache of planned FFT objects.
+ *  \ingroup DSP
+ *
+ * Creating a gri_fft_complex or gri_fft_real_fwd creates an FFTW plan
+ * using FFTW_MEASURE, which takes a long time unless FFTW already has
+ * wisdom for the size. The FFT blocks therefore get their FFT objects
+ * from this cache and give them back when they are done, so that an FFT
+ * size that has been used once never has to be planned again.
+ *
+ * prepare() plans a list of sizes in a background thread at startup and
+ * saves the FFTW wisdom to a file, which is loaded by load_wisdom() on
+ * the next start so that planning is quick.
+ *
+ * All functions are thread safe.
+ */
+class rx_fft_cache
+{
+public:
+    static gri_fft_complex  *get_complex(int size);
+    static gri_fft_real_fwd *get_real(int size);
+    static void release(gri_fft_complex *fft, int size);
+    static void release(gri_fft_real_fwd *fft, int size);
+
+    static bool load_wisdom(const std::string &filename);
+    static bool save_wisdom(const std::string &filename);
+
+    static void prepare(const std::vector<int> &complex_sizes,
+                        const std::vector<int> &real_sizes,
+                        const std::string &wisdom_file);
+    static void stop();
+
+private:
+    static void prepare_thread(std::vector<int> complex_sizes,
+                               std::vector<int> real_sizes,
+                               std::string wisdom_file);
+};
+
+
+#endif /* FFT_CACHE_H */
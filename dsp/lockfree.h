@@ -0,0 +1,395 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef LOCKFREE_H
+#define LOCKFREE_H
+
+#include <string.h>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+/*! \file lockfree.h
+ *  \brief Primitives for exchanging data with work() without locking.
+ *
+ * The DSP blocks are configured from the GUI thread while work() runs in
+ * the streaming thread. Using a mutex for this means that work() may have
+ * to wait for a setter (or for the GUI reading data), which causes audio
+ * underruns when a slider is dragged. The classes below never let work()
+ * wait for another thread.
+ *
+ * They use the GCC __sync builtins for memory barriers since neither
+ * boost nor the language provide atomics in the versions we support.
+ */
+
+
+/*! \brief Sequence lock protecting a small parameter structure.
+ *  \ingroup DSP
+ *
+ * The writer increments the sequence number before and after updating
+ * the data, so the sequence number is odd while a write is in progress.
+ * A reader copies the data and checks that the sequence number has not
+ * changed during the copy.
+ *
+ * The typical use is a parameter snapshot: the setters called by the GUI
+ * use write() and work() calls read() at the beginning of each call.
+ * read() never waits; if a write is in progress or nothing has changed
+ * it returns false and work() continues with its previous copy. The
+ * other direction, e.g. estimates calculated in work(), uses publish()
+ * in work() and get() in the GUI thread.
+ *
+ * T must be copyable with assignment and should be small, since a copy
+ * is made for each read and each write.
+ */
+template <class T>
+class rx_seqlock
+{
+public:
+    rx_seqlock() : d_seq(0), d_data() {}
+    explicit rx_seqlock(const T &data) : d_seq(0), d_data(data) {}
+
+    /*! \brief Write new data.
+     *
+     * Writers are serialized using a mutex that readers never take, so
+     * this may be called from any thread except the one calling read().
+     */
+    void write(const T &data)
+    {
+        boost::mutex::scoped_lock lock(d_write_mutex);
+        publish(data);
+    }
+
+    /*! \brief Write new data from a single writer thread.
+     *
+     * Same as write() without the mutex. Only use this if there is one
+     * writer, e.g. work() publishing results.
+     */
+    void publish(const T &data)
+    {
+        d_seq++;
+        __sync_synchronize();
+        d_data = data;
+        __sync_synchronize();
+        d_seq++;
+    }
+
+    /*! \brief Read data if it has changed.
+     *  \param data The data (output). Only modified if true is returned.
+     *  \param seen The sequence number of the last successful read. This
+     *              should be initialized to 0 by the reader.
+     *  \return true if new data has been copied.
+     *
+     * This function never waits.
+     */
+    bool read(T &data, unsigned int &seen) const
+    {
+        unsigned int seq = d_seq;
+
+        if ((seq == seen) || (seq & 1))
+            return false;
+
+        __sync_synchronize();
+        T tmp = d_data;
+        __sync_synchronize();
+
+        if (d_seq != seq)
+            return false;
+
+        data = tmp;
+        seen = seq;
+
+        return true;
+    }
+
+    /*! \brief Get the current data.
+     *
+     * Waits until no write is in progress. Do not use this in work().
+     */
+    T get() const
+    {
+        unsigned int seen = 0;
+        T data;
+
+        while (!read(data, seen))
+            seen = 0;
+
+        return data;
+    }
+
+private:
+    boost::mutex           d_write_mutex;  /*! Serializes writers. */
+    volatile unsigned int  d_seq;          /*! Sequence number. */
+    T                      d_data;         /*! The protected data. */
+};
+
+
+/*! \brief Single producer single consumer ring buffer.
+ *  \ingroup DSP
+ *
+ * The producer (work()) always writes and never waits. When the consumer
+ * does not keep up the oldest samples are overwritten, like with
+ * boost::circular_buffer. Positions are absolute sample counters that
+ * wrap around, so the consumer keeps track of how far it has read and
+ * the number of new samples is head() - position.
+ *
+ * read() copies a range of samples and returns false if the producer has
+ * overwritten any of them in the meantime; the consumer should then try
+ * again with a newer range.
+ *
+ * The capacity is rounded up to a power of two. resize() is not thread
+ * safe and may only be called while the block is not running.
+ */
+template <class T>
+class rx_ring_buffer
+{
+public:
+    explicit rx_ring_buffer(unsigned int capacity = 0) : d_head(0), d_write_end(0)
+    {
+        resize(capacity);
+    }
+
+    /*! \brief Resize and clear the buffer. */
+    void resize(unsigned int capacity)
+    {
+        unsigned int size = 1;
+
+        while (size < capacity)
+            size <<= 1;
+
+        d_buf.assign(size, T());
+        d_mask = size - 1;
+        d_head = 0;
+        d_write_end = 0;
+    }
+
+    /*! \brief The capacity of the buffer. */
+    unsigned int capacity() const
+    {
+        return d_mask + 1;
+    }
+
+    /*! \brief Append new samples (producer only). */
+    void write(const T *data, unsigned int num)
+    {
+        unsigned int head = d_head;
+        unsigned int skip = 0;
+        unsigned int pos, first;
+
+        /* only the newest samples fit into the buffer */
+        if (num > capacity())
+            skip = num - capacity();
+
+        /* tell the consumer which positions are about to be overwritten */
+        d_write_end = head + num;
+        __sync_synchronize();
+
+        pos = (head + skip) & d_mask;
+        first = capacity() - pos;
+        if (first > num - skip)
+            first = num - skip;
+
+        memcpy(&d_buf[pos], data + skip, first * sizeof(T));
+        memcpy(&d_buf[0], data + skip + first, (num - skip - first) * sizeof(T));
+
+        __sync_synchronize();
+        d_head = head + num;
+    }
+
+    /*! \brief The position after the newest sample (consumer). */
+    unsigned int head() const
+    {
+        unsigned int head = d_head;
+
+        __sync_synchronize();
+
+        return head;
+    }
+
+    /*! \brief Copy samples from the buffer (consumer).
+     *  \param data The output buffer.
+     *  \param start The position of the first sample.
+     *  \param num The number of samples (at most capacity()).
+     *  \return false if the samples have been overwritten.
+     */
+    bool read(T *data, unsigned int start, unsigned int num) const
+    {
+        unsigned int pos = start & d_mask;
+        unsigned int first = capacity() - pos;
+
+        if (first > num)
+            first = num;
+
+        if (d_write_end - start > capacity())
+            return false;
+
+        memcpy(data, &d_buf[pos], first * sizeof(T));
+        memcpy(data + first, &d_buf[0], (num - first) * sizeof(T));
+
+        __sync_synchronize();
+
+        return (d_write_end - start <= capacity());
+    }
+
+    /*! \brief Copy the newest samples (consumer).
+     *  \param data The output buffer.
+     *  \param min_num The smallest number of new samples to return.
+     *  \param max_num The largest number of samples to return (at most capacity()).
+     *  \param pos The position after the last sample read by the consumer.
+     *             Updated to the current head if samples are returned.
+     *  \return The number of samples copied or 0 if fewer than min_num
+     *          new samples are available.
+     *
+     * If more than max_num new samples are available the older ones are
+     * skipped. If the producer overwrites the samples while they are being
+     * copied the newest samples are tried again a few times.
+     */
+    unsigned int read_newest(T *data, unsigned int min_num, unsigned int max_num,
+                             unsigned int &pos) const
+    {
+        unsigned int head, num;
+        int tries;
+
+        for (tries = 0; tries < 3; tries++)
+        {
+            head = this->head();
+            num = head - pos;
+
+            if (num < min_num)
+                return 0;
+            if (num > max_num)
+                num = max_num;
+
+            if (read(data, head - num, num))
+            {
+                pos = head;
+                return num;
+            }
+        }
+
+        return 0;
+    }
+
+private:
+    std::vector<T>          d_buf;        /*! The samples. */
+    unsigned int            d_mask;       /*! capacity - 1. */
+    volatile unsigned int   d_head;       /*! Position after the newest sample. */
+    volatile unsigned int   d_write_end;  /*! End of the write in progress. */
+};
+
+
+/*! \brief Atomically replace a pointer.
+ *  \param ptr The pointer to replace.
+ *  \param val The new value.
+ *  \return The old value.
+ *
+ * This is a full memory barrier. It can be used to hand over ownership
+ * of an object between threads: whoever gets the old pointer owns it.
+ */
+template <class T>
+inline T *rx_exchange_ptr(T * volatile *ptr, T *val)
+{
+    T *old;
+
+    do {
+        old = *ptr;
+    } while (!__sync_bool_compare_and_swap(ptr, old, val));
+
+    return old;
+}
+
+
+/*! \brief Triple buffer for passing results from work() to the GUI.
+ *  \ingroup DSP
+ *
+ * The writer fills its back buffer and publishes it by swapping it with
+ * the middle buffer. The reader swaps its front buffer with the middle
+ * buffer when a new one has been published. Both sides always own one
+ * buffer exclusively, so neither waits for the other and the reader
+ * always gets the newest complete result. Intermediate results are
+ * dropped if the reader is slower than the writer.
+ *
+ * The buffers can be resized by their current owner, e.g. a writer can
+ * resize its back buffer when the FFT size changes.
+ */
+template <class T>
+class rx_triple_buffer
+{
+public:
+    rx_triple_buffer() : d_state(1), d_write(0), d_read(2) {}
+
+    /*! \brief The buffer owned by the writer. */
+    T &write_buffer() { return d_buf[d_write]; }
+
+    /*! \brief Publish the write buffer (writer). */
+    void publish()
+    {
+        unsigned int old, val;
+
+        do {
+            old = d_state;
+            val = d_write | FRESH;
+        } while (!__sync_bool_compare_and_swap(&d_state, old, val));
+
+        d_write = old & INDEX;
+    }
+
+    /*! \brief Whether a published buffer has not been picked up by the reader yet.
+     *
+     * A writer can use this to skip producing results nobody will read.
+     */
+    bool fresh() const
+    {
+        return (d_state & FRESH) != 0;
+    }
+
+    /*! \brief Get the newest published buffer (reader).
+     *  \return true if there is a new buffer since the last call.
+     */
+    bool update()
+    {
+        unsigned int old;
+
+        if (!fresh())
+            return false;
+
+        do {
+            old = d_state;
+        } while (!__sync_bool_compare_and_swap(&d_state, old, d_read));
+
+        d_read = old & INDEX;
+
+        return true;
+    }
+
+    /*! \brief The buffer owned by the reader. Valid after update() returned true. */
+    const T &read_buffer() const { return d_buf[d_read]; }
+
+private:
+    enum {
+        INDEX = 0x03,   /*! Mask for the index of the middle buffer. */
+        FRESH = 0x04    /*! The middle buffer has not been read. */
+    };
+
+    T                       d_buf[3];  /*! The buffers. */
+    volatile unsigned int   d_state;   /*! Index of the middle buffer and FRESH flag. */
+    unsigned int            d_write;   /*! Index of the writer's buffer. */
+    unsigned int            d_read;    /*! Index of the reader's buffer. */
+};
+
+
+#endif /* LOCKFREE_H */
@@ -18,12 +18,20 @@
  * Boston, MA 02110-1301, USA.
  */
 #include <cmath>
+#include <algorithm>
+#include <string.h>
 #include <gr_io_signature.h>
 #include <gr_firdes.h>
 #include <dsp/resampler_ff.h>
+#include <dsp/lockfree.h>
 #include <iostream>
 
 
+/* Stopband attenuation in dB and the corresponding Kaiser window beta. */
+#define RR_ATTEN  60.0
+#define RR_BETA   5.65
+
+
 /*
  * Create a new instance of resampler_ff and return
  * a boost shared_ptr. This is effectively the public constructor.
@@ -40,65 +48,527 @@ static const int MIN_OUT = 1; /* Minimum number of output streams. */
 static const int MAX_OUT = 1; /* Maximum number of output streams. */
 
 
-resampler_ff::resampler_ff(unsigned int input_rate, unsigned int output_rate)
-    : gr_hier_block2 ("resampler_ff",
-                      gr_make_io_signature (MIN_IN, MAX_IN, sizeof (float)),
-                      gr_make_io_signature (MIN_OUT, MAX_OUT, sizeof (float)))
+/*! \brief Greatest common divisor. */
+static unsigned int gcd(unsigned int a, unsigned int b)
 {
+    unsigned int c;
 
-    /* calculate interpolation and decimation */
-    d_interp = lcm(input_rate, output_rate) / input_rate;
-    d_decim = lcm(input_rate, output_rate) / output_rate;
+    while (b != 0)
+    {
+        c = a % b;
+        a = b;
+        b = c;
+    }
 
-    std::cout << "resampler_ff:" << std::endl;
-    std::cout << "   inter: " << d_interp << std::endl;
-    std::cout << "   decim: " << d_decim << std::endl;
+    return a;
+}
 
-    /* generate taps */
-    float fract_bw = 0.4;
-    float trans_width = 0.5 - fract_bw;
-    float mid_trans_band = 0.5 - trans_width/2.0;
 
-    d_taps = gr_firdes::low_pass(d_interp,   // gain
-                                 1.0,        // sampling freq
-                                 mid_trans_band/d_interp,
-                                 trans_width/d_interp,
-                                 gr_firdes::WIN_KAISER,
-                                 5.0     // beta
-                                );
+/*! \brief Dot product with four partial sums; ntaps must be a multiple of 4. */
+static inline float dot4(const float *h, const float *x, int ntaps)
+{
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int k;
 
-    /* create band pass filter */
-    d_rrb = gr_make_rational_resampler_base_fff(d_interp, d_decim, d_taps);
+    for (k = 0; k < ntaps; k += 4)
+    {
+        s0 += h[k] * x[k];
+        s1 += h[k+1] * x[k+1];
+        s2 += h[k+2] * x[k+2];
+        s3 += h[k+3] * x[k+3];
+    }
 
-    /* connect filter */
-    connect(self(), 0, d_rrb, 0);
-    connect(d_rrb, 0, self(), 0);
+    return (s0 + s1) + (s2 + s3);
+}
+
+
+/*! \brief Filter length for RR_ATTEN and a transition width relative to the sample rate. */
+static int kaiser_length(double trans_width)
+{
+    return (int) ceil((RR_ATTEN - 7.95) / (2.285 * 2.0 * M_PI * trans_width)) + 1;
+}
+
+
+/*! \brief Windowed sinc low pass filter of odd length and unity gain at DC.
+ *  \param len The number of taps (odd).
+ *  \param cutoff The cutoff frequency relative to the sample rate.
+ *
+ * Unlike gr_firdes::low_pass() the length is given, which the half-band
+ * and polyphase structures need.
+ */
+static std::vector<double> kaiser_low_pass(int len, double cutoff)
+{
+    std::vector<float> win = gr_firdes::window(gr_firdes::WIN_KAISER, len, RR_BETA);
+    std::vector<double> h(len);
+    int mid = (len - 1) / 2;
+    double x;
+    int n;
+
+    for (n = 0; n < len; n++)
+    {
+        x = 2.0 * M_PI * cutoff * (n - mid);
+        h[n] = 2.0 * cutoff * win[n] * ((n == mid) ? 1.0 : sin(x) / x);
+    }
+
+    return h;
+}
+
+
+/*! \brief Choose the structure for the given rates and design its filters. */
+resampler_ff_config::resampler_ff_config(unsigned int input_rate, unsigned int output_rate)
+    : type(resampler_ff::TYPE_COPY),
+      num(1),
+      den(1),
+      macs(0.0),
+      ntaps(0)
+{
+    unsigned int g;
+
+    if ((input_rate == 0) || (output_rate == 0))
+        return;
+
+    g = gcd(input_rate, output_rate);
+    num = input_rate / g;
+    den = output_rate / g;
+
+    if (num == den)
+        type = resampler_ff::TYPE_COPY;
+    else if ((num == 1) && ((den & (den - 1)) == 0))
+        type = resampler_ff::TYPE_HALFBAND_UP;
+    else if ((den == 1) && ((num & (num - 1)) == 0))
+        type = resampler_ff::TYPE_HALFBAND_DN;
+    else
+        type = resampler_ff::TYPE_POLYPHASE;
+
+    if (type == resampler_ff::TYPE_POLYPHASE)
+        design_polyphase(input_rate, output_rate);
+    else if (type != resampler_ff::TYPE_COPY)
+        design_halfband(input_rate, output_rate);
+}
+
+
+/*! \brief Design the half-band cascade.
+ *
+ * The signal occupies 0.4 times the lower rate. Each stage runs at twice
+ * the rate of its narrow side and only has to keep its image or alias
+ * out of that band, so the first stage next to the lower rate needs a
+ * transition of 0.1 times its rate and the following stages get shorter.
+ * The filter length is rounded up to 8n+7 so that the non-zero taps are
+ * a multiple of 4.
+ */
+void resampler_ff_config::design_halfband(double input_rate, double output_rate)
+{
+    bool up = (output_rate > input_rate);
+    double band = 0.4 * (up ? input_rate : output_rate);
+    double rate;
+    std::vector<double> h;
+    int nstages, s, len, j;
+
+    nstages = 0;
+    while ((1 << nstages) < (up ? den : num))
+        nstages++;
+
+    stages.resize(nstages);
+    macs = 0.0;
+
+    for (s = 0; s < nstages; s++)
+    {
+        resampler_ff_stage &st = stages[s];
+
+        /* rate at the wide side of the stage */
+        rate = up ? input_rate * (2 << s) : input_rate / (1 << s);
+
+        len = kaiser_length(0.5 - 2.0 * band / rate);
+        len = (len <= 7) ? 7 : 8 * ((len - 7 + 7) / 8) + 7;
+        h = kaiser_low_pass(len, 0.25);
+
+        /* taps 0, 2, 4, ... are non-zero; interpolation needs a gain of 2 */
+        st.ntaps = (len + 1) / 2;
+        st.taps.resize(st.ntaps);
+        for (j = 0; j < st.ntaps; j++)
+            st.taps[j] = (up ? 2.0 : 1.0) * h[2*j];
+
+        st.buf.assign(st.ntaps - 1 + RR_CHUNK, 0.0f);
+        if (up)
+        {
+            /* the center tap falls on input sample (len+1)/4 of the window */
+            st.delay = (len + 1) / 4;
+            macs += (double) st.ntaps / (2 << (nstages - 1 - s));
+        }
+        else
+        {
+            /* the center tap falls on odd input sample (len-3)/4 */
+            st.delay = (len - 3) / 4;
+            st.odd.assign(st.ntaps - 1 + RR_CHUNK, 0.0f);
+            macs += (double) (st.ntaps + 1) * (1 << (nstages - 1 - s));
+        }
+    }
+
+    tmp[0].assign(RR_CHUNK, 0.0f);
+    tmp[1].assign(RR_CHUNK, 0.0f);
+}
+
+
+/*! \brief Design the arbitrary ratio polyphase filter.
+ *
+ * The prototype runs at RR_PHASES times the input rate and has ntaps taps
+ * per phase, limited to RR_MAX_TAPS. Phase RR_PHASES is phase 0 delayed
+ * by one input sample, so that general_work() can always interpolate
+ * between phase p and p+1.
+ */
+void resampler_ff_config::design_polyphase(double input_rate, double output_rate)
+{
+    double low = (input_rate < output_rate) ? input_rate : output_rate;
+    std::vector<double> proto;
+    int len, mid, c, p, k;
+
+    ntaps = kaiser_length(0.2 * low / input_rate);
+    if (ntaps > RR_MAX_TAPS)
+        ntaps = RR_MAX_TAPS;
+    if (ntaps < (num + den - 1) / den)
+        ntaps = (num + den - 1) / den;  /* never skip past the buffer */
+    ntaps = (ntaps + 3) & ~3;
+
+    len = ntaps * RR_PHASES + 1;
+    mid = (len - 1) / 2;
+    proto = kaiser_low_pass(len, 0.5 * low / (input_rate * RR_PHASES));
+
+    /* tap k of phase p is applied to sample k of the window and the output
+       falls p / RR_PHASES after sample c of the window */
+    c = ntaps / 2 - 1;
+    taps.assign((RR_PHASES + 1) * ntaps, 0.0f);
+    for (p = 0; p <= RR_PHASES; p++)
+        for (k = 0; k < ntaps; k++)
+            taps[p * ntaps + k] = RR_PHASES * proto[(c - k) * RR_PHASES + p + mid];
+
+    buf.assign(ntaps - 1 + RR_CHUNK, 0.0f);
+    macs = 2.0 * ntaps + 1.0;
+}
+
+
+resampler_ff::resampler_ff(unsigned int input_rate, unsigned int output_rate)
+    : gr_block ("resampler_ff",
+                gr_make_io_signature (MIN_IN, MAX_IN, sizeof (float)),
+                gr_make_io_signature (MIN_OUT, MAX_OUT, sizeof (float))),
+      d_pending(0),
+      d_retired(0),
+      d_input_rate(input_rate),
+      d_output_rate(output_rate),
+      d_acc(0),
+      d_idle(false)
+{
+    d_cfg = new resampler_ff_config(d_input_rate, d_output_rate);
+    d_hist = d_cfg->ntaps - 1;
+    d_macs = d_cfg->macs;
+    set_relative_rate((double) d_cfg->den / d_cfg->num);
 }
 
 
 resampler_ff::~resampler_ff ()
 {
+    delete d_cfg;
+    delete d_pending;
+    delete d_retired;
+}
 
+
+void resampler_ff::forecast(int noutput_items, gr_vector_int &ninput_items_required)
+{
+    ninput_items_required[0] = (noutput_items * d_cfg->num) / d_cfg->den + 1;
 }
 
 
-/*! \brief Greatest common divisor. */
-unsigned long long resampler_ff::gcd(unsigned long long a, unsigned long long b)
+/*! \brief Resample the input.
+ *
+ * The half-band cascade processes blocks of input that give an integer
+ * number of outputs, at most RR_CHUNK samples per stage. When interpolating,
+ * nothing is done until there is room for the outputs of one input sample;
+ * the output multiple is not used since it can not change while the flow
+ * graph is running. The polyphase
+ * filter takes only as many input samples as are needed for
+ * noutput_items, like rx_demod_fm. While the squelch is closed the
+ * filters are skipped.
+ */
+int resampler_ff::general_work(int noutput_items,
+                               gr_vector_int &ninput_items,
+                               gr_vector_const_void_star &input_items,
+                               gr_vector_void_star &output_items)
+{
+    const float *in = (const float *) input_items[0];
+    float *out = (float *) output_items[0];
+    resampler_ff_config *cfg;
+    int num, nout, nstages, need;
+
+    /* pick up new rates; the GUI deletes the old configuration */
+    cfg = rx_exchange_ptr(&d_pending, (resampler_ff_config *) 0);
+    if (cfg) {
+        d_hist = cfg->ntaps - 1;
+        d_acc = 0;
+        delete rx_exchange_ptr(&d_retired, d_cfg);  /* normally NULL */
+        d_cfg = cfg;
+    }
+    cfg = d_cfg;
+    nstages = cfg->stages.size();
+
+    /* squelch closed: restart from silence when it opens */
+    num = d_gate.update(this, ninput_items[0]);
+    if (!d_gate.open() && !d_idle)
+        clear();
+    d_idle = !d_gate.open();
+
+    switch (cfg->type)
+    {
+    case TYPE_HALFBAND_UP:
+        num = (num < (noutput_items >> nstages)) ? num : (noutput_items >> nstages);
+        num = (num < (RR_CHUNK >> nstages)) ? num : (RR_CHUNK >> nstages);
+        if (d_idle) {
+            nout = num << nstages;
+            memset(out, 0, nout * sizeof(float));
+        }
+        else {
+            nout = halfband_up(in, num, out);
+        }
+        break;
+
+    case TYPE_HALFBAND_DN:
+        nout = num >> nstages;
+        if ((nout == 0) && (ninput_items[0] >> nstages))
+            nout = 1;  /* complete the output at the squelch change */
+        nout = (nout < noutput_items) ? nout : noutput_items;
+        nout = (nout < (RR_CHUNK >> nstages)) ? nout : (RR_CHUNK >> nstages);
+        num = nout << nstages;
+        if (d_idle)
+            memset(out, 0, nout * sizeof(float));
+        else
+            halfband_down(in, num, out);
+        break;
+
+    case TYPE_POLYPHASE:
+        need = (d_acc + (noutput_items - 1) * cfg->num) / cfg->den + cfg->ntaps - d_hist;
+        num = (num < need) ? num : need;
+        num = (num < (int) cfg->buf.size() - d_hist) ? num : (int) cfg->buf.size() - d_hist;
+        num = (num > 0) ? num : 0;
+        nout = polyphase(in, num, out, noutput_items);
+        break;
+
+    default:
+        num = (num < noutput_items) ? num : noutput_items;
+        memcpy(out, in, num * sizeof(float));
+        nout = num;
+        break;
+    }
+
+    consume_each(num);
+
+    return nout;
+}
+
+
+/*! \brief Interpolate by 2 in each stage of the half-band cascade.
+ *  \param in The input samples.
+ *  \param num The number of input samples, at most RR_CHUNK >> stages.
+ *  \param out The output buffer.
+ *  \return The number of output samples.
+ *
+ * Every other output is the dot product with the non-zero taps, the
+ * others are the input delayed to the center tap.
+ */
+int resampler_ff::halfband_up(const float *in, int num, float *out)
 {
-    unsigned long long c = a % b;
+    const float *src = in;
+    float *dst, *x;
+    int nstages = d_cfg->stages.size();
+    int s, i, nt, delay;
 
-    while (c!= 0)
+    for (s = 0; s < nstages; s++)
     {
-        a = b;
-        b = c;
-        c = a % b;
+        resampler_ff_stage &st = d_cfg->stages[s];
+
+        nt = st.ntaps;
+        delay = st.delay;
+        x = &st.buf[0];
+        dst = (s == nstages - 1) ? out : &d_cfg->tmp[s & 1][0];
+
+        memcpy(&x[nt - 1], src, num * sizeof(float));
+        for (i = 0; i < num; i++)
+        {
+            dst[2*i] = dot4(&st.taps[0], &x[i], nt);
+            dst[2*i+1] = x[i + delay];
+        }
+        memmove(&x[0], &x[num], (nt - 1) * sizeof(float));
+
+        src = dst;
+        num *= 2;
     }
 
-    return b;
+    return num;
 }
 
-/*! \brief Least common multiple. */
-unsigned long long resampler_ff::lcm(unsigned long long a, unsigned long long b)
+
+/*! \brief Decimate by 2 in each stage of the half-band cascade.
+ *  \param in The input samples.
+ *  \param num The number of input samples, a multiple of 1 << stages.
+ *  \param out The output buffer.
+ *  \return The number of output samples.
+ *
+ * The input is split into even and odd samples. The non-zero taps apply
+ * to the even samples and the center tap to the odd samples.
+ */
+int resampler_ff::halfband_down(const float *in, int num, float *out)
 {
-    return ((a*b) / gcd(a,b));
+    const float *src = in;
+    float *dst, *e, *o;
+    int nstages = d_cfg->stages.size();
+    int s, i, nt, delay;
+
+    for (s = 0; s < nstages; s++)
+    {
+        resampler_ff_stage &st = d_cfg->stages[s];
+
+        nt = st.ntaps;
+        delay = st.delay;
+        e = &st.buf[0];
+        o = &st.odd[0];
+        dst = (s == nstages - 1) ? out : &d_cfg->tmp[s & 1][0];
+        num /= 2;
+
+        for (i = 0; i < num; i++)
+        {
+            e[nt - 1 + i] = src[2*i];
+            o[nt - 1 + i] = src[2*i+1];
+        }
+        for (i = 0; i < num; i++)
+            dst[i] = dot4(&st.taps[0], &e[i], nt) + 0.5f * o[i + delay];
+
+        memmove(&e[0], &e[num], (nt - 1) * sizeof(float));
+        memmove(&o[0], &o[num], (nt - 1) * sizeof(float));
+
+        src = dst;
+    }
+
+    return num;
+}
+
+
+/*! \brief Arbitrary ratio polyphase filter.
+ *  \param in The input samples.
+ *  \param num The number of input samples.
+ *  \param out The output buffer.
+ *  \param noutput_items The size of the output buffer.
+ *  \return The number of output samples.
+ *
+ * The position of the next output is kept as an exact fraction d_acc / den
+ * of an input sample, so there is no drift for any pair of integer rates.
+ * Each output interpolates linearly between the two nearest phases.
+ */
+int resampler_ff::polyphase(const float *in, int num, float *out, int noutput_items)
+{
+    resampler_ff_config *cfg = d_cfg;
+    const int nt = cfg->ntaps;
+    const float scale = 1.0f / cfg->den;
+    const float *h, *x;
+    float a, b, mu;
+    int total, pos, frac, i;
+
+    if (d_idle)
+        memset(&cfg->buf[d_hist], 0, num * sizeof(float));
+    else
+        memcpy(&cfg->buf[d_hist], in, num * sizeof(float));
+    total = d_hist + num;
+
+    pos = 0;
+    for (i = 0; (i < noutput_items) && (pos + nt <= total); i++)
+    {
+        if (d_idle)
+        {
+            out[i] = 0.0f;
+        }
+        else
+        {
+            frac = d_acc * RR_PHASES;
+            h = &cfg->taps[(frac / cfg->den) * nt];
+            mu = (frac % cfg->den) * scale;
+            x = &cfg->buf[pos];
+
+            a = dot4(h, x, nt);
+            b = dot4(h + nt, x, nt);
+            out[i] = a + mu * (b - a);
+        }
+
+        d_acc += cfg->num;
+        pos += d_acc / cfg->den;
+        d_acc %= cfg->den;
+    }
+
+    /* keep the samples the next output still needs */
+    d_hist = total - pos;
+    memmove(&cfg->buf[0], &cfg->buf[pos], d_hist * sizeof(float));
+
+    return i;
+}
+
+
+/*! \brief Clear the filter histories. */
+void resampler_ff::clear()
+{
+    unsigned int s;
+
+    for (s = 0; s < d_cfg->stages.size(); s++)
+    {
+        resampler_ff_stage &st = d_cfg->stages[s];
+
+        std::fill(st.buf.begin(), st.buf.end(), 0.0f);
+        std::fill(st.odd.begin(), st.odd.end(), 0.0f);
+    }
+    std::fill(d_cfg->buf.begin(), d_cfg->buf.end(), 0.0f);
+}
+
+
+/*! \brief Create a new configuration and hand it over to general_work().
+ *
+ * Must be called with d_mutex locked.
+ */
+void resampler_ff::configure()
+{
+    static const char *names[] = { "copy", "half-band up", "half-band down", "polyphase" };
+    resampler_ff_config *cfg = new resampler_ff_config(d_input_rate, d_output_rate);
+
+    std::cout << "resampler_ff: " << d_input_rate << " -> " << d_output_rate << std::endl;
+    std::cout << "   type: " << names[cfg->type] << std::endl;
+    if (cfg->type == TYPE_POLYPHASE)
+        std::cout << "   taps: " << RR_PHASES << " x " << cfg->ntaps << std::endl;
+    else if (cfg->type != TYPE_COPY)
+        std::cout << "   stages: " << cfg->stages.size() << std::endl;
+    std::cout << "   MACs per output: " << cfg->macs << std::endl;
+
+    d_macs = cfg->macs;
+    set_relative_rate((double) cfg->den / cfg->num);
+
+    /* delete configuration that general_work() is done with */
+    delete rx_exchange_ptr(&d_retired, (resampler_ff_config *) 0);
+
+    /* replace (and delete) configuration general_work() has not picked up yet */
+    delete rx_exchange_ptr(&d_pending, cfg);
+}
+
+
+/*! \brief Set new input and output rates.
+ *  \param input_rate Input sample rate in Hz.
+ *  \param output_rate Output sample rate Hz.
+ *
+ * The structure and filters are recalculated and picked up by the next
+ * call to general_work(). The relative rate changes too, so the flow
+ * graph must be locked while the block is connected; the scheduler sizes
+ * the buffers for the new rate when it is unlocked.
+ */
+void resampler_ff::set_rates(unsigned int input_rate, unsigned int output_rate)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    if ((input_rate == d_input_rate) && (output_rate == d_output_rate))
+        return;
+
+    d_input_rate = input_rate;
+    d_output_rate = output_rate;
+    configure();
 }
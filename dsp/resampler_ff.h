@@ -18,10 +18,61 @@
  * Boston, MA 02110-1301, USA.
  */
 #ifndef RESAMPLER_FF_H
-#define RESAMPELR_FF_H
+#define RESAMPLER_FF_H
 
-#include <gr_hier_block2.h>
-#include <gr_rational_resampler_base_fff.h>
+#include <gr_block.h>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+#include "dsp/rx_squelch.h"
+
+
+#define RR_CHUNK     4096   /*!< Max samples per resampler stage and pass. */
+#define RR_PHASES    32     /*!< Phases of the arbitrary ratio resampler. */
+#define RR_MAX_TAPS  64     /*!< Max taps per phase of the arbitrary ratio resampler. */
+
+
+/*! \brief One stage of the half-band cascade.
+ *
+ * Only every other tap of a half-band filter is non-zero, apart from the
+ * center tap which is 0.5. The non-zero taps form one polyphase filter
+ * of ntaps taps, the other polyphase filter is a delay.
+ */
+struct resampler_ff_stage
+{
+    int                ntaps;  /*!< Non-zero taps except the center tap (multiple of 4). */
+    int                delay;  /*!< Position of the center tap in buf. */
+    std::vector<float> taps;   /*!< The non-zero taps. */
+    std::vector<float> buf;    /*!< History (ntaps-1) and input, even input samples when decimating. */
+    std::vector<float> odd;    /*!< History (ntaps-1) and odd input samples when decimating. */
+};
+
+
+/*! \brief Structure and filters used by resampler_ff::general_work().
+ *
+ * Created by the GUI thread when the rates change and handed over to
+ * general_work() using rx_exchange_ptr(), like rx_demod_fm_config.
+ */
+struct resampler_ff_config
+{
+    resampler_ff_config(unsigned int input_rate, unsigned int output_rate);
+
+    int     type;        /*!< Structure, see resampler_ff::type. */
+    int     num;         /*!< Input rate / gcd(input rate, output rate). */
+    int     den;         /*!< Output rate / gcd(input rate, output rate). */
+    double  macs;        /*!< MACs per output sample. */
+
+    /* half-band cascade */
+    std::vector<resampler_ff_stage> stages;  /*!< Stages in signal order. */
+    std::vector<float>              tmp[2];  /*!< Output of the stages except the last. */
+
+    /* arbitrary ratio */
+    int     ntaps;       /*!< Taps per phase (multiple of 4). */
+    std::vector<float> taps;  /*!< RR_PHASES+1 filters of ntaps taps, in reverse order. */
+    std::vector<float> buf;   /*!< Filter history (ntaps-1) and input samples. */
+
+    void design_halfband(double input_rate, double output_rate);
+    void design_polyphase(double input_rate, double output_rate);
+};
 
 
 class resampler_ff;
@@ -39,30 +90,75 @@ typedef boost::shared_ptr<resampler_ff> resampler_ff_sptr;
 resampler_ff_sptr make_resampler_ff(unsigned int input_rate, unsigned int output_rate);
 
 
-/*! \brief Rational resampler based on gr_rational_resampler_base_fff
+/*! \brief Audio resampler for arbitrary rates.
  *  \ingroup DSP
  *
- * This block is a convenience wrapper around gr_rational_resampler_fff. It takes care
- * of generating filter taps that can be used for the resampler, as well as calculating
- * the interpolation and decimation given the input/output sample rates.
+ * This block picks the cheapest structure for the ratio between the
+ * input and output rates:
+ *   - equal rates are copied,
+ *   - a power of two ratio uses a cascade of half-band filters, each
+ *     interpolating or decimating by 2,
+ *   - other ratios use a polyphase filter with RR_PHASES phases and
+ *     linear interpolation between adjacent phases. The number of taps
+ *     per phase depends on the lower rate and is at most RR_MAX_TAPS,
+ *     so the cost does not grow with the ratio like the interpolation of
+ *     a rational resampler using the least common multiple does.
+ *
+ * All structures pass 0.4 and stop above 0.6 times the lower of the two
+ * rates, so aliases only fall in the transition band. Use
+ * macs_per_output() to get the cost of the current structure.
+ *
+ * While the squelch is closed the filters are skipped and zeros are
+ * output at the same rate.
  */
-class resampler_ff : public gr_hier_block2
+class resampler_ff : public gr_block
 {
 
 public:
+    /*! \brief Resampler structures. */
+    enum type {
+        TYPE_COPY         = 0,  /*!< Equal rates. */
+        TYPE_HALFBAND_UP  = 1,  /*!< Interpolation by a power of two. */
+        TYPE_HALFBAND_DN  = 2,  /*!< Decimation by a power of two. */
+        TYPE_POLYPHASE    = 3   /*!< Any other ratio. */
+    };
+
     resampler_ff(unsigned int input_rate, unsigned int output_rate); // FIXME: should be private
     ~resampler_ff();
 
-private:
-    std::vector<float> d_taps;
-    gr_rational_resampler_base_fff_sptr  d_rrb;
+    void forecast(int noutput_items, gr_vector_int &ninput_items_required);
+
+    int general_work(int noutput_items,
+                     gr_vector_int &ninput_items,
+                     gr_vector_const_void_star &input_items,
+                     gr_vector_void_star &output_items);
 
-    unsigned int d_interp;
-    unsigned int d_decim;
+    void set_rates(unsigned int input_rate, unsigned int output_rate);
 
-    unsigned long long gcd(unsigned long long a, unsigned long long b);
-    unsigned long long lcm(unsigned long long a, unsigned long long b);
+    /*! \brief Number of MACs per output sample required by the current structure. */
+    double macs_per_output() { return d_macs; }
 
+private:
+    resampler_ff_config            *d_cfg;      /*! Configuration used by general_work(). */
+    resampler_ff_config * volatile  d_pending;  /*! New configuration for general_work(). */
+    resampler_ff_config * volatile  d_retired;  /*! Old configuration to be deleted by the GUI. */
+    boost::mutex d_mutex;  /*! Serializes the setters, never taken by general_work(). */
+
+    unsigned int d_input_rate;
+    unsigned int d_output_rate;
+    double       d_macs;      /*! MACs per output sample of the current configuration. */
+
+    /* state of general_work() */
+    int  d_acc;     /*! Position between two input samples, in units of 1/den. */
+    int  d_hist;    /*! Samples in the polyphase filter buffer. */
+    bool d_idle;    /*! Squelch closed, the input is zero. */
+    rx_squelch_gate d_gate;  /*! Squelch state of the input. */
+
+    void configure();
+    void clear();
+    int  halfband_up(const float *in, int num, float *out);
+    int  halfband_down(const float *in, int num, float *out);
+    int  polyphase(const float *in, int num, float *out, int noutput_items);
 };
 
 
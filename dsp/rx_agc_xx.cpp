@@ -18,6 +18,7 @@
  * Boston, MA 02110-1301, USA.
  */
 #include <math.h>
+#include <algorithm>
 #include <gr_io_signature.h>
 #include <gr_complex.h>
 #include <dsp/rx_agc_xx.h>
@@ -46,11 +47,21 @@ rx_agc_cc::rx_agc_cc(double sample_rate, bool agc_on, int threshold,
       d_manual_gain(manual_gain),
       d_slope(slope),
       d_decay(decay),
-      d_use_hang(use_hang)
+      d_use_hang(use_hang),
+      d_params_seen(0),
+      d_idle(false),
+      d_drain(0),
+      d_out_state(SQL_OPEN)
 {
+    d_key = pmt::pmt_string_to_symbol(SQL_TAG);
+
+    /* the tags are moved by the AGC delay in work() */
+    set_tag_propagation_policy(TPP_DONT);
+
     d_agc = new CAgc();
     d_agc->SetParameters(d_agc_on, d_use_hang, d_threshold, d_manual_gain,
                          d_slope, d_decay, d_sample_rate);
+    publish_params();
 }
 
 rx_agc_cc::~rx_agc_cc()
@@ -63,6 +74,10 @@ rx_agc_cc::~rx_agc_cc()
  *  \param mooutput_items
  *  \param input_items
  *  \param output_items
+ *
+ * Each call covers samples with one squelch state at the input and one
+ * at the output. The output state is the input state delayed by the AGC
+ * delay line.
  */
 int rx_agc_cc::work(int noutput_items,
                     gr_vector_const_void_star &input_items,
@@ -70,25 +85,96 @@ int rx_agc_cc::work(int noutput_items,
 {
     const gr_complex *in = (const gr_complex *) input_items[0];
     gr_complex *out = (gr_complex *) output_items[0];
-    int i;
+    uint64_t start = nitems_written(0);
+    uint64_t offset;
+    unsigned int i;
+    int delay;
+    int n;
+
+    rx_agc_params p;
+
+    if (d_params.read(p, d_params_seen))
+        d_agc->SetParameters(p.agc_on, p.use_hang, p.threshold, p.manual_gain,
+                             p.slope, p.decay, p.sample_rate);
+
+    delay = d_agc->DelaySamples();
+
+    /* moved tags reached by the output */
+    while (!d_pending.empty() && (d_pending.front().offset <= start))
+    {
+        const gr_tag_t &t = d_pending.front();
+
+        add_item_tag(0, start, t.key, t.value, t.srcid);
+        if (pmt::pmt_eq(t.key, d_key))
+            d_out_state = pmt::pmt_to_long(t.value);
+        d_pending.pop_front();
+    }
 
-    // lock mutex
-    boost::mutex::scoped_lock lock(d_mutex);
+    noutput_items = d_gate.update(this, noutput_items);
+    if (!d_pending.empty() && (d_pending.front().offset < start + noutput_items))
+        noutput_items = (int) (d_pending.front().offset - start);
 
-    for (i = 0; i < noutput_items; i++) {
-        ib[i].im = in[i].imag();
-        ib[i].re = in[i].real();
+    /* move the input tags, keeping them in order if the delay got shorter;
+       a tag moved into this call ends it */
+    d_tags.clear();
+    get_tags_in_range(d_tags, 0, start, start + noutput_items);
+    for (i = 0; (i < d_tags.size()) && (d_tags[i].offset < start + noutput_items); i++)
+    {
+        offset = d_tags[i].offset + delay;
+        if (!d_pending.empty() && (offset < d_pending.back().offset))
+            offset = d_pending.back().offset;
+        if (offset < start + noutput_items)
+            noutput_items = (int) (offset - start);
+        d_tags[i].offset = offset;
+        d_pending.push_back(d_tags[i]);
     }
 
-    d_agc->ProcessData(noutput_items, &ib[0], &ob[0]);
+    if (d_gate.state() == SQL_CLOSED) {
+        /* let the delay line run out before going idle */
+        n = std::min(noutput_items, d_drain);
+        if (n > 0)
+            d_agc->ProcessData(n, in, out);
+        std::fill(out + n, out + noutput_items, gr_complex(0.0, 0.0));
+        d_drain -= n;
+        if (d_drain == 0)
+            d_idle = true;
+    }
+    else {
+        /* the gain and delay line are from before the squelch closed */
+        if (d_idle) {
+            d_agc->ResetState();
+            d_idle = false;
+        }
+
+        d_agc->ProcessData(noutput_items, in, out);
+        d_drain = delay;
+    }
 
-    for (i = 0; i < noutput_items; i++)
-	out[i] = gr_complex( ob[i].re,  ob[i].im);
+    /* settle on the pre-roll but keep it silent */
+    if (d_out_state != SQL_OPEN)
+        std::fill(out, out + noutput_items, gr_complex(0.0, 0.0));
 
     return noutput_items;
 }
 
 
+/*! \brief Publish the current parameters to work(). */
+void rx_agc_cc::publish_params()
+{
+    rx_agc_params p;
+
+    p.agc_on = d_agc_on;
+    p.use_hang = d_use_hang;
+    p.threshold = d_threshold;
+    p.manual_gain = d_manual_gain;
+    p.slope = d_slope;
+    p.decay = d_decay;
+    p.sample_rate = d_sample_rate;
+
+    d_params.write(p);
+}
+
+
 /*! \brief Enable or disable AGC.
  *  \param agc_on Whether AGC should be endabled.
  *
@@ -99,10 +185,8 @@ int rx_agc_cc::work(int noutput_items,
 void rx_agc_cc::set_agc_on(bool agc_on)
 {
     if (agc_on != d_agc_on) {
-        boost::mutex::scoped_lock lock(d_mutex);
         d_agc_on = agc_on;
-        d_agc->SetParameters(d_agc_on, d_use_hang, d_threshold, d_manual_gain,
-                             d_slope, d_decay, d_sample_rate);
+        publish_params();
     }
 }
 
@@ -115,10 +199,8 @@ void rx_agc_cc::set_agc_on(bool agc_on)
 void rx_agc_cc::set_sample_rate(double sample_rate)
 {
     if (sample_rate != d_sample_rate) {
-        boost::mutex::scoped_lock lock(d_mutex);
         d_sample_rate = sample_rate;
-        d_agc->SetParameters(d_agc_on, d_use_hang, d_threshold, d_manual_gain,
-                             d_slope, d_decay, d_sample_rate);
+        publish_params();
     }
 }
 
@@ -130,10 +212,8 @@ void rx_agc_cc::set_sample_rate(double sample_rate)
 void rx_agc_cc::set_threshold(int threshold)
 {
     if ((threshold != d_threshold) && (threshold >= -160) && (threshold <= 0)) {
-        boost::mutex::scoped_lock lock(d_mutex);
         d_threshold = threshold;
-        d_agc->SetParameters(d_agc_on, d_use_hang, d_threshold, d_manual_gain,
-                             d_slope, d_decay, d_sample_rate);
+        publish_params();
     }
 }
 
@@ -147,10 +227,8 @@ void rx_agc_cc::set_threshold(int threshold)
 void rx_agc_cc::set_manual_gain(int gain)
 {
     if ((gain != d_manual_gain) && (gain >= 0) && (gain <= 100)) {
-        boost::mutex::scoped_lock lock(d_mutex);
         d_manual_gain = gain;
-        d_agc->SetParameters(d_agc_on, d_use_hang, d_threshold, d_manual_gain,
-                             d_slope, d_decay, d_sample_rate);
+        publish_params();
     }
 }
 
@@ -162,10 +240,8 @@ void rx_agc_cc::set_manual_gain(int gain)
 void rx_agc_cc::set_slope(int slope)
 {
     if ((slope != d_slope) && (slope >= 0) && (slope <= 10)) {
-        boost::mutex::scoped_lock lock(d_mutex);
         d_slope = slope;
-        d_agc->SetParameters(d_agc_on, d_use_hang, d_threshold, d_manual_gain,
-                             d_slope, d_decay, d_sample_rate);
+        publish_params();
     }
 }
 
@@ -175,10 +251,8 @@ void rx_agc_cc::set_slope(int slope)
 void rx_agc_cc::set_decay(int decay)
 {
     if ((decay != d_decay) && (decay >= 20) && (decay <= 5000)) {
-        boost::mutex::scoped_lock lock(d_mutex);
         d_decay = decay;
-        d_agc->SetParameters(d_agc_on, d_use_hang, d_threshold, d_manual_gain,
-                             d_slope, d_decay, d_sample_rate);
+        publish_params();
     }
 }
 
@@ -188,9 +262,7 @@ void rx_agc_cc::set_decay(int decay)
 void rx_agc_cc::set_use_hang(bool use_hang)
 {
     if (use_hang != d_use_hang) {
-        boost::mutex::scoped_lock lock(d_mutex);
         d_use_hang = use_hang;
-        d_agc->SetParameters(d_agc_on, d_use_hang, d_threshold, d_manual_gain,
-                             d_slope, d_decay, d_sample_rate);
+        publish_params();
     }
 }
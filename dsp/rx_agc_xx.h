@@ -22,8 +22,11 @@
 
 #include <gr_sync_block.h>
 #include <gr_complex.h>
-#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <vector>
 #include <dsp/agc_impl.h>
+#include <dsp/lockfree.h>
+#include <dsp/rx_squelch.h>
 
 class rx_agc_cc;
 
@@ -56,11 +59,36 @@ rx_agc_cc_sptr make_rx_agc_cc(double sample_rate, bool agc_on = true,
                               bool use_hang = false);
 
 
+/*! \brief AGC parameters passed from the setters to work(). */
+struct rx_agc_params
+{
+    bool   agc_on;
+    bool   use_hang;
+    int    threshold;
+    int    manual_gain;
+    int    slope;
+    int    decay;
+    double sample_rate;
+};
+
+
 /*! \brief Experimental AGC block for analog voice modes (AM, SSB, CW).
  *  \ingroup DSP
  *
  * This block performs automatic gain control.
- * To be written...
+ *
+ * The setters only publish a new parameter snapshot; work() picks it up at
+ * the beginning of the next call and reconfigures the AGC. work() never
+ * waits for a setter.
+ *
+ * Behind rx_squelch_cc the AGC is idle while the squelch is closed. It
+ * restarts with a clear state at the pre-roll, which it processes to
+ * settle the gain without passing it on.
+ *
+ * The output lags the input by the AGC delay line, so the tags are moved
+ * by the same delay and the output is gated by the moved squelch state.
+ * After the squelch closes the AGC runs until the delay line is drained,
+ * which lets the end of the transmission through.
  *
  * \todo rx_agc_ff
  */
@@ -90,8 +118,20 @@ public:
     void set_use_hang(bool use_hang);
 
 private:
+    void publish_params();
+
     CAgc         *d_agc;
-    boost::mutex  d_mutex;  /*! Used to lock internal data while processing or setting parameters. */
+    rx_seqlock<rx_agc_params>  d_params;  /*! Parameters for work(). */
+    unsigned int  d_params_seen;          /*! Last parameter snapshot used by work(). */
+    rx_squelch_gate d_gate;               /*! Squelch state of the input. */
+    bool          d_idle;                 /*! Squelch has been closed, reset before use. */
+    int           d_drain;                /*! Samples to process after the squelch closed. */
+    int           d_out_state;            /*! Squelch state of the output. */
+    pmt::pmt_t    d_key;                  /*! SQL_TAG */
+
+    /*! Input tags moved by the AGC delay, not yet reached by the output. */
+    std::deque<gr_tag_t> d_pending;
+    std::vector<gr_tag_t> d_tags;         /*! Tags in the current call. */
 
     bool   d_agc_on;        /*! Current AGC status (true/false). */
     double d_sample_rate;   /*! Current sample rate. */
@@ -100,9 +140,6 @@ private:
     int    d_slope;         /*! Current AGC slope (0...10 dB). */
     int    d_decay;         /*! Current AGC decay (20...5000 ms). */
     bool   d_use_hang;      /*! Current AGC hang status (true/false). */
-
-    TYPECPX ib[64000];
-    TYPECPX ob[64000];
 };
 
 
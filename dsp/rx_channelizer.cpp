@@ -0,0 +1,92 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <cmath>
+#include <gr_io_signature.h>
+#include <gr_firdes.h>
+#include <dsp/rx_channelizer.h>
+
+
+/*
+ * Create a new instance of rx_channelizer and return
+ * a boost shared_ptr. This is effectively the public constructor.
+ */
+rx_channelizer_sptr make_rx_channelizer(double sample_rate, unsigned int num_chan)
+{
+    return gnuradio::get_initial_sptr(new rx_channelizer(sample_rate, num_chan));
+}
+
+
+rx_channelizer::rx_channelizer(double sample_rate, unsigned int num_chan)
+    : gr_hier_block2 ("rx_channelizer",
+                      gr_make_io_signature (1, 1, sizeof (gr_complex)),
+                      gr_make_io_signature (num_chan, num_chan, sizeof (gr_complex))),
+      d_sample_rate(sample_rate),
+      d_num_chan(num_chan)
+{
+    unsigned int i;
+    double spacing = channel_spacing();
+
+    /* Prototype low pass filter. The passband extends beyond half the
+       channel spacing so that a signal centered between two channels is
+       still passed by the nearest one; the 2x oversampled output leaves
+       room for the transition band.
+     */
+    d_taps = gr_firdes::low_pass(1.0, d_sample_rate, 0.9*spacing, 0.2*spacing,
+                                 gr_firdes::WIN_BLACKMAN_hARRIS);
+
+    d_s2ss = gr_make_stream_to_streams(sizeof(gr_complex), d_num_chan);
+    d_pfb = gr_make_pfb_channelizer_ccf(d_num_chan, d_taps, OVERSAMPLE_RATE);
+
+    connect(self(), 0, d_s2ss, 0);
+    for (i = 0; i < d_num_chan; i++)
+    {
+        connect(d_s2ss, i, d_pfb, i);
+        connect(d_pfb, i, self(), i);
+    }
+}
+
+
+rx_channelizer::~rx_channelizer()
+{
+
+}
+
+
+/*! \brief Find the channel containing a given frequency offset.
+ *  \param offset The frequency offset from the input center in Hz.
+ *  \param residual The offset from the center of the returned channel (output).
+ *  \return The output port of the channel or -1 if the offset is out of range.
+ */
+int rx_channelizer::channel_index(double offset, double &residual)
+{
+    double spacing = channel_spacing();
+    int k;
+
+    if (fabs(offset) > d_sample_rate / 2.0)
+        return -1;
+
+    k = (int) floor(offset / spacing + 0.5);
+    residual = offset - k * spacing;
+
+    if (k < 0)
+        k += d_num_chan;
+
+    return k % d_num_chan;
+}
@@ -0,0 +1,94 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RX_CHANNELIZER_H
+#define RX_CHANNELIZER_H
+
+#include <gr_hier_block2.h>
+#include <gr_stream_to_streams.h>
+#include <gr_pfb_channelizer_ccf.h>
+#include <vector>
+
+
+class rx_channelizer;
+
+
+typedef boost::shared_ptr<rx_channelizer> rx_channelizer_sptr;
+
+
+/*! \brief Return a shared_ptr to a new instance of rx_channelizer.
+ *  \param sample_rate The input sample rate.
+ *  \param num_chan The number of channels (must be even).
+ *
+ * This is effectively the public constructor. To avoid accidental use
+ * of raw pointers, rx_channelizer's constructor is private.
+ * make_rx_channelizer is the public interface for creating new instances.
+ */
+rx_channelizer_sptr make_rx_channelizer(double sample_rate, unsigned int num_chan);
+
+
+/*! \brief Polyphase filter bank channelizer.
+ *  \ingroup DSP
+ *
+ * This block splits the input spectrum into num_chan equally spaced channels
+ * using a polyphase filter bank followed by an FFT. The cost is roughly one
+ * FFT per num_chan input samples regardless of how many channels are used,
+ * which makes it much cheaper than running one frequency xlating filter per
+ * channel at the full input rate.
+ *
+ * The channels are spaced sample_rate/num_chan apart and each output runs at
+ * twice the channel spacing (2x oversampling). The oversampling ensures that
+ * a signal located anywhere between two channel centers is fully contained
+ * within the nearest channel so that the final tuning can be done at the low
+ * rate, see channel_index().
+ *
+ * Output port i carries channel i, i.e. port 0 is centered at DC, ports
+ * 1...num_chan/2-1 are the positive frequencies and the rest are the
+ * negative frequencies (FFT order).
+ *
+ * All outputs must be connected; unused channels should be terminated with
+ * a null sink.
+ */
+class rx_channelizer : public gr_hier_block2
+{
+
+public:
+    rx_channelizer(double sample_rate, unsigned int num_chan); // FIXME: should be private
+    ~rx_channelizer();
+
+    unsigned int num_channels() { return d_num_chan; }
+    double channel_spacing() { return d_sample_rate / d_num_chan; }
+    double channel_rate() { return OVERSAMPLE_RATE * d_sample_rate / d_num_chan; }
+
+    int channel_index(double offset, double &residual);
+
+private:
+    static const int OVERSAMPLE_RATE = 2;
+
+    gr_stream_to_streams_sptr    d_s2ss;  /*! Input commutator. */
+    gr_pfb_channelizer_ccf_sptr  d_pfb;   /*! The filter bank. */
+    std::vector<float>           d_taps;  /*! Prototype filter taps. */
+
+    double       d_sample_rate;   /*! Input sample rate. */
+    unsigned int d_num_chan;      /*! Number of channels. */
+
+};
+
+
+#endif // RX_CHANNELIZER_H
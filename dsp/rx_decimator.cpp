@@ -0,0 +1,329 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <cmath>
+#include <gr_io_signature.h>
+#include <gr_firdes.h>
+#include <dsp/rx_decimator.h>
+
+
+/* Number of filters in the arbitrary resampler. */
+#define ARB_NFILTS 32
+
+/* Real MACs per sample for complex x real tap, complex x complex tap
+   and the rotator (sample rotation and phasor update). */
+#define MACS_CCF 2.0
+#define MACS_CCC 4.0
+#define MACS_ROT 8.0
+
+
+/*
+ * Create a new instance of rx_decimator_cc and return
+ * a boost shared_ptr. This is effectively the public constructor.
+ */
+rx_decimator_cc_sptr make_rx_decimator_cc(double in_rate, double out_rate,
+                                          double cutoff, double trans_width,
+                                          double offset)
+{
+    return gnuradio::get_initial_sptr(new rx_decimator_cc(in_rate, out_rate, cutoff,
+                                                          trans_width, offset));
+}
+
+
+static const int MIN_IN = 1;  /* Mininum number of input streams. */
+static const int MAX_IN = 1;  /* Maximum number of input streams. */
+static const int MIN_OUT = 1; /* Minimum number of output streams. */
+static const int MAX_OUT = 1; /* Maximum number of output streams. */
+
+
+rx_decimator_cc::rx_decimator_cc(double in_rate, double out_rate, double cutoff,
+                                 double trans_width, double offset)
+    : gr_hier_block2 ("rx_decimator_cc",
+                      gr_make_io_signature (MIN_IN, MAX_IN, sizeof (gr_complex)),
+                      gr_make_io_signature (MIN_OUT, MAX_OUT, sizeof (gr_complex))),
+      d_arb_rate(1.0),
+      d_plan_macs(0.0),
+      d_macs(0.0),
+      d_in_rate(in_rate),
+      d_out_rate(out_rate),
+      d_cutoff(cutoff),
+      d_trans_width(trans_width),
+      d_offset(offset),
+      d_low(-cutoff),
+      d_high(cutoff),
+      d_bp_tw(trans_width)
+{
+    configure();
+}
+
+
+rx_decimator_cc::~rx_decimator_cc()
+{
+
+}
+
+
+/*! \brief Set frequency offset.
+ *  \param offset The input frequency that should be moved to DC.
+ *
+ * This only changes the phase increment of the rotator, no filter
+ * taps are recalculated.
+ */
+void rx_decimator_cc::set_offset(double offset)
+{
+    d_offset = offset;
+    d_rot->set_freq(-d_offset);
+}
+
+
+/*! \brief Set channel filter.
+ *  \param low The lower edge of the passband relative to DC.
+ *  \param high The upper edge of the passband relative to DC.
+ *  \param trans_width The transition width.
+ *
+ * The passband should be within +/- cutoff; outside of that the
+ * decimation stages will attenuate and alias the signal.
+ */
+void rx_decimator_cc::set_band_pass(double low, double high, double trans_width)
+{
+    d_low = low;
+    d_high = high;
+    d_bp_tw = trans_width;
+
+    design_band_pass();
+    d_bpf->set_taps(d_bpf_taps);
+}
+
+
+/*! \brief Set new input and output sample rates.
+ *
+ * The decimation is re-planned and the blocks are reconnected.
+ */
+void rx_decimator_cc::set_rates(double in_rate, double out_rate)
+{
+    set_params(in_rate, out_rate, d_cutoff, d_trans_width);
+}
+
+
+/*! \brief Set new parameters for the decimation stages.
+ *  \param cutoff The maximum cutoff frequency of the channel filter.
+ *  \param trans_width The transition width of the polyphase stage.
+ *
+ * The decimation is re-planned and the blocks are reconnected.
+ */
+void rx_decimator_cc::set_cutoff(double cutoff, double trans_width)
+{
+    set_params(d_in_rate, d_out_rate, cutoff, trans_width);
+}
+
+
+/*! \brief Set new sample rates and decimation parameters.
+ *
+ * The decimation is re-planned and the blocks are reconnected once
+ * for all parameters. The channel filter is recalculated for the new
+ * output rate.
+ */
+void rx_decimator_cc::set_params(double in_rate, double out_rate, double cutoff, double trans_width)
+{
+    if ((in_rate == d_in_rate) && (out_rate == d_out_rate) &&
+        (cutoff == d_cutoff) && (trans_width == d_trans_width))
+        return;
+
+    d_in_rate = in_rate;
+    d_out_rate = out_rate;
+    d_cutoff = cutoff;
+    d_trans_width = trans_width;
+
+    lock();
+    disconnect_all();
+    configure();
+    unlock();
+}
+
+
+/*! \brief Calculate decimation plan.
+ *  \param in_rate The input sample rate.
+ *  \param out_rate The output sample rate.
+ *  \param cutoff The maximum channel filter cutoff frequency.
+ *  \param trans_width The transition width of the polyphase stage.
+ *  \param stages The decimation stages (output).
+ *  \param arb_rate The ratio of the arbitrary resampler or 1.0 if none is needed (output).
+ *  \return The number of real MACs per input sample.
+ *
+ * All plans with 0...N half-band stages followed by one polyphase stage are
+ * evaluated and the one with the lowest number of MACs per input sample is
+ * returned. The cost of the rotator and the arbitrary resampler is included
+ * but the cost of the channel filter is not since it does not depend on the
+ * plan.
+ */
+double rx_decimator_cc::plan(double in_rate, double out_rate, double cutoff, double trans_width,
+                             std::vector<rx_decim_stage> &stages, double &arb_rate)
+{
+    std::vector<rx_decim_stage> candidate;
+    rx_decim_stage stage;
+    double best_macs = -1.0;
+    double macs, rate, input_frac;
+    int decim, halfbands, i;
+
+    decim = (int) floor(in_rate / out_rate + 1.0e-6);
+    if (decim < 1)
+        decim = 1;
+
+    arb_rate = out_rate * decim / in_rate;
+    if (fabs(arb_rate - 1.0) < 1.0e-6)
+        arb_rate = 1.0;
+
+    for (halfbands = 0; ; halfbands++)
+    {
+        /* each half-band stage halves the decimation of the final stage */
+        if ((halfbands > 0) && (decim % (1 << halfbands) != 0))
+            break;
+
+        /* the half-band stage must leave the channel passband alias free */
+        rate = in_rate / (1 << halfbands);
+        if ((halfbands > 0) && (rate - 2.0*cutoff <= 0.0))
+            break;
+
+        candidate.clear();
+        macs = MACS_ROT;
+        input_frac = 1.0;
+
+        for (i = 0; i < halfbands; i++)
+        {
+            rate = in_rate / (1 << i);
+            stage.decim = 2;
+            stage.halfband = true;
+            stage.taps = rx_halfband_cc::design(rate, rate/2.0 - 2.0*cutoff);
+            candidate.push_back(stage);
+
+            input_frac /= 2.0;
+            macs += MACS_CCF * rx_halfband_cc::nonzero_taps(stage.taps) * input_frac;
+        }
+
+        /* polyphase stage for the remaining decimation */
+        rate = in_rate / (1 << halfbands);
+        stage.decim = decim / (1 << halfbands);
+        stage.halfband = false;
+        if (stage.decim > 1)
+        {
+            stage.taps = gr_firdes::low_pass(1.0, rate, cutoff, trans_width,
+                                             gr_firdes::WIN_HAMMING, 6.76);
+            candidate.push_back(stage);
+
+            input_frac /= stage.decim;
+            macs += MACS_CCF * stage.taps.size() * input_frac;
+        }
+
+        if ((best_macs < 0.0) || (macs < best_macs))
+        {
+            best_macs = macs;
+            stages = candidate;
+        }
+
+        if (stage.decim == 1)
+            break;
+    }
+
+    if (arb_rate != 1.0)
+    {
+        /* polyphase arbitrary resampler; each output uses taps/nfilts taps */
+        rate = in_rate / decim;
+        std::vector<float> taps = gr_firdes::low_pass(ARB_NFILTS, ARB_NFILTS*rate, cutoff,
+                                                      trans_width, gr_firdes::WIN_HAMMING, 6.76);
+        best_macs += MACS_CCF * taps.size() / ARB_NFILTS * out_rate / in_rate;
+    }
+
+    return best_macs;
+}
+
+
+/*! \brief Create and connect blocks according to a new plan.
+ *
+ * The caller is responsible for locking the flow graph and disconnecting
+ * the old blocks.
+ */
+void rx_decimator_cc::configure()
+{
+    unsigned int i;
+
+    d_plan_macs = plan(d_in_rate, d_out_rate, d_cutoff, d_trans_width, d_plan, d_arb_rate);
+
+    d_fir.clear();
+    d_arb.reset();
+
+    d_rot = make_rx_rotator_cc(d_in_rate, -d_offset);
+    connect(self(), 0, d_rot, 0);
+
+    gr_basic_block_sptr last = d_rot;
+    for (i = 0; i < d_plan.size(); i++)
+    {
+        if (d_plan[i].halfband)
+            d_fir.push_back(make_rx_halfband_cc(d_plan[i].taps));
+        else
+            d_fir.push_back(gr_make_fir_filter_ccf(d_plan[i].decim, d_plan[i].taps));
+        connect(last, 0, d_fir.back(), 0);
+        last = d_fir.back();
+    }
+
+    design_band_pass();
+    d_bpf = gr_make_fir_filter_ccc(1, d_bpf_taps);
+    connect(last, 0, d_bpf, 0);
+    last = d_bpf;
+
+    if (d_arb_rate != 1.0)
+    {
+        double rate = d_out_rate / d_arb_rate;
+        std::vector<float> taps = gr_firdes::low_pass(ARB_NFILTS, ARB_NFILTS*rate, d_cutoff,
+                                                      d_trans_width, gr_firdes::WIN_HAMMING, 6.76);
+        d_arb = gr_make_pfb_arb_resampler_ccf(d_arb_rate, taps, ARB_NFILTS);
+        connect(last, 0, d_arb, 0);
+        last = d_arb;
+    }
+
+    connect(last, 0, self(), 0);
+}
+
+
+/*! \brief Generate new channel filter taps.
+ *
+ * The channel filter runs at the output rate of the last decimation stage,
+ * i.e. before the arbitrary resampler. The filter edges are limited to the
+ * Nyquist bandwidth at that rate. The MAC count is updated to include the
+ * new filter.
+ */
+void rx_decimator_cc::design_band_pass()
+{
+    double rate = d_out_rate / d_arb_rate;
+    double edge = 0.5 * (rate - d_bp_tw);
+    double low = d_low;
+    double high = d_high;
+
+    if (low < -edge)
+        low = -edge;
+    if (high > edge)
+        high = edge;
+    if (low >= high)
+    {
+        low = -edge;
+        high = edge;
+    }
+
+    d_bpf_taps = gr_firdes::complex_band_pass(1.0, rate, low, high, d_bp_tw);
+    d_macs = d_plan_macs + MACS_CCC * d_bpf_taps.size() * rate / d_in_rate;
+}
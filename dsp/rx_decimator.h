@@ -0,0 +1,141 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RX_DECIMATOR_H
+#define RX_DECIMATOR_H
+
+#include <gr_hier_block2.h>
+#include <gr_fir_filter_ccf.h>
+#include <gr_fir_filter_ccc.h>
+#include <gr_pfb_arb_resampler_ccf.h>
+#include <vector>
+#include "dsp/rx_rotator.h"
+#include "dsp/rx_halfband.h"
+
+
+class rx_decimator_cc;
+
+
+typedef boost::shared_ptr<rx_decimator_cc> rx_decimator_cc_sptr;
+
+
+/*! \brief Return a shared_ptr to a new instance of rx_decimator_cc.
+ *  \param in_rate The input sample rate.
+ *  \param out_rate The output sample rate.
+ *  \param cutoff The maximum channel cutoff frequency (passband edge).
+ *  \param trans_width The transition width used by the decimation stages.
+ *  \param offset The initial frequency offset (see set_offset()).
+ *
+ * This is effectively the public constructor. To avoid accidental use
+ * of raw pointers, rx_decimator_cc's constructor is private.
+ * make_rx_decimator_cc is the public interface for creating new instances.
+ */
+rx_decimator_cc_sptr make_rx_decimator_cc(double in_rate, double out_rate,
+                                          double cutoff, double trans_width,
+                                          double offset=0.0);
+
+
+/*! \brief One stage in a decimation plan. */
+struct rx_decim_stage {
+    int                 decim;     /*!< Decimation of this stage. */
+    bool                halfband;  /*!< Half-band stage, see rx_halfband_cc. */
+    std::vector<float>  taps;      /*!< Filter taps. */
+};
+
+
+/*! \brief Multi-stage frequency translating decimator and channel filter.
+ *  \ingroup DSP
+ *
+ * This block replaces a single frequency xlating FIR filter running at the
+ * full input rate followed by a separate band pass filter with a cascade of
+ * cheaper stages:
+ *
+ *   - A rotator that moves the selected offset to DC.
+ *   - N half-band stages each decimating by 2. The transition band of these
+ *     stages only has to protect the channel passband (+/- cutoff) from
+ *     aliasing so they need very few taps while the sample rate is high,
+ *     and half of the taps are zero and skipped by rx_halfband_cc.
+ *   - A polyphase stage with real taps that decimates by the remaining
+ *     integer factor. This stage is omitted when the half-band stages
+ *     provide all the decimation.
+ *   - The channel filter, a band pass filter with complex taps running at
+ *     the lowest rate, see set_band_pass().
+ *   - An arbitrary resampler if out_rate is not an integer fraction of in_rate.
+ *
+ * Tuning only changes the phase increment of the rotator and changing the
+ * channel filter only recalculates the taps of the last filter stage. The
+ * number of half-band stages is chosen by plan() so that the total number of
+ * multiply-accumulate operations per input sample is minimal. The plan is
+ * recalculated when the sample rates or the cutoff change.
+ */
+class rx_decimator_cc : public gr_hier_block2
+{
+
+public:
+    rx_decimator_cc(double in_rate, double out_rate, double cutoff, double trans_width, double offset); // FIXME: should be private
+    ~rx_decimator_cc();
+
+    void set_offset(double offset);
+    double offset() { return d_offset; }
+
+    void set_band_pass(double low, double high, double trans_width);
+    void set_rates(double in_rate, double out_rate);
+    void set_cutoff(double cutoff, double trans_width);
+    void set_params(double in_rate, double out_rate, double cutoff, double trans_width);
+
+    double in_rate() { return d_in_rate; }
+    double out_rate() { return d_out_rate; }
+
+    /*! \brief Number of filter stages in the current plan. */
+    unsigned int num_stages() { return d_plan.size(); }
+
+    /*! \brief Number of MACs per input sample required by the current plan. */
+    double macs_per_sample() { return d_macs; }
+
+    static double plan(double in_rate, double out_rate, double cutoff, double trans_width,
+                       std::vector<rx_decim_stage> &stages, double &arb_rate);
+
+private:
+    void configure();
+    void design_band_pass();
+
+    rx_rotator_cc_sptr                   d_rot;    /*! Frequency translation. */
+    std::vector<gr_basic_block_sptr>     d_fir;    /*! Decimation stages. */
+    gr_fir_filter_ccc_sptr               d_bpf;    /*! Channel filter. */
+    gr_pfb_arb_resampler_ccf_sptr        d_arb;    /*! Optional arbitrary resampler. */
+    std::vector<gr_complex>              d_bpf_taps; /*! Channel filter taps. */
+
+    std::vector<rx_decim_stage>  d_plan;  /*! The current decimation plan. */
+    double  d_arb_rate;     /*! Resampling ratio of the arbitrary resampler (1.0 if not used). */
+    double  d_plan_macs;    /*! MACs per input sample excluding the channel filter. */
+    double  d_macs;         /*! MACs per input sample. */
+
+    double  d_in_rate;      /*! Input sample rate. */
+    double  d_out_rate;     /*! Output sample rate. */
+    double  d_cutoff;       /*! Maximum channel cutoff. */
+    double  d_trans_width;  /*! Transition width of the decimation stages. */
+    double  d_offset;       /*! Frequency offset moved to DC. */
+    double  d_low;          /*! Lower edge of the channel filter. */
+    double  d_high;         /*! Upper edge of the channel filter. */
+    double  d_bp_tw;        /*! Transition width of the channel filter. */
+
+};
+
+
+#endif // RX_DECIMATOR_H
@@ -17,8 +17,19 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
+#include <math.h>
+#include <string.h>
 #include <gr_io_signature.h>
 #include <dsp/rx_demod_am.h>
+#include "dsp/fast_math.h"
+
+
+#define PLL_RANGE     1000.0   /* Carrier PLL tracking range in Hz. */
+#define PLL_BW        30.0     /* Carrier PLL noise bandwidth in Hz. */
+#define PLL_LP        150.0    /* Cut-off of the carrier filter in Hz. */
+#define PLL_LOCK      0.8f     /* Lock threshold of d_lock. */
+#define DCR_TAU       0.05     /* Time constant of the carrier level in seconds. */
+#define HILBERT_LEN   129      /* Hilbert transformer length, odd. */
 
 
 /* Create a new instance of rx_demod_am and return a boost shared_ptr. */
@@ -34,30 +45,76 @@ static const int MIN_OUT = 1; /* Minimum number of output streams. */
 static const int MAX_OUT = 1; /* Maximum number of output streams. */
 
 
+/*! \brief Dot product of filter taps and samples.
+ *
+ * Four partial sums so that the loop can be vectorized without
+ * reordering floating point additions.
+ */
+static inline float dot4(const float *h, const float *x, int ntaps)
+{
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int k;
+
+    for (k = 0; k < ntaps; k += 4)
+    {
+        s0 += h[k] * x[k];
+        s1 += h[k+1] * x[k+1];
+        s2 += h[k+2] * x[k+2];
+        s3 += h[k+3] * x[k+3];
+    }
+
+    return (s0 + s1) + (s2 + s3);
+}
+
 
 rx_demod_am::rx_demod_am(float quad_rate, float audio_rate, bool dcr)
-    : gr_hier_block2 ("rx_demod_am",
-                      gr_make_io_signature (MIN_IN, MAX_IN, sizeof (gr_complex)),
-                      gr_make_io_signature (MIN_OUT, MAX_OUT, sizeof (float))),
+    : gr_sync_block ("rx_demod_am",
+                     gr_make_io_signature (MIN_IN, MAX_IN, sizeof (gr_complex)),
+                     gr_make_io_signature (MIN_OUT, MAX_OUT, sizeof (float))),
+    d_params_seen(0),
     d_quad_rate(quad_rate),
     d_audio_rate(audio_rate),
-    d_dcr_enabled(dcr)
+    d_nco(1.0, 0.0),
+    d_nco_step(1.0, 0.0),
+    d_pll_freq(0.0),
+    d_lp1(0.0, 0.0),
+    d_lp2(0.0, 0.0),
+    d_prev(0.0, 0.0),
+    d_lock(0.0),
+    d_carrier(0.0),
+    d_idle(false)
 {
+    const int m = HILBERT_LEN / 2;
+    double wn, w;
+    int i;
 
-    /* demodulator */
-    d_demod = gr_make_complex_to_mag(1);
+    /* carrier PLL, 2nd order loop updated every AM_PLL_BLOCK samples */
+    d_pll_max = 2.0 * M_PI * PLL_RANGE / quad_rate;
+    wn = 2.0 * PLL_BW / (M_SQRT1_2 + 1.0 / (4.0 * M_SQRT1_2)) * AM_PLL_BLOCK / quad_rate;
+    d_pll_kp = 2.0 * M_SQRT1_2 * wn;
+    d_pll_ki = wn * wn / AM_PLL_BLOCK;
+    d_fll_k = 0.1 / AM_PLL_BLOCK;
+    d_lp_alpha = 1.0 - exp(-2.0 * M_PI * PLL_LP * AM_PLL_BLOCK / quad_rate);
 
-    /* DC removal */
-    if (d_dcr_enabled)
-        d_dcr = gr_make_add_const_ff(-1.0);
-    else
-        d_dcr = gr_make_add_const_ff(0.0);
+    d_dc_alpha = AM_PLL_BLOCK / (DCR_TAU * quad_rate);
 
-    /* connect blocks */
-    connect(self(), 0, d_demod, 0);
-    connect(d_demod, 0, d_dcr, 0);
-    connect(d_dcr, 0,  self(), 0);
+    /* Hilbert transformer, h[n] = 2 / (pi n) for odd n, Hamming window */
+    d_ntaps = (HILBERT_LEN + 3) & ~3;
+    d_taps.assign(d_ntaps, 0.0f);
+    for (i = 1; i <= m; i += 2)
+    {
+        w = 0.54 + 0.46 * cos(M_PI * i / m);
+        d_taps[d_ntaps - 1 - m - i] = 2.0 / (M_PI * i) * w;
+        d_taps[d_ntaps - 1 - m + i] = -2.0 / (M_PI * i) * w;
+    }
+    d_delay = d_ntaps - 1 - m;
+    d_re.assign(d_ntaps - 1 + AM_CHUNK, 0.0f);
+    d_im.assign(d_ntaps - 1 + AM_CHUNK, 0.0f);
 
+    d_set.mode = MODE_ENV;
+    d_set.dcr = dcr;
+    d_params.write(d_set);
+    d_params.read(d_cur, d_params_seen);
 }
 
 
@@ -67,26 +124,246 @@ rx_demod_am::~rx_demod_am ()
 }
 
 
+/*! \brief Demodulate AM.
+ *
+ * The input is processed in chunks of at most AM_CHUNK samples.
+ */
+int rx_demod_am::work(int noutput_items,
+                      gr_vector_const_void_star &input_items,
+                      gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    float *out = (float *) output_items[0];
+    int done, num;
+
+    d_params.read(d_cur, d_params_seen);
+
+    noutput_items = d_gate.update(this, noutput_items);
+    if (!d_gate.open()) {
+        /* squelch closed, the input is zero */
+        if (!d_idle) {
+            memset(&d_re[0], 0, d_re.size() * sizeof(float));
+            memset(&d_im[0], 0, d_im.size() * sizeof(float));
+            d_idle = true;
+        }
+        memset(out, 0, noutput_items * sizeof(float));
+        return noutput_items;
+    }
+    d_idle = false;
+
+    for (done = 0; done < noutput_items; done += num)
+    {
+        num = noutput_items - done;
+        num = (num < AM_CHUNK) ? num : AM_CHUNK;
+
+        if (d_cur.mode == MODE_ENV)
+            envelope(in + done, out + done, num);
+        else
+            synchronous(in + done, out + done, num);
+    }
+
+    return noutput_items;
+}
+
+
+/*! \brief Envelope detector.
+ *  \param in The input samples.
+ *  \param out The output buffer.
+ *  \param num The number of samples.
+ *
+ * The carrier level is the average of the envelope.
+ */
+void rx_demod_am::envelope(const gr_complex *in, float *out, int num)
+{
+    float c, sum;
+    int i, k, n;
+
+    fm_mag(in, out, num);
+
+    for (i = 0; i < num; i += n)
+    {
+        n = num - i;
+        n = (n < AM_PLL_BLOCK) ? n : AM_PLL_BLOCK;
+
+        sum = 0.0f;
+        for (k = 0; k < n; k++)
+            sum += out[i+k];
+
+        c = d_cur.dcr ? d_carrier : 0.0f;
+        for (k = 0; k < n; k++)
+            out[i+k] -= c;
+
+        d_carrier += (sum / n - d_carrier) * d_dc_alpha * n / AM_PLL_BLOCK;
+    }
+}
+
+
+/*! \brief Synchronous detector.
+ *  \param in The input samples.
+ *  \param out The output buffer.
+ *  \param num The number of samples, at most AM_CHUNK.
+ *
+ * The input is mixed down with the carrier oscillator. The in-phase
+ * signal contains both sidebands and the carrier; the carrier level is
+ * its average. For single sideband reception the Hilbert transform of
+ * the quadrature signal is added to or subtracted from the in-phase
+ * signal, which is delayed by the same amount.
+ */
+void rx_demod_am::synchronous(const gr_complex *in, float *out, int num)
+{
+    const float *iq = (const float *) in;
+    float *re = &d_re[d_ntaps - 1];
+    float *im = &d_im[d_ntaps - 1];
+    float osc_re[AM_PLL_BLOCK];
+    float osc_im[AM_PLL_BLOCK];
+    float sum_re, sum_im, c;
+    gr_complex osc;
+    int i, k, n;
+
+    for (i = 0; i < num; i += n)
+    {
+        n = num - i;
+        n = (n < AM_PLL_BLOCK) ? n : AM_PLL_BLOCK;
+
+        /* oscillator for this block */
+        osc = d_nco;
+        for (k = 0; k < n; k++)
+        {
+            osc_re[k] = osc.real();
+            osc_im[k] = osc.imag();
+            osc *= d_nco_step;
+        }
+        d_nco = osc;
+
+        /* mix down with the conjugate of the oscillator */
+        for (k = 0; k < n; k++)
+        {
+            re[i+k] = iq[2*(i+k)] * osc_re[k] + iq[2*(i+k)+1] * osc_im[k];
+            im[i+k] = iq[2*(i+k)+1] * osc_re[k] - iq[2*(i+k)] * osc_im[k];
+        }
+
+        sum_re = sum_im = 0.0f;
+        for (k = 0; k < n; k++)
+        {
+            sum_re += re[i+k];
+            sum_im += im[i+k];
+        }
+
+        c = d_cur.dcr ? d_carrier : 0.0f;
+        for (k = 0; k < n; k++)
+            re[i+k] -= c;
+
+        pll_update(sum_re, sum_im, n);
+    }
+
+    switch (d_cur.mode)
+    {
+    case MODE_USB:
+        for (i = 0; i < num; i++)
+            out[i] = d_re[i + d_delay] - dot4(&d_taps[0], &d_im[i], d_ntaps);
+        break;
+
+    case MODE_LSB:
+        for (i = 0; i < num; i++)
+            out[i] = d_re[i + d_delay] + dot4(&d_taps[0], &d_im[i], d_ntaps);
+        break;
+
+    case MODE_DSB:
+    default:
+        memcpy(out, re, num * sizeof(float));
+        break;
+    }
+
+    /* keep history for the Hilbert transformer */
+    memmove(&d_re[0], &d_re[num], (d_ntaps - 1) * sizeof(float));
+    memmove(&d_im[0], &d_im[num], (d_ntaps - 1) * sizeof(float));
+}
+
+
+/*! \brief Update the carrier PLL and the carrier level.
+ *  \param sum_re Sum of the in-phase signal over the last block.
+ *  \param sum_im Sum of the quadrature signal over the last block.
+ *  \param num The number of samples in the block.
+ *
+ * The block sums are low pass filtered to remove the sidebands, so the
+ * loop holds when the carrier fades below the sidebands. The phase
+ * detector is the angle of the filtered carrier, which is the same for
+ * any modulation depth and AGC gain. Until the loop is locked, the
+ * rotation of the carrier between updates pulls in the frequency.
+ */
+void rx_demod_am::pll_update(float sum_re, float sum_im, int num)
+{
+    const float scale = (float) num / AM_PLL_BLOCK;
+    const float alpha = d_lp_alpha * scale;
+    gr_complex rot;
+    float err;
+
+    d_lp1 += (gr_complex(sum_re, sum_im) / (float) num - d_lp1) * alpha;
+    d_lp2 += (d_lp1 - d_lp2) * alpha;
+    err = fast_atan2f(d_lp2.imag(), d_lp2.real());
+
+    d_lock += (cos(err) - d_lock) * 0.01f * scale;
+    if (d_lock < PLL_LOCK)
+    {
+        rot = d_lp2 * conj(d_prev);
+        d_pll_freq += d_fll_k * fast_atan2f(rot.imag(), rot.real());
+    }
+    d_prev = d_lp2;
+
+    d_pll_freq += d_pll_ki * scale * err;
+    d_pll_freq = (d_pll_freq < -d_pll_max) ? -d_pll_max : d_pll_freq;
+    d_pll_freq = (d_pll_freq > d_pll_max) ? d_pll_max : d_pll_freq;
+    d_nco_step = gr_complex(cos(d_pll_freq), sin(d_pll_freq));
+
+    /* phase correction and amplitude normalization */
+    d_nco *= gr_complex(1.0f, d_pll_kp * scale * err);
+    d_nco *= 1.5f - 0.5f * norm(d_nco);
+    d_nco *= 1.5f - 0.5f * norm(d_nco);
+
+    d_carrier += (sum_re / num - d_carrier) * d_dc_alpha * scale;
+}
+
+
 /*! \brief Set DCR status.
  *  \param dcr The new status (on or off).
  */
 void rx_demod_am::set_dcr(bool dcr)
 {
-    if (dcr == d_dcr_enabled) {
-        return;
-    }
+    boost::mutex::scoped_lock lock(d_mutex);
 
-    if (dcr)
-        d_dcr->set_k(-1.0);
-    else
-        d_dcr->set_k(0.0);
-
-    d_dcr_enabled = dcr;
+    d_set.dcr = dcr;
+    d_params.write(d_set);
 }
 
 
 /*! \brief Get current DCR status. */
 bool rx_demod_am::dcr()
 {
-    return d_dcr_enabled;
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    return d_set.dcr;
+}
+
+
+/*! \brief Select the detector.
+ *  \param mode The new detector, see rx_demod_am::mode.
+ */
+void rx_demod_am::set_mode(int mode)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    if ((mode < MODE_ENV) || (mode > MODE_LSB))
+        return;
+
+    d_set.mode = mode;
+    d_params.write(d_set);
+}
+
+
+/*! \brief Get the current detector. */
+int rx_demod_am::get_mode()
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    return d_set.mode;
 }
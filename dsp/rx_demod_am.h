@@ -20,9 +20,24 @@
 #ifndef RX_DEMOD_AM_H
 #define RX_DEMOD_AM_H
 
-#include <gr_hier_block2.h>
-#include <gr_complex_to_xxx.h>
-#include <gr_add_const_ff.h>
+#include <gr_sync_block.h>
+#include <gr_complex.h>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+#include "dsp/lockfree.h"
+#include "dsp/rx_squelch.h"
+
+
+#define AM_CHUNK      4096   /*!< Samples processed per pass. */
+#define AM_PLL_BLOCK  16     /*!< Samples per carrier PLL update. */
+
+
+/*! \brief Parameters passed from the setters to work(). */
+struct rx_demod_am_params
+{
+    int   mode;    /*!< Detector, see rx_demod_am::mode. */
+    bool  dcr;     /*!< Whether the carrier is removed. */
+};
 
 
 class rx_demod_am;
@@ -44,32 +59,88 @@ rx_demod_am_sptr make_rx_demod_am(float quad_rate, float audio_rate, bool dcr=tr
 /*! \brief AM demodulator.
  *  \ingroup DSP
  *
- * This class implements the AM demodulator.
- * AM demodulation is simply a conversion from complex to magnitude.
- * This block does not include any audio filter.
+ * This class implements the AM demodulator. It can be used as an envelope
+ * detector or as a synchronous detector, where a PLL locks to the carrier
+ * and the signal is mixed down with it. The synchronous detector does not
+ * distort when the carrier fades selectively and can receive both or only
+ * one of the sidebands; the other sideband is cancelled using a Hilbert
+ * transformer.
+ *
+ * The carrier level is tracked and subtracted from the output (DC removal),
+ * so the output is independent of the AGC setting.
  *
+ * This block does not include any audio filter.
  */
-class rx_demod_am : public gr_hier_block2
+class rx_demod_am : public gr_sync_block
 {
+    friend rx_demod_am_sptr make_rx_demod_am(float quad_rate, float audio_rate, bool dcr);
+
+public:
+    /*! \brief Available detectors. */
+    enum mode {
+        MODE_ENV = 0,  /*!< Envelope detector. */
+        MODE_DSB = 1,  /*!< Synchronous, both sidebands. */
+        MODE_USB = 2,  /*!< Synchronous, upper sideband. */
+        MODE_LSB = 3   /*!< Synchronous, lower sideband. */
+    };
+
+protected:
+    rx_demod_am(float quad_rate, float audio_rate, bool dcr);
 
 public:
-    rx_demod_am(float quad_rate=48000.0, float audio_rate=48000.0, bool dcr=true); // FIXME: could be private
     ~rx_demod_am();
 
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
     void set_dcr(bool dcr);
     bool dcr();
 
-private:
-    /* GR blocks */
-    gr_complex_to_mag_sptr  d_demod;   /*! AM demodulation (complex to magnitude). */
-    gr_add_const_ff_sptr    d_dcr;     /*! DC removal (substract 1.0). */
+    void set_mode(int mode);
+    int  get_mode();
 
+private:
+    rx_seqlock<rx_demod_am_params> d_params;  /*! Parameters for work(). */
+    unsigned int        d_params_seen;  /*! Last parameters picked up by work(). */
+    rx_demod_am_params  d_set;          /*! Parameters set by the GUI. */
+    rx_demod_am_params  d_cur;          /*! Parameters used by work(). */
+    boost::mutex        d_mutex;        /*! Serializes the setters. */
 
-    /* other parameters */
     float  d_quad_rate;     /*! Quadrature rate. */
     float  d_audio_rate;    /*! Audio rate. */
-    bool   d_dcr_enabled;   /*! DC removal flag. */
 
+    /* carrier PLL */
+    gr_complex d_nco;       /*! Carrier oscillator. */
+    gr_complex d_nco_step;  /*! Carrier oscillator increment. */
+    float      d_pll_freq;  /*! Carrier frequency in rad/sample. */
+    float      d_pll_max;   /*! Highest carrier frequency (either side). */
+    float      d_pll_kp;    /*! Proportional gain of the loop filter. */
+    float      d_pll_ki;    /*! Integral gain of the loop filter. */
+    float      d_fll_k;     /*! Gain of the frequency detector during acquisition. */
+    float      d_lp_alpha;  /*! Carrier filter coefficient. */
+    gr_complex d_lp1;       /*! Carrier filter, 1st stage. */
+    gr_complex d_lp2;       /*! Carrier filter, 2nd stage (the carrier estimate). */
+    gr_complex d_prev;      /*! Carrier estimate at the previous update. */
+    float      d_lock;      /*! Lock indicator, averaged cos of the phase error. */
+
+    /* DC removal */
+    float      d_carrier;   /*! Carrier level. */
+    float      d_dc_alpha;  /*! Carrier level averaging per AM_PLL_BLOCK. */
+
+    /* sideband selection */
+    int                d_ntaps;  /*! Hilbert transformer length (multiple of 4). */
+    int                d_delay;  /*! Delay of the in-phase signal in d_re. */
+    std::vector<float> d_taps;   /*! Hilbert transformer, reversed. */
+    std::vector<float> d_re;     /*! History and in-phase signal. */
+    std::vector<float> d_im;     /*! History and quadrature signal. */
+
+    rx_squelch_gate d_gate;     /*! Squelch state of the input. */
+    bool            d_idle;     /*! Idle since the squelch closed. */
+
+    void envelope(const gr_complex *in, float *out, int num);
+    void synchronous(const gr_complex *in, float *out, int num);
+    void pll_update(float sum_re, float sum_im, int num);
 };
 
 
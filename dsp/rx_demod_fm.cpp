@@ -20,8 +20,10 @@
 #include <gr_io_signature.h>
 #include <gr_firdes.h>
 #include <dsp/rx_demod_fm.h>
+#include <dsp/fast_math.h>
+#include <dsp/lockfree.h>
 #include <math.h>
-#include <iostream>
+#include <string.h>
 
 
 /* Create a new instance of rx_demod_fm and return a boost shared_ptr. */
@@ -37,48 +39,292 @@ static const int MIN_OUT = 1; /* Minimum number of output streams. */
 static const int MAX_OUT = 1; /* Maximum number of output streams. */
 
 
+/*! \brief Greatest common divisor. */
+static unsigned int gcd(unsigned int a, unsigned int b)
+{
+    unsigned int c;
+
+    while (b != 0)
+    {
+        c = a % b;
+        a = b;
+        b = c;
+    }
+
+    return a;
+}
+
+
+/*! \brief Calculate the discriminator, de-emphasis and resampler parameters.
+ *  \param quad_rate The input sample rate.
+ *  \param audio_rate The output sample rate.
+ *  \param max_dev Maximum deviation in Hz.
+ *  \param tau De-emphasis time constant in seconds, 0.0 disables de-emphasis.
+ */
+rx_demod_fm_config::rx_demod_fm_config(double quad_rate, double audio_rate, float max_dev, double tau)
+{
+    std::vector<float> proto;
+    unsigned int g;
+    double w_pp;
+    int p, k, n;
+
+    gain = quad_rate / (2.0 * M_PI * max_dev);
+
+    /* de-emphasis, see fm_emph.py in gnuradio-core. The filter is
+       y[n] = b0*(x[n] + x[n-1]) - a1*y[n-1], i.e. the pole is at -a1 > 0
+       and the gain is 1 at DC. gr_iir_filter_ffd adds its feedback taps,
+       so the former [1, a1] feedback put the pole at a1 < 0, which gave a
+       flat attenuation of 13-28 dB depending on the rate and no
+       de-emphasis at all. */
+    deemph = (tau > 1.0e-9);
+    w_pp = deemph ? tan(1.0 / (tau * quad_rate * 2.0)) : 0.0; /* prewarped analog freq */
+    b0 = w_pp / (1.0 + w_pp);
+    a1 = (w_pp - 1.0) / (w_pp + 1.0);
+
+    /* rational resampler; the filter runs at interp times the input rate
+       and its cutoff is relative to the lower of the two rates */
+    g = gcd((unsigned int) quad_rate, (unsigned int) audio_rate);
+    interp = (unsigned int) audio_rate / g;
+    decim = (unsigned int) quad_rate / g;
+
+    float fract_bw = 0.4;
+    float trans_width = 0.5 - fract_bw;
+    float mid_trans_band = 0.5 - trans_width/2.0;
+    float scale = (interp > decim) ? interp : decim;
+
+    proto = gr_firdes::low_pass(interp, 1.0,
+                                mid_trans_band/scale,
+                                trans_width/scale,
+                                gr_firdes::WIN_KAISER,
+                                5.0);
+
+    /* Polyphase filter p gets taps p, p+interp, p+2*interp, ... like in
+     * gr_rational_resampler_base. The taps are reversed so that the filter
+     * is a dot product with the samples in time order, and padded with
+     * zeros in front to a multiple of 4 for general_work().
+     */
+    ntaps = (proto.size() + interp - 1) / interp;
+    if (ntaps < (decim + interp - 1) / interp)
+        ntaps = (decim + interp - 1) / interp;  /* never skip past the buffer */
+    ntaps = (ntaps + 3) & ~3;
+    taps.assign(interp * ntaps, 0.0f);
+    for (p = 0; p < interp; p++)
+    {
+        for (k = 0; k < ntaps; k++)
+        {
+            n = p + (ntaps - 1 - k) * interp;
+            if (n < (int) proto.size())
+                taps[p * ntaps + k] = proto[n];
+        }
+    }
+
+    buf.assign(ntaps - 1 + FM_CHUNK, 0.0f);
+}
+
 
 rx_demod_fm::rx_demod_fm(float quad_rate, float audio_rate, float max_dev, double tau)
-    : gr_hier_block2 ("rx_demod_fm",
-                      gr_make_io_signature (MIN_IN, MAX_IN, sizeof (gr_complex)),
-                      gr_make_io_signature (MIN_OUT, MAX_OUT, sizeof (float))),
+    : gr_block ("rx_demod_fm",
+                gr_make_io_signature (MIN_IN, MAX_IN, sizeof (gr_complex)),
+                gr_make_io_signature (MIN_OUT, MAX_OUT, sizeof (float))),
+    d_pending(0),
+    d_retired(0),
     d_quad_rate(quad_rate),
     d_audio_rate(audio_rate),
     d_max_dev(max_dev),
-    d_tau(tau)
+    d_tau(tau > 1.0e-9 ? tau : 0.0),
+    d_last(0.0, 0.0),
+    d_x1(0.0),
+    d_y1(0.0),
+    d_phase(0),
+    d_idle(false)
 {
-    float gain;
+    d_cfg = new rx_demod_fm_config(d_quad_rate, d_audio_rate, d_max_dev, d_tau);
+    d_hist = d_cfg->ntaps - 1;
+    set_relative_rate((double) d_cfg->interp / d_cfg->decim);
+}
+
 
-    /* demodulator gain */
-    gain = d_quad_rate / (2.0 * M_PI * d_max_dev);
+rx_demod_fm::~rx_demod_fm ()
+{
+    delete d_cfg;
+    delete d_pending;
+    delete d_retired;
+}
 
-    //std::cout << "G: " << gain << std::endl;
 
-    /* demodulator */
-    d_quad = gr_make_quadrature_demod_cf(gain);
+void rx_demod_fm::forecast(int noutput_items, gr_vector_int &ninput_items_required)
+{
+    ninput_items_required[0] = (noutput_items * d_cfg->decim) / d_cfg->interp + 1;
+}
 
-    /* de-emphasis */
-    d_fftaps.resize(2);
-    d_fbtaps.resize(2);
-    calculate_iir_taps(d_tau);
-    d_deemph = gr_make_iir_filter_ffd(d_fftaps, d_fbtaps);
 
-    /* connect block */
-    connect(self(), 0, d_quad, 0);
-    if (d_tau > 1.0e-9) {
-        connect(d_quad, 0, d_deemph, 0);
-        connect(d_deemph, 0, self(), 0);
+/*! \brief Demodulate and resample FM.
+ *
+ * The input is processed in chunks of at most FM_CHUNK samples that are
+ * demodulated into the filter buffer, after the samples still needed by
+ * the resampler. Only as many samples are taken as are needed for
+ * noutput_items, so the buffer never holds more than FM_CHUNK samples
+ * ahead of the filter.
+ *
+ * While the squelch is closed the discriminator and the filter are
+ * skipped and zeros are output at the same rate.
+ */
+int rx_demod_fm::general_work(int noutput_items,
+                              gr_vector_int &ninput_items,
+                              gr_vector_const_void_star &input_items,
+                              gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    float *out = (float *) output_items[0];
+    rx_demod_fm_config *cfg;
+    const float *h, *x;
+    float s0, s1, s2, s3;
+    int nt, num, need, total, pos, i, k;
+
+    /* pick up new parameters; the GUI deletes the old configuration */
+    cfg = rx_exchange_ptr(&d_pending, (rx_demod_fm_config *) 0);
+    if (cfg) {
+        if ((cfg->interp == d_cfg->interp) && (cfg->decim == d_cfg->decim) &&
+            (cfg->ntaps == d_cfg->ntaps)) {
+            /* same resampler, keep the samples it has not used yet */
+            memcpy(&cfg->buf[0], &d_cfg->buf[0], d_hist * sizeof(float));
+        }
+        else {
+            d_hist = cfg->ntaps - 1;
+            d_phase = 0;
+        }
+        delete rx_exchange_ptr(&d_retired, d_cfg);  /* normally NULL */
+        d_cfg = cfg;
+    }
+    cfg = d_cfg;
+    nt = cfg->ntaps;
+
+    /* samples needed to produce noutput_items */
+    need = (d_phase + (noutput_items - 1) * cfg->decim) / cfg->interp + nt - d_hist;
+    num = d_gate.update(this, ninput_items[0]);
+    num = (num < need) ? num : need;
+    num = (num < (int) cfg->buf.size() - d_hist) ? num : (int) cfg->buf.size() - d_hist;
+    num = (num > 0) ? num : 0;
+
+    if (d_gate.open()) {
+        demodulate(in, &cfg->buf[d_hist], num);
+        d_idle = false;
     }
     else {
-        connect(d_quad, 0, self(), 0);
+        /* squelch closed, the input is zero; restart from silence */
+        memset(&cfg->buf[d_hist], 0, num * sizeof(float));
+        d_last = gr_complex(0.0, 0.0);
+        d_x1 = 0.0;
+        d_y1 = 0.0;
+        d_idle = true;
+    }
+    total = d_hist + num;
+
+    /* polyphase resampler, same sequence as gr_rational_resampler_base */
+    pos = 0;
+    for (i = 0; (i < noutput_items) && (pos + nt <= total); i++)
+    {
+        if (d_idle)
+        {
+            out[i] = 0.0f;
+        }
+        else
+        {
+            h = &cfg->taps[d_phase * nt];
+            x = &cfg->buf[pos];
+            s0 = s1 = s2 = s3 = 0.0f;
+            for (k = 0; k < nt; k += 4)
+            {
+                s0 += h[k] * x[k];
+                s1 += h[k+1] * x[k+1];
+                s2 += h[k+2] * x[k+2];
+                s3 += h[k+3] * x[k+3];
+            }
+            out[i] = (s0 + s1) + (s2 + s3);
+        }
+
+        d_phase += cfg->decim;
+        pos += d_phase / cfg->interp;
+        d_phase %= cfg->interp;
     }
 
+    /* keep the samples the next output still needs */
+    d_hist = total - pos;
+    memmove(&cfg->buf[0], &cfg->buf[pos], d_hist * sizeof(float));
+
+    consume_each(num);
+
+    return i;
 }
 
 
-rx_demod_fm::~rx_demod_fm ()
+/*! \brief Discriminator and de-emphasis.
+ *  \param in The input samples.
+ *  \param out The audio at the input rate.
+ *  \param num The number of samples.
+ *
+ * The phase difference between consecutive samples is the argument of
+ * x[n] * conj(x[n-1]), like in gr_quadrature_demod_cf. The discriminator
+ * loop has no dependencies between iterations and is vectorized; only the
+ * first order de-emphasis filter runs sample by sample. The error of
+ * fast_atan2f() is at most 2e-6 * gain per sample, e.g. 1.5e-5 at 240 ksps
+ * and 5 kHz deviation.
+ */
+void rx_demod_fm::demodulate(const gr_complex *in, float *out, int num)
+{
+    const float *iq = (const float *) in;
+    const float gain = d_cfg->gain;
+    const float b0 = d_cfg->b0;
+    const float a1 = d_cfg->a1;
+    float re, im, x, x1, y1;
+    int i;
+
+    if (num <= 0)
+        return;
+
+    re = iq[0] * d_last.real() + iq[1] * d_last.imag();
+    im = iq[1] * d_last.real() - iq[0] * d_last.imag();
+    out[0] = gain * fast_atan2f(im, re);
+
+    for (i = 1; i < num; i++)
+    {
+        re = iq[2*i] * iq[2*i-2] + iq[2*i+1] * iq[2*i-1];
+        im = iq[2*i+1] * iq[2*i-2] - iq[2*i] * iq[2*i-1];
+        out[i] = gain * fast_atan2f(im, re);
+    }
+
+    d_last = in[num-1];
+
+    if (!d_cfg->deemph)
+        return;
+
+    x1 = d_x1;
+    y1 = d_y1;
+    for (i = 0; i < num; i++)
+    {
+        x = out[i];
+        y1 = b0 * (x + x1) - a1 * y1;
+        x1 = x;
+        out[i] = y1;
+    }
+    d_x1 = x1;
+    d_y1 = y1;
+}
+
+
+/*! \brief Create a new configuration and hand it over to general_work().
+ *
+ * Must be called with d_mutex locked.
+ */
+void rx_demod_fm::configure()
 {
+    rx_demod_fm_config *cfg = new rx_demod_fm_config(d_quad_rate, d_audio_rate, d_max_dev, d_tau);
 
+    /* delete configuration that general_work() is done with */
+    delete rx_exchange_ptr(&d_retired, (rx_demod_fm_config *) 0);
+
+    /* replace (and delete) configuration general_work() has not picked up yet */
+    delete rx_exchange_ptr(&d_pending, cfg);
 }
 
 
@@ -92,79 +338,55 @@ rx_demod_fm::~rx_demod_fm ()
  */
 void rx_demod_fm::set_max_dev(float max_dev)
 {
-    float gain;
+    boost::mutex::scoped_lock lock(d_mutex);
 
     if ((max_dev < 500.0) || (max_dev > d_quad_rate/2.0)) {
         return;
     }
 
     d_max_dev = max_dev;
-
-    gain = d_quad_rate / (2.0 * M_PI * max_dev);
-    d_quad->set_gain(gain);
-
+    configure();
 }
 
 
 /*! \brief Set FM de-emphasis time constant.
- *  \param tau The new time costant.
- *
- * \bug Assumes that IIR filter has already been constructed so that we
- *      can use the set_taps() method.
+ *  \param tau The new time costant, 0.0 disables de-emphasis.
  */
 void rx_demod_fm::set_tau(double tau)
 {
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    if (tau <= 1.0e-9)
+        tau = 0.0;
+
     if (fabs(tau - d_tau) < 1.0e-9) {
         /* no change */
         return;
     }
 
-    if (tau > 1.0e-9) {
-        calculate_iir_taps(tau);
-        d_deemph->set_taps(d_fftaps, d_fbtaps);
-
-        /* check to see if we need to rewire flow graph */
-        if (d_tau <= 1.0e-9) {
-            /* need to put deemph into the flowgraph */
-            lock();
-            disconnect(d_quad, 0, self(), 0);
-            connect(d_quad, 0, d_deemph, 0);
-            connect(d_deemph, 0, self(), 0);
-            unlock();
-        }
-
-        d_tau = tau;
-    }
-    else {
-        //std::cout << "TAU is 0: " << tau << std::endl;
-        /* diable de-emph if conencted */
-        if (d_tau > 1.0e-9) {
-            //std::cout << "  Disable deemph" << std::endl;
-            lock();
-            disconnect(d_quad, 0, d_deemph, 0);
-            disconnect(d_deemph, 0, self(), 0);
-            connect(d_quad, 0, self(), 0);
-            unlock();
-        }
-
-        d_tau = 0.0;
-    }
-
+    d_tau = tau;
+    configure();
 }
 
 
-/*! \brief Calculate taps for FM de-emph IIR filter. */
-void rx_demod_fm::calculate_iir_taps(double tau)
+/*! \brief Set new quadrature rate.
+ *  \param quad_rate The new quadrature rate in Hz.
+ *
+ * The gain of the quadrature demodulator, the de-emphasis filter and
+ * the resampler depend on the quadrature rate and are recalculated
+ * using the current maximum deviation and time constant. The relative
+ * rate changes too, so the flow graph must be locked while the block is
+ * connected.
+ */
+void rx_demod_fm::set_quad_rate(float quad_rate)
 {
-    /* copied from fm_emph.py in gnuradio-core */
-    double w_p, w_pp;
-
-    w_p = 1.0/tau;
-    w_pp = tan(w_p / (d_quad_rate * 2.0)); /* prewarped analog freq */
+    boost::mutex::scoped_lock lock(d_mutex);
 
-    d_fftaps[0] = w_pp/(1 + w_pp);
-    d_fftaps[1] = d_fftaps[0];
+    if (quad_rate == d_quad_rate) {
+        return;
+    }
 
-    d_fbtaps[0] = 1.0;
-    d_fbtaps[1] = (w_pp - 1)/(w_pp + 1);
+    d_quad_rate = quad_rate;
+    configure();
+    set_relative_rate((double) d_audio_rate / d_quad_rate);
 }
@@ -20,11 +20,35 @@
 #ifndef RX_DEMOD_FM_H
 #define RX_DEMOD_FM_H
 
-#include <gr_hier_block2.h>
-#include <gr_quadrature_demod_cf.h>
-#include <gr_iir_filter_ffd.h>
-#include <gr_pfb_arb_resampler_ccf.h>
+#include <gr_block.h>
+#include <gr_complex.h>
+#include <boost/thread/mutex.hpp>
 #include <vector>
+#include "dsp/rx_squelch.h"
+
+
+#define FM_CHUNK 4096   /*!< Samples demodulated per pass of rx_demod_fm. */
+
+
+/*! \brief Parameters and filters used by rx_demod_fm::general_work().
+ *
+ * Created by the GUI thread whenever a parameter changes and handed over
+ * to general_work() using rx_exchange_ptr(), like rx_fft_config.
+ */
+struct rx_demod_fm_config
+{
+    rx_demod_fm_config(double quad_rate, double audio_rate, float max_dev, double tau);
+
+    float   gain;        /*!< Discriminator gain, quad_rate / (2 pi max_dev). */
+    bool    deemph;      /*!< Whether de-emphasis is enabled. */
+    float   b0;          /*!< De-emphasis feed forward tap (both taps are equal). */
+    float   a1;          /*!< De-emphasis feed back tap, y[n] = b0 (x[n] + x[n-1]) - a1 y[n-1]. */
+    int     interp;      /*!< Resampler interpolation. */
+    int     decim;       /*!< Resampler decimation. */
+    int     ntaps;       /*!< Taps per polyphase filter. */
+    std::vector<float> taps;  /*!< Polyphase filters, interp x ntaps, in reverse order. */
+    std::vector<float> buf;   /*!< Filter history (ntaps-1) and demodulated samples. */
+};
 
 
 class rx_demod_fm;
@@ -49,26 +73,37 @@ rx_demod_fm_sptr make_rx_demod_fm(float quad_rate, float audio_rate, float max_d
 /*! \brief FM demodulator.
  *  \ingroup DSP
  *
- * This class implements the FM demodulator using the gr_quadrature_demod block.
- * It also provides de-emphasis with variable time constant (use 0.0 to disable).
- *
+ * This block demodulates FM and delivers audio at the audio rate. The
+ * quadrature discriminator, the de-emphasis (use tau = 0.0 to disable)
+ * and the rational resampler to the audio rate run in one pass over
+ * chunks of FM_CHUNK samples, so the intermediate signals never leave
+ * the cache and no GNU Radio buffers are needed between the stages.
+ * The resampler is a rational polyphase filter like
+ * gr_rational_resampler_base.
  */
-class rx_demod_fm : public gr_hier_block2
+class rx_demod_fm : public gr_block
 {
 
 public:
     rx_demod_fm(float quad_rate=48000.0, float audio_rate=48000.0, float max_dev=5000.0, double tau=50.0e-6); // FIXME: should be private
     ~rx_demod_fm();
 
+    void forecast(int noutput_items, gr_vector_int &ninput_items_required);
+
+    int general_work(int noutput_items,
+                     gr_vector_int &ninput_items,
+                     gr_vector_const_void_star &input_items,
+                     gr_vector_void_star &output_items);
+
     void set_max_dev(float max_dev);
     void set_tau(double tau);
+    void set_quad_rate(float quad_rate);
 
 private:
-    /* GR blocks */
-    gr_quadrature_demod_cf_sptr   d_quad;      /*! The quadrature demodulator block. */
-    gr_iir_filter_ffd_sptr        d_deemph;    /*! De-emphasis IIR filter. */
-    gr_pfb_arb_resampler_ccf_sptr d_resampler; /*! PFB resampler. */
-    std::vector<float>            d_taps;      /*! Taps for the PFB resampler. */
+    rx_demod_fm_config            *d_cfg;      /*! Configuration used by general_work(). */
+    rx_demod_fm_config * volatile  d_pending;  /*! New configuration for general_work(). */
+    rx_demod_fm_config * volatile  d_retired;  /*! Old configuration to be deleted by the GUI. */
+    boost::mutex d_mutex;  /*! Serializes the setters, never taken by general_work(). */
 
     /* other parameters */
     float  d_quad_rate;     /*! Quadrature rate. */
@@ -76,11 +111,17 @@ private:
     float  d_max_dev;       /*! Max deviation. */
     double d_tau;           /*! De-emphasis time constant. */
 
-    /* De-emph IIR filter taps */
-    std::vector<double> d_fftaps;  /*! Feed forward taps. */
-    std::vector<double> d_fbtaps;  /*! Feed back taps. */
-
-    void calculate_iir_taps(double tau);
+    /* state of general_work() */
+    gr_complex d_last;      /*! Last input sample. */
+    float      d_x1;        /*! Last discriminator output. */
+    float      d_y1;        /*! Last de-emphasis output. */
+    int        d_phase;     /*! Current polyphase filter. */
+    int        d_hist;      /*! Samples in the filter buffer. */
+    bool       d_idle;      /*! Squelch closed, the input is zero. */
+    rx_squelch_gate d_gate; /*! Squelch state of the input. */
+
+    void configure();
+    void demodulate(const gr_complex *in, float *out, int num);
 
 };
 
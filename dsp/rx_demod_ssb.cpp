@@ -0,0 +1,261 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <math.h>
+#include <string.h>
+#include <gr_io_signature.h>
+#include "dsp/rx_demod_ssb.h"
+
+
+#define HILBERT_LEN   129      /* Hilbert transformer length, odd. */
+
+
+/*! \brief Dot product of filter taps and samples.
+ *
+ * Four partial sums so that the loop can be vectorized without
+ * reordering floating point additions.
+ */
+static inline float dot4(const float *h, const float *x, int ntaps)
+{
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int k;
+
+    for (k = 0; k < ntaps; k += 4)
+    {
+        s0 += h[k] * x[k];
+        s1 += h[k+1] * x[k+1];
+        s2 += h[k+2] * x[k+2];
+        s3 += h[k+3] * x[k+3];
+    }
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+
+rx_demod_ssb_sptr make_rx_demod_ssb(float quad_rate, float bfo)
+{
+    return gnuradio::get_initial_sptr(new rx_demod_ssb(quad_rate, bfo));
+}
+
+
+rx_demod_ssb::rx_demod_ssb(float quad_rate, float bfo)
+    : gr_sync_block ("rx_demod_ssb",
+                     gr_make_io_signature (1, 1, sizeof (gr_complex)),
+                     gr_make_io_signature (1, 1, sizeof (float))),
+      d_params_seen(0),
+      d_quad_rate(quad_rate),
+      d_bfo(bfo),
+      d_osc(1.0, 0.0),
+      d_idle(false)
+{
+    const int m = HILBERT_LEN / 2;
+    double w;
+    int i;
+
+    /* Hilbert transformer, h[n] = 2 / (pi n) for odd n, Hamming window;
+       scaled by 0.5 like the in-phase signal so that a tone of amplitude
+       1.0 gives audio with amplitude 1.0 */
+    d_ntaps = (HILBERT_LEN + 3) & ~3;
+    d_taps.assign(d_ntaps, 0.0f);
+    for (i = 1; i <= m; i += 2)
+    {
+        w = 0.54 + 0.46 * cos(M_PI * i / m);
+        d_taps[d_ntaps - 1 - m - i] = 1.0 / (M_PI * i) * w;
+        d_taps[d_ntaps - 1 - m + i] = -1.0 / (M_PI * i) * w;
+    }
+    d_delay = d_ntaps - 1 - m;
+    d_re.assign(d_ntaps - 1 + SSB_CHUNK, 0.0f);
+    d_im.assign(d_ntaps - 1 + SSB_CHUNK, 0.0f);
+
+    d_set.sideband = SIDEBAND_USB;
+    update_bfo();
+    d_params.read(d_cur, d_params_seen);
+}
+
+
+rx_demod_ssb::~rx_demod_ssb()
+{
+
+}
+
+
+/*! \brief Demodulate SSB or CW.
+ *
+ * The input is processed in chunks of at most SSB_CHUNK samples.
+ */
+int rx_demod_ssb::work(int noutput_items,
+                       gr_vector_const_void_star &input_items,
+                       gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    float *out = (float *) output_items[0];
+    float sign;
+    int done, num, i;
+
+    d_params.read(d_cur, d_params_seen);
+    sign = (d_cur.sideband == SIDEBAND_LSB) ? 1.0f : -1.0f;
+
+    noutput_items = d_gate.update(this, noutput_items);
+    if (!d_gate.open()) {
+        /* squelch closed, the input is zero */
+        if (!d_idle) {
+            memset(&d_re[0], 0, d_re.size() * sizeof(float));
+            memset(&d_im[0], 0, d_im.size() * sizeof(float));
+            d_idle = true;
+        }
+        memset(out, 0, noutput_items * sizeof(float));
+        return noutput_items;
+    }
+    d_idle = false;
+
+    for (done = 0; done < noutput_items; done += num)
+    {
+        num = noutput_items - done;
+        num = (num < SSB_CHUNK) ? num : SSB_CHUNK;
+
+        mix(in + done, num);
+
+        for (i = 0; i < num; i++)
+            out[done+i] = 0.5f * d_re[i + d_delay] + sign * dot4(&d_taps[0], &d_im[i], d_ntaps);
+
+        /* keep history for the Hilbert transformer */
+        memmove(&d_re[0], &d_re[num], (d_ntaps - 1) * sizeof(float));
+        memmove(&d_im[0], &d_im[num], (d_ntaps - 1) * sizeof(float));
+    }
+
+    return noutput_items;
+}
+
+
+/*! \brief Shift the input by the BFO frequency.
+ *  \param in The input samples.
+ *  \param num The number of samples, at most SSB_CHUNK.
+ *
+ * The shifted signal is split into d_re and d_im after the history.
+ * The oscillator is advanced serially for SSB_BFO_BLOCK samples and
+ * renormalized, the mixing itself is vectorized.
+ */
+void rx_demod_ssb::mix(const gr_complex *in, int num)
+{
+    const float *iq = (const float *) in;
+    float *re = &d_re[d_ntaps - 1];
+    float *im = &d_im[d_ntaps - 1];
+    float osc_re[SSB_BFO_BLOCK];
+    float osc_im[SSB_BFO_BLOCK];
+    gr_complex osc;
+    int i, k, n;
+
+    if (!d_cur.bfo)
+    {
+        for (i = 0; i < num; i++)
+        {
+            re[i] = iq[2*i];
+            im[i] = iq[2*i+1];
+        }
+        return;
+    }
+
+    for (i = 0; i < num; i += n)
+    {
+        n = num - i;
+        n = (n < SSB_BFO_BLOCK) ? n : SSB_BFO_BLOCK;
+
+        osc = d_osc;
+        for (k = 0; k < n; k++)
+        {
+            osc_re[k] = osc.real();
+            osc_im[k] = osc.imag();
+            osc *= d_cur.bfo_step;
+        }
+        d_osc = osc * (1.5f - 0.5f * norm(osc));
+
+        for (k = 0; k < n; k++)
+        {
+            re[i+k] = iq[2*(i+k)] * osc_re[k] - iq[2*(i+k)+1] * osc_im[k];
+            im[i+k] = iq[2*(i+k)+1] * osc_re[k] + iq[2*(i+k)] * osc_im[k];
+        }
+    }
+}
+
+
+/*! \brief Calculate the BFO increment and pass the parameters to work().
+ *
+ * The BFO shifts the signal up for USB and down for LSB, so the carrier
+ * is heard at the BFO pitch in both cases.
+ */
+void rx_demod_ssb::update_bfo()
+{
+    double w = 2.0 * M_PI * d_bfo / d_quad_rate;
+
+    if (d_set.sideband == SIDEBAND_LSB)
+        w = -w;
+
+    d_set.bfo = (d_bfo != 0.0f);
+    d_set.bfo_step = gr_complex(cos(w), sin(w));
+
+    d_params.write(d_set);
+}
+
+
+/*! \brief Select sideband.
+ *  \param sideband The new sideband, see rx_demod_ssb::sideband.
+ */
+void rx_demod_ssb::set_sideband(int sideband)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    if ((sideband != SIDEBAND_USB) && (sideband != SIDEBAND_LSB))
+        return;
+
+    d_set.sideband = sideband;
+    update_bfo();
+}
+
+
+/*! \brief Get the current sideband. */
+int rx_demod_ssb::get_sideband()
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    return d_set.sideband;
+}
+
+
+/*! \brief Set the BFO frequency.
+ *  \param bfo The new BFO frequency (CW pitch) in Hz, 0 for SSB.
+ */
+void rx_demod_ssb::set_bfo(float bfo)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    if ((bfo < 0.0f) || (bfo > d_quad_rate / 4.0))
+        return;
+
+    d_bfo = bfo;
+    update_bfo();
+}
+
+
+/*! \brief Get the current BFO frequency in Hz. */
+float rx_demod_ssb::get_bfo()
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    return d_bfo;
+}
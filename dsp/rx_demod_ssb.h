@@ -0,0 +1,129 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RX_DEMOD_SSB_H
+#define RX_DEMOD_SSB_H
+
+#include <gr_sync_block.h>
+#include <gr_complex.h>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+#include "dsp/lockfree.h"
+#include "dsp/rx_squelch.h"
+
+
+#define SSB_CHUNK      4096   /*!< Samples processed per pass. */
+#define SSB_BFO_BLOCK  16     /*!< Samples per BFO renormalization. */
+
+
+/*! \brief Parameters passed from the setters to work(). */
+struct rx_demod_ssb_params
+{
+    int         sideband;  /*!< Sideband, see rx_demod_ssb::sideband. */
+    bool        bfo;       /*!< Whether the BFO is used. */
+    gr_complex  bfo_step;  /*!< BFO increment per sample. */
+};
+
+
+class rx_demod_ssb;
+
+typedef boost::shared_ptr<rx_demod_ssb> rx_demod_ssb_sptr;
+
+
+/*! \brief Return a shared_ptr to a new instance of rx_demod_ssb.
+ *  \param quad_rate The input sample rate.
+ *  \param bfo The BFO frequency (CW pitch) in Hz, 0 for SSB.
+ *
+ * This is effectively the public constructor. To avoid accidental use
+ * of raw pointers, rx_demod_ssb's constructor is private.
+ * make_rx_demod_ssb is the public interface for creating new instances.
+ */
+rx_demod_ssb_sptr make_rx_demod_ssb(float quad_rate, float bfo=0.0);
+
+
+/*! \brief SSB and CW demodulator.
+ *  \ingroup DSP
+ *
+ * This block implements a phasing SSB detector: the in-phase signal is
+ * delayed and the Hilbert transform of the quadrature signal is
+ * subtracted (USB) or added (LSB), which cancels the opposite sideband
+ * independently of the channel filter.
+ *
+ * For CW the input is first shifted by the BFO frequency, up for USB and
+ * down for LSB, so that a carrier at the receiver frequency is heard at
+ * the BFO pitch and the channel filter can be centred on the carrier.
+ *
+ * The cost is one Hilbert transformer (about 64 multiplications since
+ * every other tap is zero, but evaluated as a dense 132 tap filter so that
+ * it vectorizes) per sample, plus a complex multiplication when the BFO is
+ * used. It should run at a low channel rate, 12 kHz for SSB or less for CW.
+ */
+class rx_demod_ssb : public gr_sync_block
+{
+    friend rx_demod_ssb_sptr make_rx_demod_ssb(float quad_rate, float bfo);
+
+public:
+    /*! \brief Sideband selection. */
+    enum sideband {
+        SIDEBAND_USB = 0,  /*!< Upper sideband. */
+        SIDEBAND_LSB = 1   /*!< Lower sideband. */
+    };
+
+protected:
+    rx_demod_ssb(float quad_rate, float bfo);
+
+public:
+    ~rx_demod_ssb();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    void set_sideband(int sideband);
+    int  get_sideband();
+    void set_bfo(float bfo);
+    float get_bfo();
+
+private:
+    rx_seqlock<rx_demod_ssb_params> d_params;  /*! Parameters for work(). */
+    unsigned int         d_params_seen;  /*! Last parameters picked up by work(). */
+    rx_demod_ssb_params  d_set;          /*! Parameters set by the GUI. */
+    rx_demod_ssb_params  d_cur;          /*! Parameters used by work(). */
+    boost::mutex         d_mutex;        /*! Serializes the setters. */
+
+    float  d_quad_rate;     /*! Quadrature rate. */
+    float  d_bfo;           /*! BFO frequency. */
+
+    gr_complex  d_osc;      /*! BFO phase. */
+
+    int                d_ntaps;  /*! Hilbert transformer length (multiple of 4). */
+    int                d_delay;  /*! Delay of the in-phase signal in d_re. */
+    std::vector<float> d_taps;   /*! Hilbert transformer, reversed. */
+    std::vector<float> d_re;     /*! History and in-phase signal. */
+    std::vector<float> d_im;     /*! History and quadrature signal. */
+
+    rx_squelch_gate d_gate;      /*! Squelch state of the input. */
+    bool            d_idle;      /*! Idle since the squelch closed. */
+
+    void update_bfo();
+    void mix(const gr_complex *in, int num);
+};
+
+
+#endif // RX_DEMOD_SSB_H
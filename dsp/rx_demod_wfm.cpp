@@ -0,0 +1,657 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <math.h>
+#include <string.h>
+#include <gr_io_signature.h>
+#include <gr_firdes.h>
+#include "dsp/rx_demod_wfm.h"
+#include "dsp/fast_math.h"
+
+
+#define PILOT_FREQ     19000.0   /* Pilot frequency in Hz. */
+#define PILOT_RANGE    50.0      /* Pilot PLL tracking range in Hz. */
+#define PILOT_BW       20.0      /* Pilot PLL noise bandwidth in Hz. */
+#define PILOT_LOCK     0.04f     /* Pilot level needed for lock. */
+#define PILOT_UNLOCK   0.03f     /* Pilot level below which lock is lost. */
+
+#define AUDIO_PASS     15000.0   /* Audio pass band. */
+#define AUDIO_STOP     19000.0   /* Audio stop band, the pilot. */
+
+#define RDS_RATE       16000.0   /* Approximate sample rate of the RDS decoder. */
+#define RDS_BW         2400.0    /* Bandwidth of the RDS signal. */
+#define RDS_BITRATE    1187.5    /* RDS bit rate, pilot / 16. */
+#define RDS_COSTAS_BW  10.0      /* Costas loop noise bandwidth in Hz. */
+#define RDS_MAX_BAD    10        /* Consecutive bad blocks before sync is lost. */
+
+/* RDS offset words of blocks A, B, C, D and C' */
+static const unsigned int rds_offset[5] = { 0x0FC, 0x198, 0x168, 0x1B4, 0x350 };
+
+
+/*! \brief Design a low pass filter for rx_demod_wfm.
+ *  \param rate The sample rate.
+ *  \param pass The pass band edge.
+ *  \param stop The stop band edge.
+ *  \param ntaps Returns the number of taps, a multiple of 4.
+ *  \return The taps in reverse order, zero padded in front.
+ */
+static std::vector<float> design_low_pass(double rate, double pass, double stop, int &ntaps)
+{
+    std::vector<float> proto;
+    std::vector<float> taps;
+    int i;
+
+    proto = gr_firdes::low_pass(1.0, rate, (pass + stop) / 2.0, stop - pass,
+                                gr_firdes::WIN_HAMMING);
+    ntaps = (proto.size() + 3) & ~3;
+    taps.assign(ntaps, 0.0f);
+    for (i = 0; i < (int) proto.size(); i++)
+        taps[ntaps - 1 - i] = proto[i];
+
+    return taps;
+}
+
+
+/*! \brief Dot product of filter taps and samples.
+ *
+ * Four partial sums so that the loop can be vectorized without
+ * reordering floating point additions.
+ */
+static inline float dot4(const float *h, const float *x, int ntaps)
+{
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int k;
+
+    for (k = 0; k < ntaps; k += 4)
+    {
+        s0 += h[k] * x[k];
+        s1 += h[k+1] * x[k+1];
+        s2 += h[k+2] * x[k+2];
+        s3 += h[k+3] * x[k+3];
+    }
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+
+/*! \brief Offset word of a received RDS block.
+ *  \param block The 26 bit block, 16 bit information word and 10 bit checkword.
+ *
+ * The checkword is the CRC of the information word with the generator
+ * x^10 + x^8 + x^7 + x^5 + x^4 + x^3 + 1 plus the offset word of the block.
+ */
+static unsigned int rds_block_offset(unsigned int block)
+{
+    unsigned int r = (block >> 10) << 10;
+    int i;
+
+    for (i = 25; i >= 10; i--)
+        if (r & (1u << i))
+            r ^= 0x5B9u << (i - 10);
+
+    return (r ^ block) & 0x3FF;
+}
+
+
+rx_demod_wfm_sptr make_rx_demod_wfm(float quad_rate, float audio_rate, float max_dev, double tau)
+{
+    return gnuradio::get_initial_sptr(new rx_demod_wfm(quad_rate, audio_rate, max_dev, tau));
+}
+
+
+rx_demod_wfm::rx_demod_wfm(float quad_rate, float audio_rate, float max_dev, double tau)
+    : gr_sync_decimator ("rx_demod_wfm",
+                         gr_make_io_signature (1, 1, sizeof (gr_complex)),
+                         gr_make_io_signature (1, 2, sizeof (float)),
+                         (unsigned int) (quad_rate / audio_rate + 0.5)),
+      d_params_seen(0),
+      d_quad_rate(quad_rate),
+      d_audio_rate(audio_rate),
+      d_max_dev(max_dev),
+      d_tau(tau),
+      d_last(0.0, 0.0),
+      d_nco(1.0, 0.0),
+      d_pll_acc(0.0, 0.0),
+      d_pll_count(0),
+      d_pilot(0.0, 0.0),
+      d_locked(false),
+      d_rds_phase(0),
+      d_rds_nco(1.0, 0.0),
+      d_rds_freq(0.0),
+      d_rds_pow(0.0),
+      d_rds_pos(0),
+      d_rds_clock(0.0),
+      d_rds_best(0),
+      d_rds_bin(0),
+      d_rds_sym(0),
+      d_rds_reg(0),
+      d_rds_bits(0),
+      d_rds_block(-1),
+      d_rds_last(-1),
+      d_rds_bad(0),
+      d_rds_ok(false),
+      d_rds_ab(-1)
+{
+    const int decim = decimation();
+    const int chunk = (WFM_CHUNK / decim) * decim;
+    double wn, rds_rate;
+    int i, n;
+
+    /* pilot PLL, 2nd order loop updated every WFM_PLL_BLOCK samples */
+    d_pll_freq = 2.0 * M_PI * PILOT_FREQ / quad_rate;
+    d_pll_min = 2.0 * M_PI * (PILOT_FREQ - PILOT_RANGE) / quad_rate;
+    d_pll_max = 2.0 * M_PI * (PILOT_FREQ + PILOT_RANGE) / quad_rate;
+    d_nco_step = gr_complex(cos(d_pll_freq), sin(d_pll_freq));
+    wn = 2.0 * PILOT_BW / (M_SQRT1_2 + 1.0 / (4.0 * M_SQRT1_2)) * WFM_PLL_BLOCK / quad_rate;
+    d_pll_kp = 2.0 * M_SQRT1_2 * wn;
+    d_pll_ki = wn * wn / WFM_PLL_BLOCK;
+
+    /* audio filters */
+    d_taps = design_low_pass(quad_rate, AUDIO_PASS, AUDIO_STOP, d_ntaps);
+    d_sum.assign(d_ntaps - 1 + chunk, 0.0f);
+    d_diff.assign(d_ntaps - 1 + chunk, 0.0f);
+    d_x1[0] = d_x1[1] = 0.0f;
+    d_y1[0] = d_y1[1] = 0.0f;
+
+    /* RDS; only aliases from more than rds_rate - RDS_BW can reach the signal */
+    d_rds_decim = (int) (quad_rate / RDS_RATE);
+    d_rds_decim = (d_rds_decim > 0) ? d_rds_decim : 1;
+    rds_rate = quad_rate / d_rds_decim;
+    d_rds_taps = design_low_pass(quad_rate, RDS_BW, rds_rate - RDS_BW, d_rds_ntaps);
+    d_rds_re.assign(d_rds_ntaps - 1 + chunk, 0.0f);
+    d_rds_im.assign(d_rds_ntaps - 1 + chunk, 0.0f);
+
+    wn = 2.0 * RDS_COSTAS_BW / (M_SQRT1_2 + 1.0 / (4.0 * M_SQRT1_2)) / rds_rate;
+    d_rds_kp = 2.0 * M_SQRT1_2 * wn;
+    d_rds_ki = wn * wn;
+
+    /* biphase symbol: one period of a sine per bit */
+    n = (int) (rds_rate / RDS_BITRATE + 0.5);
+    d_rds_mf.resize(n);
+    for (i = 0; i < n; i++)
+        d_rds_mf[i] = sin(2.0 * M_PI * (i + 0.5) / n);
+    d_rds_hist.assign(2 * n, 0.0f);
+    memset(d_rds_energy, 0, sizeof(d_rds_energy));
+    memset(d_rds_group, 0, sizeof(d_rds_group));
+
+    memset(&d_info, 0, sizeof(d_info));
+    d_info.pi = -1;
+    d_info.pty = -1;
+    memset(d_info.ps, ' ', 8);
+    memset(d_info.rt, ' ', 64);
+    d_status.write(d_info);
+
+    d_set.stereo = true;
+    d_set.rds = true;
+    update_params(max_dev, tau);
+    d_params.read(d_cur, d_params_seen);
+}
+
+
+rx_demod_wfm::~rx_demod_wfm()
+{
+
+}
+
+
+/*! \brief Demodulate stereo FM and decode RDS.
+ *
+ * The input is processed in chunks of at most WFM_CHUNK samples.
+ */
+int rx_demod_wfm::work(int noutput_items,
+                       gr_vector_const_void_star &input_items,
+                       gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    float *left = (float *) output_items[0];
+    float *right = (output_items.size() > 1) ? (float *) output_items[1] : 0;
+    const int decim = decimation();
+    const int chunk = WFM_CHUNK / decim;
+    int done, num;
+
+    d_params.read(d_cur, d_params_seen);
+
+    for (done = 0; done < noutput_items; done += num)
+    {
+        num = noutput_items - done;
+        num = (num < chunk) ? num : chunk;
+        process(in + done * decim, num, left + done, right ? right + done : 0);
+    }
+
+    d_info.pilot = 2.0f * abs(d_pilot);
+    d_info.stereo = d_locked && d_cur.stereo;
+    d_info.rds_sync = (d_rds_block >= 0);
+    d_status.publish(d_info);
+
+    return noutput_items;
+}
+
+
+/*! \brief Process one chunk.
+ *  \param in The input samples (num * decimation).
+ *  \param num The number of output samples.
+ *  \param left Output buffer for the left channel.
+ *  \param right Output buffer for the right channel, may be NULL.
+ *  \return num.
+ */
+int rx_demod_wfm::process(const gr_complex *in, int num, float *left, float *right)
+{
+    const int decim = decimation();
+    const int nin = num * decim;
+    const int hist = d_ntaps - 1;
+    const int rhist = d_rds_ntaps - 1;
+    const bool stereo = d_cur.stereo && d_locked;
+    const bool rds = d_cur.rds;
+    const float *iq = (const float *) in;
+    float *mpx = &d_sum[hist];
+    float *diff = &d_diff[hist];
+    float *rds_re = &d_rds_re[rhist];
+    float *rds_im = &d_rds_im[rhist];
+    float re, im, x, pc, pr, pi, p2r, p2i, s, d, l, r;
+    gr_complex nco = d_nco;
+    int i, j;
+
+    /* discriminator, vectorized like in rx_demod_fm */
+    re = iq[0] * d_last.real() + iq[1] * d_last.imag();
+    im = iq[1] * d_last.real() - iq[0] * d_last.imag();
+    mpx[0] = d_cur.gain * fast_atan2f(im, re);
+    for (i = 1; i < nin; i++)
+    {
+        re = iq[2*i] * iq[2*i-2] + iq[2*i+1] * iq[2*i-1];
+        im = iq[2*i+1] * iq[2*i-2] - iq[2*i] * iq[2*i-1];
+        mpx[i] = d_cur.gain * fast_atan2f(im, re);
+    }
+    d_last = in[nin-1];
+
+    /* Pilot PLL and subcarriers. The pilot is cos(phase of nco), the stereo
+     * subcarrier is -sin(2 x phase) and the RDS carrier 3 x phase.
+     */
+    for (i = 0; i < nin; i++)
+    {
+        x = mpx[i];
+        pr = nco.real();
+        pi = nco.imag();
+
+        d_pll_acc += gr_complex(x * pr, -x * pi);
+
+        pc = 2.0f * (d_pilot.real() * pr - d_pilot.imag() * pi);
+        mpx[i] = x - pc;
+
+        if (stereo)
+            diff[i] = -4.0f * (x - pc) * pr * pi;
+
+        if (rds)
+        {
+            p2r = pr * pr - pi * pi;
+            p2i = 2.0f * pr * pi;
+            rds_re[i] = x * (p2r * pr - p2i * pi);
+            rds_im[i] = -x * (p2r * pi + p2i * pr);
+        }
+
+        nco *= d_nco_step;
+        if (++d_pll_count == WFM_PLL_BLOCK)
+        {
+            d_nco = nco;
+            pll_update();
+            nco = d_nco;
+        }
+    }
+    d_nco = nco;
+
+    /* audio filters at the output samples only */
+    for (j = 0; j < num; j++)
+    {
+        s = dot4(&d_taps[0], &d_sum[j * decim], d_ntaps);
+        d = stereo ? dot4(&d_taps[0], &d_diff[j * decim], d_ntaps) : 0.0f;
+        l = s + d;
+        r = s - d;
+
+        if (d_cur.deemph)
+        {
+            d_y1[0] = d_cur.b0 * (l + d_x1[0]) - d_cur.a1 * d_y1[0];
+            d_x1[0] = l;
+            l = d_y1[0];
+            d_y1[1] = d_cur.b0 * (r + d_x1[1]) - d_cur.a1 * d_y1[1];
+            d_x1[1] = r;
+            r = d_y1[1];
+        }
+
+        left[j] = l;
+        if (right)
+            right[j] = r;
+    }
+    memmove(&d_sum[0], &d_sum[nin], hist * sizeof(float));
+    if (stereo)
+        memmove(&d_diff[0], &d_diff[nin], hist * sizeof(float));
+
+    /* RDS filter at the RDS samples only */
+    if (rds)
+    {
+        for (i = d_rds_phase; i < nin; i += d_rds_decim)
+        {
+            rds_sample(dot4(&d_rds_taps[0], &d_rds_re[i], d_rds_ntaps),
+                       dot4(&d_rds_taps[0], &d_rds_im[i], d_rds_ntaps));
+        }
+        d_rds_phase = i - nin;
+        memmove(&d_rds_re[0], &d_rds_re[nin], rhist * sizeof(float));
+        memmove(&d_rds_im[0], &d_rds_im[nin], rhist * sizeof(float));
+    }
+
+    return num;
+}
+
+
+/*! \brief Update the pilot PLL.
+ *
+ * Called every WFM_PLL_BLOCK samples with the sum of the input mixed
+ * down by the oscillator in d_pll_acc. The phase detector is the
+ * imaginary part normalized by the averaged pilot amplitude, so the
+ * audio in the multiplex signal averages out instead of biasing it.
+ */
+void rx_demod_wfm::pll_update()
+{
+    gr_complex a = d_pll_acc * (1.0f / WFM_PLL_BLOCK);
+    float level, err;
+
+    d_pll_acc = gr_complex(0.0, 0.0);
+    d_pll_count = 0;
+
+    /* averaged pilot, time constant about 20 ms */
+    d_pilot += (a - d_pilot) * (float) (WFM_PLL_BLOCK / (0.02 * d_quad_rate));
+    level = 2.0f * abs(d_pilot);
+
+    err = a.imag() / (abs(d_pilot) + 0.005f);
+    err = (err > 1.0f) ? 1.0f : ((err < -1.0f) ? -1.0f : err);
+
+    d_pll_freq += d_pll_ki * err;
+    d_pll_freq = (d_pll_freq < d_pll_min) ? d_pll_min : d_pll_freq;
+    d_pll_freq = (d_pll_freq > d_pll_max) ? d_pll_max : d_pll_freq;
+    d_nco_step = gr_complex(cos(d_pll_freq), sin(d_pll_freq));
+
+    /* phase correction and amplitude normalization */
+    d_nco *= gr_complex(1.0f, d_pll_kp * err);
+    d_nco *= 1.5f - 0.5f * norm(d_nco);
+    d_nco *= 1.5f - 0.5f * norm(d_nco);
+
+    if (d_locked)
+        d_locked = (level > PILOT_UNLOCK) && (d_pilot.real() > 0.8f * abs(d_pilot));
+    else
+        d_locked = (level > PILOT_LOCK) && (d_pilot.real() > 0.95f * abs(d_pilot));
+}
+
+
+/*! \brief Process one RDS sample.
+ *  \param re Real part of the RDS signal at baseband.
+ *  \param im Imaginary part of the RDS signal at baseband.
+ *
+ * A Costas loop rotates the BPSK signal to the real axis, where it is
+ * correlated with a biphase symbol. The bit clock runs at pilot / 16;
+ * its phase is chosen where the correlation has the most energy.
+ */
+void rx_demod_wfm::rds_sample(float re, float im)
+{
+    gr_complex y = gr_complex(re, im) * d_rds_nco;
+    const int n = d_rds_mf.size();
+    float err, m, inc;
+    int bin, i, sym;
+
+    /* Costas loop */
+    d_rds_pow += 0.001f * (norm(y) - d_rds_pow);
+    err = y.real() * y.imag() / (d_rds_pow + 1.0e-20f);
+    err = (err > 1.0f) ? 1.0f : ((err < -1.0f) ? -1.0f : err);
+    d_rds_freq += d_rds_ki * err;
+    d_rds_nco *= gr_complex(1.0f, -(d_rds_freq + d_rds_kp * err));
+    d_rds_nco *= 1.5f - 0.5f * norm(d_rds_nco);
+
+    /* matched filter */
+    d_rds_hist[d_rds_pos] = y.real();
+    d_rds_hist[d_rds_pos + n] = y.real();
+    d_rds_pos = (d_rds_pos + 1) % n;
+    m = 0.0f;
+    for (i = 0; i < n; i++)
+        m += d_rds_mf[i] * d_rds_hist[d_rds_pos + i];
+
+    /* bit clock from the pilot when locked */
+    if (d_locked)
+        inc = d_pll_freq / (2.0 * M_PI * 16.0) * d_rds_decim;
+    else
+        inc = RDS_BITRATE * d_rds_decim / d_quad_rate;
+
+    d_rds_clock += inc;
+    if (d_rds_clock >= 1.0f)
+    {
+        d_rds_clock -= 1.0f;
+        for (i = 1; i < 8; i++)
+            if (d_rds_energy[i] > d_rds_energy[d_rds_best])
+                d_rds_best = i;
+    }
+
+    bin = (int) (d_rds_clock * 8.0f) & 7;
+    d_rds_energy[bin] += 0.002f * (fabsf(m) - d_rds_energy[bin]);
+
+    /* one decision per bit, at the first sample in the best phase */
+    if ((bin == d_rds_best) && (bin != d_rds_bin))
+    {
+        sym = (m > 0.0f);
+        rds_bit(sym ^ d_rds_sym);   /* differential decoding */
+        d_rds_sym = sym;
+    }
+    d_rds_bin = bin;
+}
+
+
+/*! \brief Process one RDS bit.
+ *
+ * Without synchronization every bit position is checked for a valid
+ * block; two consecutive blocks 26 bits apart give synchronization.
+ * After that only every 26th bit is checked.
+ */
+void rx_demod_wfm::rds_bit(int bit)
+{
+    unsigned int offset;
+    int type;
+    bool good;
+
+    d_rds_reg = ((d_rds_reg << 1) | (bit & 1)) & 0x3FFFFFF;
+    d_rds_bits++;
+    offset = rds_block_offset(d_rds_reg);
+
+    if (d_rds_block < 0)
+    {
+        for (type = 0; type < 5; type++)
+            if (offset == rds_offset[type])
+                break;
+
+        if (type == 5)
+            return;
+
+        type = (type == 4) ? 2 : type;   /* C' */
+        if ((d_rds_last >= 0) && (d_rds_bits == 26) && (type == (d_rds_last + 1) % 4))
+        {
+            d_rds_block = (type + 1) % 4;
+            d_rds_bad = 0;
+            d_rds_ok = false;
+        }
+        d_rds_last = type;
+        d_rds_bits = 0;
+        return;
+    }
+
+    if (d_rds_bits < 26)
+        return;
+
+    d_rds_bits = 0;
+    good = (offset == rds_offset[d_rds_block]) ||
+           ((d_rds_block == 2) && (offset == rds_offset[4]));
+
+    d_rds_group[d_rds_block] = d_rds_reg >> 10;
+    d_rds_ok = good && (d_rds_ok || (d_rds_block == 0));
+
+    if (good)
+    {
+        d_rds_bad = 0;
+    }
+    else
+    {
+        d_info.rds_errors++;
+        if (++d_rds_bad > RDS_MAX_BAD)
+        {
+            d_rds_block = -1;
+            d_rds_last = -1;
+            return;
+        }
+    }
+
+    if ((d_rds_block == 3) && d_rds_ok)
+        rds_group();
+
+    d_rds_block = (d_rds_block + 1) % 4;
+}
+
+
+/*! \brief Decode a complete RDS group.
+ *
+ * Only the program identification, the program type, the program
+ * service name (group 0) and radiotext (group 2) are decoded.
+ */
+void rx_demod_wfm::rds_group()
+{
+    const unsigned int *g = d_rds_group;
+    int type = g[1] >> 12;
+    int version_b = (g[1] >> 11) & 1;
+    char c[4];
+    int seg, i, n, ab;
+
+    d_info.rds_groups++;
+    d_info.pi = g[0];
+    d_info.pty = (g[1] >> 5) & 0x1F;
+
+    switch (type) {
+
+    case 0:
+        seg = g[1] & 3;
+        c[0] = g[3] >> 8;
+        c[1] = g[3] & 0xFF;
+        for (i = 0; i < 2; i++)
+            d_info.ps[2*seg + i] = ((c[i] >= 0x20) && (c[i] < 0x7F)) ? c[i] : ' ';
+        break;
+
+    case 2:
+        ab = (g[1] >> 4) & 1;
+        if (ab != d_rds_ab)
+            memset(d_info.rt, ' ', 64);
+        d_rds_ab = ab;
+
+        seg = g[1] & 0xF;
+        if (version_b) {
+            c[0] = g[3] >> 8;
+            c[1] = g[3] & 0xFF;
+            n = 2;
+        }
+        else {
+            c[0] = g[2] >> 8;
+            c[1] = g[2] & 0xFF;
+            c[2] = g[3] >> 8;
+            c[3] = g[3] & 0xFF;
+            n = 4;
+        }
+        for (i = 0; i < n; i++) {
+            if (c[i] == 0x0D)
+                d_info.rt[n*seg + i] = 0;   /* end of text */
+            else
+                d_info.rt[n*seg + i] = ((c[i] >= 0x20) && (c[i] < 0x7F)) ? c[i] : ' ';
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+/*! \brief Calculate the parameters for work() and pass them on.
+ *
+ * Must be called with d_mutex locked.
+ */
+void rx_demod_wfm::update_params(float max_dev, double tau)
+{
+    double w_pp;
+
+    d_max_dev = max_dev;
+    d_tau = tau;
+
+    d_set.gain = d_quad_rate / (2.0 * M_PI * d_max_dev);
+
+    /* de-emphasis at the audio rate with the pole at -a1 and unity gain
+       at DC, see rx_demod_fm for why this differs from the baseline */
+    d_set.deemph = (d_tau > 1.0e-9);
+    w_pp = d_set.deemph ? tan(1.0 / (d_tau * d_audio_rate * 2.0)) : 0.0;
+    d_set.b0 = w_pp / (1.0 + w_pp);
+    d_set.a1 = (w_pp - 1.0) / (w_pp + 1.0);
+
+    d_params.write(d_set);
+}
+
+
+/*! \brief Set maximum FM deviation.
+ *  \param max_dev The new maximum deviation in Hz (75 kHz for broadcast FM).
+ */
+void rx_demod_wfm::set_max_dev(float max_dev)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    if ((max_dev < 500.0) || (max_dev > d_quad_rate/2.0))
+        return;
+
+    update_params(max_dev, d_tau);
+}
+
+
+/*! \brief Set FM de-emphasis time constant.
+ *  \param tau The new time costant, 0.0 disables de-emphasis.
+ */
+void rx_demod_wfm::set_tau(double tau)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    update_params(d_max_dev, tau > 1.0e-9 ? tau : 0.0);
+}
+
+
+/*! \brief Enable or disable stereo decoding.
+ *
+ * When disabled, or when there is no pilot, both outputs are mono.
+ */
+void rx_demod_wfm::set_stereo(bool enabled)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    d_set.stereo = enabled;
+    d_params.write(d_set);
+}
+
+
+/*! \brief Enable or disable the RDS decoder. */
+void rx_demod_wfm::set_rds(bool enabled)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    d_set.rds = enabled;
+    d_params.write(d_set);
+}
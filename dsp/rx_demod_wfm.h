@@ -0,0 +1,197 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RX_DEMOD_WFM_H
+#define RX_DEMOD_WFM_H
+
+#include <gr_sync_decimator.h>
+#include <gr_complex.h>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+#include "dsp/lockfree.h"
+
+
+#define WFM_CHUNK      4800   /*!< Input samples processed per pass. */
+#define WFM_PLL_BLOCK  16     /*!< Samples per pilot PLL update. */
+
+
+/*! \brief Parameters passed from the setters to work(). */
+struct rx_demod_wfm_params
+{
+    float  gain;     /*!< Discriminator gain, max deviation gives 1.0. */
+    bool   deemph;   /*!< Whether de-emphasis is enabled. */
+    float  b0;       /*!< De-emphasis feed forward tap. */
+    float  a1;       /*!< De-emphasis feed back tap. */
+    bool   stereo;   /*!< Decode stereo when the pilot is locked. */
+    bool   rds;      /*!< Decode RDS. */
+};
+
+
+/*! \brief Stereo and RDS status published by work(). */
+struct rx_wfm_status
+{
+    float          pilot;       /*!< Pilot level relative to the max deviation. */
+    bool           stereo;      /*!< Pilot locked and stereo decoded. */
+    bool           rds_sync;    /*!< RDS block synchronization. */
+    unsigned int   rds_groups;  /*!< Number of error free groups received. */
+    unsigned int   rds_errors;  /*!< Number of blocks with errors. */
+    int            pi;          /*!< Program identification, -1 if unknown. */
+    int            pty;         /*!< Program type, -1 if unknown. */
+    char           ps[9];       /*!< Program service name, 0 terminated. */
+    char           rt[65];      /*!< Radiotext, 0 terminated. */
+};
+
+
+class rx_demod_wfm;
+
+typedef boost::shared_ptr<rx_demod_wfm> rx_demod_wfm_sptr;
+
+
+/*! \brief Return a shared_ptr to a new instance of rx_demod_wfm.
+ *  \param quad_rate The input sample rate, at least 240 kHz.
+ *  \param audio_rate The audio rate; quad_rate / audio_rate must be an integer.
+ *  \param max_dev Maximum deviation in Hz.
+ *  \param tau De-emphasis time constant in seconds (0.0 disables).
+ *
+ * This is effectively the public constructor. To avoid accidental use
+ * of raw pointers, rx_demod_wfm's constructor is private.
+ * make_rx_demod_wfm is the public interface for creating new instances.
+ */
+rx_demod_wfm_sptr make_rx_demod_wfm(float quad_rate=240000.0, float audio_rate=48000.0,
+                                    float max_dev=75000.0, double tau=50.0e-6);
+
+
+/*! \brief Broadcast FM stereo and RDS demodulator.
+ *  \ingroup DSP
+ *
+ * The block demodulates the multiplex signal and outputs left and right
+ * audio at the audio rate on outputs 0 and 1. Output 1 is optional.
+ *
+ * A PLL locks to the 19 kHz pilot; the 38 kHz stereo subcarrier and the
+ * 57 kHz RDS carrier are its 2nd and 3rd harmonic, so they are derived
+ * from the same oscillator without trigonometric functions. The pilot is
+ * subtracted from the mono signal and the sum and difference signals are
+ * low pass filtered and decimated to the audio rate by evaluating the
+ * filters only at the output samples. RDS is mixed to baseband, decimated
+ * to about 16 kHz, tracked with a Costas loop and sampled using a bit
+ * clock derived from the pilot.
+ *
+ * The cost per input sample is fixed: about 30 operations for the
+ * discriminator and oscillator, plus 2 x 200 / decimation for the audio
+ * filters and 2 x 64 / 15 for RDS. Without pilot or with stereo disabled
+ * the difference filter is skipped, and RDS is skipped when disabled.
+ * At 240 kHz this is around 25 Mflop/s.
+ */
+class rx_demod_wfm : public gr_sync_decimator
+{
+    friend rx_demod_wfm_sptr make_rx_demod_wfm(float quad_rate, float audio_rate,
+                                               float max_dev, double tau);
+
+protected:
+    rx_demod_wfm(float quad_rate, float audio_rate, float max_dev, double tau);
+
+public:
+    ~rx_demod_wfm();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    void set_max_dev(float max_dev);
+    void set_tau(double tau);
+    void set_stereo(bool enabled);
+    void set_rds(bool enabled);
+
+    rx_wfm_status get_status() const { return d_status.get(); }
+
+private:
+    rx_seqlock<rx_demod_wfm_params> d_params;  /*! Parameters for work(). */
+    unsigned int         d_params_seen;  /*! Last parameters picked up by work(). */
+    rx_demod_wfm_params  d_set;          /*! Parameters set by the GUI. */
+    rx_demod_wfm_params  d_cur;          /*! Parameters used by work(). */
+    boost::mutex         d_mutex;        /*! Serializes the setters. */
+
+    float  d_quad_rate;     /*! Quadrature rate. */
+    float  d_audio_rate;    /*! Audio rate. */
+    float  d_max_dev;       /*! Max deviation. */
+    double d_tau;           /*! De-emphasis time constant. */
+
+    /* discriminator and pilot PLL */
+    gr_complex d_last;      /*! Last input sample. */
+    gr_complex d_nco;       /*! Pilot oscillator. */
+    gr_complex d_nco_step;  /*! Pilot oscillator increment. */
+    float      d_pll_freq;  /*! Pilot frequency in rad/sample. */
+    float      d_pll_min;   /*! Lowest pilot frequency. */
+    float      d_pll_max;   /*! Highest pilot frequency. */
+    float      d_pll_kp;    /*! Proportional gain of the loop filter. */
+    float      d_pll_ki;    /*! Integral gain of the loop filter. */
+    gr_complex d_pll_acc;   /*! Phase detector integrator. */
+    int        d_pll_count; /*! Samples in d_pll_acc. */
+    gr_complex d_pilot;     /*! Averaged pilot relative to the oscillator. */
+    bool       d_locked;    /*! Pilot lock. */
+
+    /* audio */
+    int                d_ntaps;    /*! Audio filter length (multiple of 4). */
+    std::vector<float> d_taps;     /*! Audio filter, reversed. */
+    std::vector<float> d_sum;      /*! Filter history and L+R at the input rate. */
+    std::vector<float> d_diff;     /*! Filter history and L-R at the input rate. */
+    float              d_x1[2];    /*! De-emphasis state, input. */
+    float              d_y1[2];    /*! De-emphasis state, output. */
+
+    /* RDS */
+    int                d_rds_decim;   /*! Decimation to the RDS rate. */
+    int                d_rds_phase;   /*! Input samples until the next RDS sample. */
+    int                d_rds_ntaps;   /*! RDS filter length (multiple of 4). */
+    std::vector<float> d_rds_taps;    /*! RDS filter, reversed. */
+    std::vector<float> d_rds_re;      /*! Filter history and mixed RDS, real part. */
+    std::vector<float> d_rds_im;      /*! Filter history and mixed RDS, imaginary part. */
+    gr_complex         d_rds_nco;     /*! Costas loop phase correction. */
+    float              d_rds_freq;    /*! Costas loop frequency in rad/sample. */
+    float              d_rds_kp;      /*! Proportional gain of the Costas loop. */
+    float              d_rds_ki;      /*! Integral gain of the Costas loop. */
+    float              d_rds_pow;     /*! Average power of the RDS signal. */
+    std::vector<float> d_rds_mf;      /*! Matched filter taps (one bit). */
+    std::vector<float> d_rds_hist;    /*! Matched filter history. */
+    int                d_rds_pos;     /*! Position in d_rds_hist. */
+    float              d_rds_clock;   /*! Bit clock phase, 0 to 1. */
+    float              d_rds_energy[8];  /*! Matched filter output per bit clock phase. */
+    int                d_rds_best;    /*! Bit clock phase with the most energy. */
+    int                d_rds_bin;     /*! Bit clock phase of the last sample. */
+    int                d_rds_sym;     /*! Last symbol. */
+    unsigned int       d_rds_reg;     /*! Last 26 bits. */
+    int                d_rds_bits;    /*! Bits since the last block. */
+    int                d_rds_block;   /*! Expected block, -1 if not synchronized. */
+    int                d_rds_last;    /*! Last block found while not synchronized. */
+    int                d_rds_bad;     /*! Consecutive bad blocks. */
+    unsigned int       d_rds_group[4];   /*! Blocks of the current group. */
+    bool               d_rds_ok;      /*! Current group has no errors so far. */
+    int                d_rds_ab;      /*! Radiotext A/B flag. */
+
+    rx_wfm_status               d_info;    /*! Status owned by work(). */
+    rx_seqlock<rx_wfm_status>   d_status;  /*! Status for the GUI thread. */
+
+    void update_params(float max_dev, double tau);
+    int  process(const gr_complex *in, int num, float *left, float *right);
+    void pll_update();
+    void rds_sample(float re, float im);
+    void rds_bit(int bit);
+    void rds_group();
+};
+
+#endif // RX_DEMOD_WFM_H
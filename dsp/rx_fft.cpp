@@ -18,12 +18,81 @@
  * Boston, MA 02110-1301, USA.
  */
 #include <math.h>
+#include <string.h>
 #include <gr_io_signature.h>
 #include <gr_firdes.h>
 #include <gr_complex.h>
 #include <gri_fft.h>
+#include "dsp/fast_math.h"
+#include "dsp/fft_cache.h"
 #include "dsp/rx_fft.h"
 
+/*! \brief Number of input samples processed at a time in zoom mode. */
+#define ZOOM_CHUNK 4096
+
+
+/*! \brief Return a valid window type. */
+static int valid_window_type(int wintype)
+{
+    if ((wintype < gr_firdes::WIN_HAMMING) || (wintype > gr_firdes::WIN_BLACKMAN_hARRIS))
+        return gr_firdes::WIN_HAMMING;
+
+    return wintype;
+}
+
+/*! \brief Create FFT object and window.
+ *  \param fftsize The FFT size.
+ *  \param wintype The window type (see gr_firdes::win_type).
+ *  \param real Create a real-to-complex FFT instead of a complex one.
+ */
+rx_fft_config::rx_fft_config(int fftsize, int wintype, bool real)
+    : size(fftsize), fft(0), rfft(0),
+      zoom_freq(0.0), zoom_decim(1), zoom_incr(1.0, 0.0)
+{
+    /* get FFT object; creates the FFTW plan unless cached */
+    if (real)
+        rfft = rx_fft_cache::get_real(size);
+    else
+        fft = rx_fft_cache::get_complex(size);
+
+    /* create FFT window */
+    window = gr_firdes::window((gr_firdes::win_type)wintype, size, 6.76);
+}
+
+rx_fft_config::~rx_fft_config()
+{
+    rx_fft_cache::release(fft, size);
+    rx_fft_cache::release(rfft, size);
+}
+
+/*! \brief Set up frequency shift and decimation filter for zoom.
+ *  \param freq The zoom center frequency relative to the sample rate.
+ *  \param decim The decimation, 1 for no zoom.
+ *
+ * The filter passes 90% of the decimated bandwidth; the transition band
+ * aliases only into the outer 10% of the spectrum.
+ */
+void rx_fft_config::set_zoom(float freq, int decim)
+{
+    zoom_freq = freq;
+    zoom_decim = decim;
+    zoom_taps.clear();
+    zoom_hist.clear();
+
+    if (decim > 1) {
+        zoom_incr = gr_complex(cos(-2.0*M_PI*freq), sin(-2.0*M_PI*freq));
+        zoom_taps = gr_firdes::low_pass(1.0, 1.0, 0.45/decim, 0.1/decim,
+                                        gr_firdes::WIN_HAMMING);
+        /* the filter starts with zeros as history */
+        zoom_hist.resize(zoom_taps.size() - 1 + ZOOM_CHUNK, gr_complex(0.0, 0.0));
+    }
+    else {
+        zoom_freq = 0.0;
+        zoom_decim = 1;
+        zoom_incr = gr_complex(1.0, 0.0);
+    }
+}
+
 
 rx_fft_c_sptr make_rx_fft_c (int fftsize, int wintype)
 {
@@ -40,22 +109,42 @@ rx_fft_c::rx_fft_c(int fftsize, int wintype)
           gr_make_io_signature(1, 1, sizeof(gr_complex)),
           gr_make_io_signature(0, 0, 0)),
       d_fftsize(fftsize),
-      d_wintype(-1)
+      d_wintype(valid_window_type(wintype)),
+      d_zoom_freq(0.0),
+      d_zoom_decim(1),
+      d_pending(0),
+      d_retired(0),
+      d_params_seen(0),
+      d_ring(2*MAX_FFT_SIZE),
+      d_new(0),
+      d_next(0),
+      d_num_ffts(0),
+      d_frame_ffts(0),
+      d_zoom_phase(1.0, 0.0),
+      d_zoom_skip(0)
 {
+    if (d_fftsize > MAX_FFT_SIZE)
+        d_fftsize = MAX_FFT_SIZE;
 
-    /* create FFT object */
-    d_fft = new gri_fft_complex(d_fftsize, true);
+    d_cfg = new rx_fft_config(d_fftsize, d_wintype);
 
-    /* allocate circular buffer */
-    d_cbuf.set_capacity(d_fftsize);
+    d_set.avg = FFT_AVG_NONE;
+    d_set.alpha = 0.1;
+    d_set.overlap = 50;
+    d_set.reset = 0;
+    d_params.write(d_set);
+    d_params.read(d_cur, d_params_seen);
 
-    /* create FFT window */
-    set_window_type(wintype);
+    /* allocate once so that work() never has to */
+    d_acc.resize(MAX_FFT_SIZE);
+    d_zoom_out.resize(ZOOM_CHUNK / 2 + 1);
 }
 
 rx_fft_c::~rx_fft_c()
 {
-    delete d_fft;
+    delete d_cfg;
+    delete d_pending;
+    delete d_retired;
 }
 
 /*! \brief Receiver FFT work method.
@@ -63,94 +152,333 @@ rx_fft_c::~rx_fft_c()
  *  \param input_items
  *  \param output_items
  *
- * This method does nothing except throwing the incoming samples into the
- * circular buffer.
- * FFT is only executed when the GUI asks for new FFT data via get_fft_data().
+ * This method picks up new parameters and passes the incoming samples to
+ * process(), in zoom mode after shifting and decimating them.
  */
 int rx_fft_c::work(int noutput_items,
                    gr_vector_const_void_star &input_items,
                    gr_vector_void_star &output_items)
 {
-    int i,j = 0;
     const gr_complex *in = (const gr_complex*)input_items[0];
+    rx_fft_config *cfg;
+    rx_fft_params p;
+    bool new_avg = false;
+    int num, done;
+
+    /* pick up new FFT size, window or zoom; the GUI deletes the old one */
+    cfg = rx_exchange_ptr(&d_pending, (rx_fft_config *) 0);
+    if (cfg) {
+        delete rx_exchange_ptr(&d_retired, d_cfg);  /* normally NULL */
+        d_cfg = cfg;
+        new_avg = true;
+        d_zoom_phase = gr_complex(1.0, 0.0);
+        d_zoom_skip = 0;
+    }
 
-    /* just throw new samples into the buffer */
-    boost::mutex::scoped_lock lock(d_mutex);
-    for (i = 0; i < noutput_items; i++) {
-        d_cbuf.push_back(in[i]);
+    if (d_params.read(p, d_params_seen)) {
+        new_avg |= (p.avg != d_cur.avg) || (p.overlap != d_cur.overlap) ||
+                   (p.reset != d_cur.reset);
+        d_cur = p;
+    }
+
+    if (new_avg)
+        restart();
+
+    if (d_cfg->zoom_decim > 1) {
+        for (done = 0; done < noutput_items; done += num) {
+            num = noutput_items - done;
+            if (num > ZOOM_CHUNK)
+                num = ZOOM_CHUNK;
+
+            process(&d_zoom_out[0], zoom(in + done, num, &d_zoom_out[0]));
+        }
+    }
+    else {
+        process(in, noutput_items);
     }
 
     return noutput_items;
 
 }
 
+/*! \brief Compute FFTs of new samples.
+ *  \param in The new samples.
+ *  \param num The number of samples.
+ *
+ * The samples are thrown into the ring buffer. Without averaging a new
+ * FFT is computed when the GUI has read the previous one and at least
+ * fftsize new samples have arrived. With averaging an FFT is computed
+ * every hop = fftsize * (100 - overlap) / 100 samples and the average
+ * is published when the GUI has read the previous one.
+ */
+void rx_fft_c::process(const gr_complex *in, int num)
+{
+    const int size = d_cfg->size;
+    int hop, n, done;
+
+    if (num <= 0)
+        return;
+
+    if (d_cur.avg == FFT_AVG_NONE) {
+        d_ring.write(in, num);
+        if (d_new < MAX_FFT_SIZE)
+            d_new += num;
+
+        if ((d_new >= (unsigned int) size) && !d_frames.fresh()) {
+            do_fft(d_ring.head() - size);
+            accumulate();
+            publish_frame();
+            d_new = 0;
+        }
+    }
+    else {
+        hop = size - (size * d_cur.overlap) / 100;
+        if (hop < 1)
+            hop = 1;
+
+        /* Write at most one hop at a time so that the samples of the next
+           FFT are never overwritten before it has been computed. */
+        for (done = 0; done < num; done += n) {
+            n = num - done;
+            if (n > hop)
+                n = hop;
+
+            d_ring.write(in + done, n);
+
+            while ((int)(d_ring.head() - d_next) >= 0) {
+                do_fft(d_next - size);
+                accumulate();
+                d_next += hop;
+            }
+        }
+
+        if (d_frame_ffts && !d_frames.fresh())
+            publish_frame();
+    }
+}
+
+/*! \brief Shift the zoom frequency to 0 Hz and decimate.
+ *  \param in The input samples.
+ *  \param num The number of input samples, at most ZOOM_CHUNK.
+ *  \param out The decimated samples (output).
+ *  \return The number of decimated samples.
+ *
+ * The filter is only evaluated for the samples that are kept, so the
+ * cost is ntaps / decim multiplications per input sample.
+ */
+int rx_fft_c::zoom(const gr_complex *in, int num, gr_complex *out)
+{
+    const int decim = d_cfg->zoom_decim;
+    const int ntaps = d_cfg->zoom_taps.size();
+    const float *taps = &d_cfg->zoom_taps[0];
+    const gr_complex incr = d_cfg->zoom_incr;
+    gr_complex *hist = &d_cfg->zoom_hist[0];
+    gr_complex phase = d_zoom_phase;
+    gr_complex acc;
+    int i, j, pos, nout = 0;
+
+    /* frequency shift after the ntaps-1 samples of history */
+    for (i = 0; i < num; i++) {
+        hist[ntaps - 1 + i] = in[i] * phase;
+        phase *= incr;
+    }
+    d_zoom_phase = phase / std::abs(phase);
+
+    /* decimating FIR; the taps are symmetric so no reversal is needed */
+    for (pos = d_zoom_skip; pos < num; pos += decim) {
+        const gr_complex *x = hist + pos;
+
+        acc = gr_complex(0.0, 0.0);
+        for (j = 0; j < ntaps; j++)
+            acc += x[j] * taps[j];
+
+        out[nout++] = acc;
+    }
+    d_zoom_skip = pos - num;
+
+    /* keep the newest ntaps-1 samples as history */
+    memmove(hist, hist + num, (ntaps - 1) * sizeof(gr_complex));
+
+    return nout;
+}
+
 /*! \brief Get FFT data.
- *  \param fftPoints Buffer to copy FFT data
- *  \param fftSize Current FFT size (output).
+ *  \param fftPoints Buffer to copy the power spectrum in dBFS.
+ *  \param fftSize Current FFT size (output), 0 if there is no new data.
+ *  \param zoom_freq The center of the spectrum relative to the sample rate (output).
+ *  \param zoom_decim The zoom decimation of the spectrum (output).
+ *
+ * This only copies the newest spectrum published by work(). The center
+ * bin is at index fftSize/2 and the spectrum covers the sample rate
+ * divided by zoom_decim.
  */
-void rx_fft_c::get_fft_data(std::complex<float>* fftPoints, int &fftSize)
+void rx_fft_c::get_fft_data(float* fftPoints, int &fftSize, float &zoom_freq, int &zoom_decim)
 {
-    boost::mutex::scoped_lock lock(d_mutex);
+    /* delete configuration that work() is done with */
+    delete rx_exchange_ptr(&d_retired, (rx_fft_config *) 0);
 
-    if (d_cbuf.size() < d_fftsize) {
-        // not enough samples in the buffer
+    if (!d_frames.update()) {
+        // no new FFT since the last call
         fftSize = 0;
 
         return;
     }
 
-    /* perform FFT */
-    do_fft(d_cbuf.linearize(), d_cbuf.size());  // FIXME: array_one() and two() may be faster
-    d_cbuf.clear();
+    const rx_fft_frame &frame = d_frames.read_buffer();
 
-    /* get FFT data */
-    memcpy(fftPoints, d_fft->get_outbuf(), sizeof(gr_complex)*d_fftsize);
-    fftSize = d_fftsize;
+    fftSize = frame.data.size();
+    memcpy(fftPoints, &frame.data[0], sizeof(float)*fftSize);
+    zoom_freq = frame.zoom_freq;
+    zoom_decim = frame.zoom_decim;
 }
 
-/*! \brief Compute FFT on the available input data.
- *  \param data_in The data to compute FFT on.
- *  \param size The size of data_in.
+/*! \brief Restart averaging.
  *
- * Note that this function does not lock the mutex since the caller, get_fft_data()
- * has alrady locked it.
+ * Called by work() when the FFT configuration or averaging parameters
+ * have changed.
  */
-void rx_fft_c::do_fft(const gr_complex *data_in, int size)
+void rx_fft_c::restart()
 {
-    /* apply window, if any */
-    if (d_window.size()) {
-        gr_complex *dst = d_fft->get_inbuf();
-        int i;
+    d_new = 0;
+    d_next = d_ring.head() + d_cfg->size;
+    d_num_ffts = 0;
+    d_frame_ffts = 0;
+}
+
+/*! \brief Compute FFT of samples in the ring buffer.
+ *  \param start The ring position of the first sample.
+ *
+ * The result is left in the output buffer of the FFT object.
+ */
+void rx_fft_c::do_fft(unsigned int start)
+{
+    const int size = d_cfg->size;
+    gr_complex *buf = d_cfg->fft->get_inbuf();
+    const float *win = &d_cfg->window[0];
+    int i;
+
+    /* copy samples and apply window */
+    d_ring.read(buf, start, size);
+    for (i = 0; i < size; i++)
+        buf[i] *= win[i];
+
+    /* compute FFT */
+    d_cfg->fft->execute();
+}
+
+/*! \brief Add the power of the last FFT to the accumulator. */
+void rx_fft_c::accumulate()
+{
+    const int size = d_cfg->size;
+    const float *fft = (const float *) d_cfg->fft->get_outbuf();
+    const float alpha = d_cur.alpha;
+    const bool first = (d_cur.avg == FFT_AVG_LINEAR) ? (d_frame_ffts == 0) : (d_num_ffts == 0);
+    float *acc = &d_acc[0];
+    float pwr;
+    int i;
+
+    /* a new linear average starts with every frame; the others go on */
+    if (first || (d_cur.avg == FFT_AVG_NONE)) {
         for (i = 0; i < size; i++)
-            dst[i] = data_in[i] * d_window[i];
+            acc[i] = fft[2*i]*fft[2*i] + fft[2*i+1]*fft[2*i+1];
     }
     else {
-        memcpy(d_fft->get_inbuf(), data_in, sizeof(gr_complex)*size);
+        switch (d_cur.avg) {
+
+        case FFT_AVG_LINEAR:
+            for (i = 0; i < size; i++)
+                acc[i] += fft[2*i]*fft[2*i] + fft[2*i+1]*fft[2*i+1];
+            break;
+
+        case FFT_AVG_EXP:
+            for (i = 0; i < size; i++) {
+                pwr = fft[2*i]*fft[2*i] + fft[2*i+1]*fft[2*i+1];
+                acc[i] += alpha * (pwr - acc[i]);
+            }
+            break;
+
+        case FFT_AVG_PEAK:
+            for (i = 0; i < size; i++) {
+                pwr = fft[2*i]*fft[2*i] + fft[2*i+1]*fft[2*i+1];
+                acc[i] = (pwr > acc[i]) ? pwr : acc[i];
+            }
+            break;
+
+        case FFT_AVG_MIN:
+            for (i = 0; i < size; i++) {
+                pwr = fft[2*i]*fft[2*i] + fft[2*i+1]*fft[2*i+1];
+                acc[i] = (pwr < acc[i]) ? pwr : acc[i];
+            }
+            break;
+        }
     }
 
-    /* compute FFT */
-    d_fft->execute();
+    d_num_ffts++;
+    d_frame_ffts++;
+}
+
+/*! \brief Convert the accumulated power to dBFS and publish it.
+ *
+ * The spectrum is normalized to the FFT size and shifted so that 0 Hz
+ * is in the middle.
+ */
+void rx_fft_c::publish_frame()
+{
+    const int size = d_cfg->size;
+    const int half = size / 2;
+    const float *acc = &d_acc[0];
+    float scale = 1.0f / ((float)size * (float)size);
+    float *out;
+    int i;
+
+    if (d_cur.avg == FFT_AVG_LINEAR)
+        scale /= d_frame_ffts;
+
+    rx_fft_frame &frame = d_frames.write_buffer();
+    frame.data.resize(size);
+    frame.zoom_freq = d_cfg->zoom_freq;
+    frame.zoom_decim = d_cfg->zoom_decim;
+    out = &frame.data[0];
+
+    /* 10*log10(x) = 10*log10(2) * log2(x) */
+    for (i = 0; i < half; i++)
+        out[i] = 3.0103f * fast_log2f(acc[half + i] * scale + 1.0e-20f);
+    for (i = half; i < size; i++)
+        out[i] = 3.0103f * fast_log2f(acc[i - half] * scale + 1.0e-20f);
+
+    d_frames.publish();
+    d_frame_ffts = 0;
+}
+
+/*! \brief Create new FFT configuration and hand it over to work().
+ *
+ * The FFT object is created here so that FFTW planning does not happen
+ * in work(). Must be called with d_mutex locked.
+ */
+void rx_fft_c::configure()
+{
+    rx_fft_config *cfg = new rx_fft_config(d_fftsize, d_wintype);
+
+    cfg->set_zoom(d_zoom_freq, d_zoom_decim);
+
+    /* delete configuration that work() is done with */
+    delete rx_exchange_ptr(&d_retired, (rx_fft_config *) 0);
+
+    /* replace (and delete) configuration work() has not picked up yet */
+    delete rx_exchange_ptr(&d_pending, cfg);
 }
 
 /*! \brief Set new FFT size. */
 void rx_fft_c::set_fft_size(int fftsize)
 {
+    if (fftsize > MAX_FFT_SIZE)
+        fftsize = MAX_FFT_SIZE;
+
     if (fftsize != d_fftsize) {
         boost::mutex::scoped_lock lock(d_mutex);
 
         d_fftsize = fftsize;
-
-        /* clear and resize circular buffer */
-        d_cbuf.clear();
-        d_cbuf.set_capacity(d_fftsize);
-
-        /* reset window */
-        d_wintype = -1;
-        set_window_type(d_wintype);
-
-        /* reset FFT object (also reset FFTW plan) */
-        delete d_fft;
-        d_fft = new gri_fft_complex (d_fftsize, true);
+        configure();
     }
 
 }
@@ -164,19 +492,17 @@ int rx_fft_c::get_fft_size()
 /*! \brief Set new window type. */
 void rx_fft_c::set_window_type(int wintype)
 {
+    wintype = valid_window_type(wintype);
+
     if (wintype == d_wintype) {
         /* nothing to do */
         return;
     }
 
-    d_wintype = wintype;
-
-    if ((d_wintype < gr_firdes::WIN_HAMMING) || (d_wintype > gr_firdes::WIN_BLACKMAN_hARRIS)) {
-        d_wintype = gr_firdes::WIN_HAMMING;
-    }
+    boost::mutex::scoped_lock lock(d_mutex);
 
-    d_window.clear();
-    d_window = gr_firdes::window((gr_firdes::win_type)d_wintype, d_fftsize, 6.76);
+    d_wintype = wintype;
+    configure();
 }
 
 /*! \brief Get currently used window type. */
@@ -185,6 +511,90 @@ int rx_fft_c::get_window_type()
     return d_wintype;
 }
 
+/*! \brief Set zoom.
+ *  \param freq The center of the zoomed spectrum relative to the sample rate
+ *              (-0.5 to 0.5).
+ *  \param decim The zoom factor, 1 to MAX_ZOOM_DECIM. 1 turns zoom off.
+ *
+ * The zoomed spectrum has the same number of bins as the full spectrum,
+ * so the resolution improves by the zoom factor but it takes decim times
+ * longer to collect the samples for one FFT.
+ */
+void rx_fft_c::set_zoom(float freq, int decim)
+{
+    if (decim < 1)
+        decim = 1;
+    if (decim > MAX_ZOOM_DECIM)
+        decim = MAX_ZOOM_DECIM;
+    if (decim == 1)
+        freq = 0.0;
+
+    if ((freq == d_zoom_freq) && (decim == d_zoom_decim))
+        return;
+
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    d_zoom_freq = freq;
+    d_zoom_decim = decim;
+    configure();
+}
+
+/*! \brief Set averaging mode.
+ *  \param mode The new averaging mode (see rx_fft_avg).
+ *
+ * This always restarts averaging, also if the mode is unchanged.
+ */
+void rx_fft_c::set_averaging(int mode)
+{
+    if ((mode < FFT_AVG_NONE) || (mode > FFT_AVG_MIN))
+        mode = FFT_AVG_NONE;
+
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    d_set.avg = mode;
+    d_set.reset++;
+    d_params.write(d_set);
+}
+
+/*! \brief Set exponential averaging coefficient.
+ *  \param alpha The weight of a new FFT, 0 < alpha <= 1.
+ */
+void rx_fft_c::set_avg_alpha(float alpha)
+{
+    if ((alpha <= 0.0f) || (alpha > 1.0f))
+        return;
+
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    d_set.alpha = alpha;
+    d_params.write(d_set);
+}
+
+/*! \brief Set overlap between successive FFTs when averaging.
+ *  \param percent The overlap in percent, 0 to 90.
+ */
+void rx_fft_c::set_overlap(int percent)
+{
+    if (percent < 0)
+        percent = 0;
+    else if (percent > 90)
+        percent = 90;
+
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    d_set.overlap = percent;
+    d_params.write(d_set);
+}
+
+/*! \brief Restart averaging, e.g. to clear peak or min hold. */
+void rx_fft_c::reset_averaging()
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    d_set.reset++;
+    d_params.write(d_set);
+}
+
 
 /**   rx_fft_f     **/
 
@@ -203,22 +613,25 @@ rx_fft_f::rx_fft_f(int fftsize, int wintype)
           gr_make_io_signature(1, 1, sizeof(float)),
           gr_make_io_signature(0, 0, 0)),
       d_fftsize(fftsize),
-      d_wintype(-1)
+      d_wintype(valid_window_type(wintype)),
+      d_pending(0),
+      d_retired(0),
+      d_ring(MAX_FFT_SIZE),
+      d_new(0),
+      d_silence(0),
+      d_silent(false)
 {
+    if (d_fftsize > MAX_FFT_SIZE)
+        d_fftsize = MAX_FFT_SIZE;
 
-    /* create FFT object */
-    d_fft = new gri_fft_complex(d_fftsize, true);
-
-    /* allocate circular buffer */
-    d_cbuf.set_capacity(d_fftsize);
-
-    /* create FFT window */
-    set_window_type(wintype);
+    d_cfg = new rx_fft_config(d_fftsize, d_wintype, true);
 }
 
 rx_fft_f::~rx_fft_f()
 {
-    delete d_fft;
+    delete d_cfg;
+    delete d_pending;
+    delete d_retired;
 }
 
 /*! \brief Audio FFT work method.
@@ -226,96 +639,138 @@ rx_fft_f::~rx_fft_f()
  *  \param input_items
  *  \param output_items
  *
- * This method does nothing except throwing the incoming samples into the
- * circular buffer.
- * FFT is only executed when the GUI asks for new FFT data via get_fft_data().
+ * This method throws the incoming samples into the ring buffer and
+ * computes a new FFT when the GUI has read the previous one and at least
+ * fftsize new samples have arrived.
  */
 int rx_fft_f::work(int noutput_items,
                    gr_vector_const_void_star &input_items,
                    gr_vector_void_star &output_items)
 {
-    int i,j = 0;
     const float *in = (const float*)input_items[0];
+    rx_fft_config *cfg;
+
+    /* pick up new FFT size or window; the GUI deletes the old one */
+    cfg = rx_exchange_ptr(&d_pending, (rx_fft_config *) 0);
+    if (cfg) {
+        delete rx_exchange_ptr(&d_retired, d_cfg);  /* normally NULL */
+        d_cfg = cfg;
+        d_silent = false;
+    }
 
-    /* just throw new samples into the buffer */
-    boost::mutex::scoped_lock lock(d_mutex);
-    for (i = 0; i < noutput_items; i++) {
-        d_cbuf.push_back(in[i]);
+    noutput_items = d_gate.update(this, noutput_items);
+    if (d_gate.open())
+        d_silence = 0;
+    else if (d_silence < MAX_FFT_SIZE)
+        d_silence += noutput_items;
+
+    d_ring.write(in, noutput_items);
+    if (d_new < MAX_FFT_SIZE)
+        d_new += noutput_items;
+
+    if ((d_new >= (unsigned int) d_cfg->size) && !d_frames.fresh()) {
+        /* the spectrum of silence only needs to be shown once */
+        if ((d_silence < (unsigned int) d_cfg->size) || !d_silent) {
+            do_fft();
+            d_silent = (d_silence >= (unsigned int) d_cfg->size);
+        }
+        d_new = 0;
     }
 
     return noutput_items;
 }
 
 /*! \brief Get FFT data.
- *  \param fftPoints Buffer to copy FFT data
- *  \param fftSize Current FFT size (output).
+ *  \param fftPoints Buffer to copy the power spectrum in dBFS.
+ *  \param fftSize Number of bins (output), 0 if there is no new data.
+ *
+ * This only copies the newest spectrum published by work(). It contains
+ * the fftsize/2+1 bins from 0 Hz to fs/2.
  */
-void rx_fft_f::get_fft_data(std::complex<float>* fftPoints, int &fftSize)
+void rx_fft_f::get_fft_data(float* fftPoints, int &fftSize)
 {
-    boost::mutex::scoped_lock lock(d_mutex);
+    /* delete configuration that work() is done with */
+    delete rx_exchange_ptr(&d_retired, (rx_fft_config *) 0);
 
-    if (d_cbuf.size() < d_fftsize) {
-        // not enough samples in the buffer
+    if (!d_frames.update()) {
+        // no new FFT since the last call
         fftSize = 0;
 
         return;
     }
 
-    /* perform FFT */
-    do_fft(d_cbuf.linearize(), d_cbuf.size());  // FIXME: array_one() and two() may be faster
-    d_cbuf.clear();
+    const std::vector<float> &frame = d_frames.read_buffer();
 
-    /* get FFT data */
-    memcpy(fftPoints, d_fft->get_outbuf(), sizeof(gr_complex)*d_fftsize);
-    fftSize = d_fftsize;
+    fftSize = frame.size();
+    memcpy(fftPoints, &frame[0], sizeof(float)*fftSize);
 }
 
-/*! \brief Compute FFT on the available input data.
- *  \param data_in The data to compute FFT on.
- *  \param size The size of data_in.
+/*! \brief Compute FFT on the newest samples and publish the result.
  *
- * Note that this function does not lock the mutex since the caller, get_fft_data()
- * has alrady locked it.
+ * Called by work() only.
  */
-void rx_fft_f::do_fft(const float *data_in, int size)
+void rx_fft_f::do_fft()
 {
-    gr_complex *dst = d_fft->get_inbuf();
+    const int size = d_cfg->size;
+    const int bins = size/2 + 1;
+    const float scale = 1.0f / ((float)size * (float)size);
+    float *buf = d_cfg->rfft->get_inbuf();
+    const float *win = &d_cfg->window[0];
+    const float *fft;
+    float *out;
     int i;
 
-    /* apply window, and convert to complex */
-    if (d_window.size()) {
-        for (i = 0; i < size; i++)
-            dst[i] = data_in[i] * d_window[i];
-    }
-    else {
-        for (i = 0; i < size; i++)
-            dst[i] = data_in[i];
-    }
+    /* copy newest samples and apply window */
+    d_ring.read(buf, d_ring.head() - size, size);
+    for (i = 0; i < size; i++)
+        buf[i] *= win[i];
 
-    /* compute FFT */
-    d_fft->execute();
+    /* compute FFT (non-negative frequencies only) */
+    d_cfg->rfft->execute();
+
+    /* publish power in dBFS */
+    std::vector<float> &frame = d_frames.write_buffer();
+    frame.resize(bins);
+    out = &frame[0];
+    fft = (const float *) d_cfg->rfft->get_outbuf();
+
+    for (i = 0; i < bins; i++)
+        out[i] = (fft[2*i]*fft[2*i] + fft[2*i+1]*fft[2*i+1]) * scale + 1.0e-20f;
+
+    /* 10*log10(x) = 10*log10(2) * log2(x) */
+    for (i = 0; i < bins; i++)
+        out[i] = 3.0103f * fast_log2f(out[i]);
+
+    d_frames.publish();
 }
 
+/*! \brief Create new FFT configuration and hand it over to work().
+ *
+ * The FFT object is created here so that FFTW planning does not happen
+ * in work(). Must be called with d_mutex locked.
+ */
+void rx_fft_f::configure()
+{
+    rx_fft_config *cfg = new rx_fft_config(d_fftsize, d_wintype, true);
+
+    /* delete configuration that work() is done with */
+    delete rx_exchange_ptr(&d_retired, (rx_fft_config *) 0);
+
+    /* replace (and delete) configuration work() has not picked up yet */
+    delete rx_exchange_ptr(&d_pending, cfg);
+}
 
 /*! \brief Set new FFT size. */
 void rx_fft_f::set_fft_size(int fftsize)
 {
+    if (fftsize > MAX_FFT_SIZE)
+        fftsize = MAX_FFT_SIZE;
+
     if (fftsize != d_fftsize) {
         boost::mutex::scoped_lock lock(d_mutex);
 
         d_fftsize = fftsize;
-
-        /* clear and resize circular buffer */
-        d_cbuf.clear();
-        d_cbuf.set_capacity(d_fftsize);
-
-        /* reset window */
-        d_wintype = -1;
-        set_window_type(d_wintype);
-
-        /* reset FFT object (also reset FFTW plan) */
-        delete d_fft;
-        d_fft = new gri_fft_complex(d_fftsize, true);
+        configure();
     }
 }
 
@@ -328,19 +783,17 @@ int rx_fft_f::get_fft_size()
 /*! \brief Set new window type. */
 void rx_fft_f::set_window_type(int wintype)
 {
+    wintype = valid_window_type(wintype);
+
     if (wintype == d_wintype) {
         /* nothing to do */
         return;
     }
 
-    d_wintype = wintype;
-
-    if ((d_wintype < gr_firdes::WIN_HAMMING) || (d_wintype > gr_firdes::WIN_BLACKMAN_hARRIS)) {
-        d_wintype = gr_firdes::WIN_HAMMING;
-    }
+    boost::mutex::scoped_lock lock(d_mutex);
 
-    d_window.clear();
-    d_window = gr_firdes::window((gr_firdes::win_type)d_wintype, d_fftsize, 6.76);
+    d_wintype = wintype;
+    configure();
 }
 
 /*! \brief Get currently used window type. */
@@ -25,11 +25,70 @@
 #include <gr_firdes.h>       /* contains enum win_type */
 #include <gr_complex.h>
 #include <boost/thread/mutex.hpp>
-#include <boost/circular_buffer.hpp>
+#include "dsp/lockfree.h"
+#include "dsp/rx_squelch.h"
 
 
 #define MAX_FFT_SIZE 20480
 
+#define MAX_ZOOM_DECIM 64    /*!< Largest zoom factor of rx_fft_c. */
+
+
+/*! \brief FFT object and window used by work().
+ *
+ * A new configuration is created by the GUI thread when the FFT size or
+ * window changes, so that the FFTW plan is never created in work(), and
+ * handed over to work() using rx_exchange_ptr().
+ */
+struct rx_fft_config
+{
+    rx_fft_config(int fftsize, int wintype, bool real=false);
+    ~rx_fft_config();
+
+    void set_zoom(float freq, int decim);
+
+    int                 size;    /*!< FFT size. */
+    gri_fft_complex    *fft;     /*!< Complex FFT object (NULL if real). */
+    gri_fft_real_fwd   *rfft;    /*!< Real FFT object (NULL if complex). */
+    std::vector<float>  window;  /*!< FFT window taps. */
+
+    float               zoom_freq;   /*!< Zoom center frequency relative to the sample rate. */
+    int                 zoom_decim;  /*!< Zoom decimation, 1 if not zoomed. */
+    gr_complex          zoom_incr;   /*!< Phase increment shifting zoom_freq to 0 Hz. */
+    std::vector<float>  zoom_taps;   /*!< Decimation filter taps. */
+    std::vector<gr_complex> zoom_hist;  /*!< Decimation filter history and input. */
+};
+
+
+/*! \brief FFT result published by rx_fft_c. */
+struct rx_fft_frame
+{
+    std::vector<float>  data;        /*!< Power in dBFS, 0 Hz in the middle. */
+    float               zoom_freq;   /*!< Center frequency relative to the sample rate. */
+    int                 zoom_decim;  /*!< The spectrum covers sample rate / zoom_decim. */
+};
+
+
+/*! \brief Averaging modes of the complex FFT. */
+enum rx_fft_avg {
+    FFT_AVG_NONE   = 0,  /*!< No averaging, newest FFT only. */
+    FFT_AVG_LINEAR = 1,  /*!< Linear average of the FFTs within a frame. */
+    FFT_AVG_EXP    = 2,  /*!< Exponential average. */
+    FFT_AVG_PEAK   = 3,  /*!< Peak hold. */
+    FFT_AVG_MIN    = 4   /*!< Min hold. */
+};
+
+
+/*! \brief FFT averaging parameters passed from the setters to work(). */
+struct rx_fft_params
+{
+    int          avg;      /*!< Averaging mode, see rx_fft_avg. */
+    float        alpha;    /*!< Exponential averaging coefficient per FFT. */
+    int          overlap;  /*!< Overlap between FFTs in percent. */
+    unsigned int reset;    /*!< Incremented to restart averaging. */
+};
+
+
 class rx_fft_c;
 class rx_fft_f;
 
@@ -53,10 +112,23 @@ rx_fft_c_sptr make_rx_fft_c(int fftsize=4096, int wintype=gr_firdes::WIN_HAMMING
  *
  * This block is used to compute the FFT of the received spectrum.
  *
- * The samples are collected in a cicular buffer with size FFT_SIZE.
- * When the GUI asks for a new set of FFT data via get_fft_data() an FFT
- * will be performed on the data stored in the circular buffer - assuming
- * of course that the buffer contains at least fftsize samples.
+ * The FFT is computed in work() on the newest fftsize samples and published
+ * using a triple buffer. get_fft_data() only copies the newest published
+ * result, so the GUI never waits for work() and vice versa. To avoid
+ * computing FFTs that are never displayed, work() only computes a new FFT
+ * when the previous one has been read by the GUI and at least fftsize new
+ * samples have arrived since then.
+ *
+ * In the averaging modes every sample is used: work() computes windowed
+ * FFTs that overlap by a configurable amount (Welch's method) and
+ * averages their power. The averaged power is published once per frame,
+ * i.e. whenever the GUI has read the previous one.
+ *
+ * The result is the power in dBFS with the 0 Hz bin in the middle.
+ *
+ * In zoom mode (see set_zoom()) the input is shifted in frequency and
+ * decimated before the FFT, so that an FFT of the same size shows a
+ * narrow part of the spectrum with higher resolution.
  *
  * \note Uses code from qtgui_sink_c
  */
@@ -74,7 +146,7 @@ public:
              gr_vector_const_void_star &input_items,
              gr_vector_void_star &output_items);
 
-    void get_fft_data(std::complex<float>* fftPoints, int &fftSize);
+    void get_fft_data(float* fftPoints, int &fftSize, float &zoom_freq, int &zoom_decim);
 
     void set_window_type(int wintype);
     int  get_window_type();
@@ -82,18 +154,53 @@ public:
     void set_fft_size(int fftsize);
     int  get_fft_size();
 
+    void set_zoom(float freq, int decim);
+
+    void set_averaging(int mode);
+    int  get_averaging() { return d_set.avg; }
+    void set_avg_alpha(float alpha);
+    void set_overlap(int percent);
+    int  get_overlap() { return d_set.overlap; }
+    void reset_averaging();
+
 private:
-    int  d_fftsize;   /*! Current FFT size. */
-    int  d_wintype;   /*! Current window type. */
+    int   d_fftsize;     /*! Current FFT size. */
+    int   d_wintype;     /*! Current window type. */
+    float d_zoom_freq;   /*! Current zoom frequency. */
+    int   d_zoom_decim;  /*! Current zoom decimation. */
+
+    boost::mutex d_mutex;  /*! Serializes the setters, never taken by work(). */
+
+    rx_fft_config                 *d_cfg;      /*! Configuration used by work(). */
+    rx_fft_config * volatile       d_pending;  /*! New configuration for work(). */
+    rx_fft_config * volatile       d_retired;  /*! Old configuration to be deleted by the GUI. */
 
-    boost::mutex d_mutex;  /*! Used to lock FFT output buffer. */
+    rx_fft_params                  d_set;          /*! Parameters set by the setters. */
+    rx_seqlock<rx_fft_params>      d_params;       /*! Parameters published to work(). */
+    unsigned int                   d_params_seen;  /*! Last snapshot used by work(). */
+    rx_fft_params                  d_cur;          /*! Parameters used by work(). */
 
-    gri_fft_complex    *d_fft;    /*! FFT object. */
-    std::vector<float>  d_window; /*! FFT window taps. */
+    rx_ring_buffer<gr_complex>     d_ring;     /*! Sample history. */
+    unsigned int                   d_new;      /*! Samples since the last FFT (no averaging). */
+    unsigned int                   d_next;     /*! Ring position where the next FFT ends (averaging). */
 
-    boost::circular_buffer<gr_complex> d_cbuf; /*! buffer to accumulate samples. */
+    std::vector<float>             d_acc;         /*! Accumulated power per bin. */
+    unsigned int                   d_num_ffts;    /*! FFTs accumulated since reset. */
+    unsigned int                   d_frame_ffts;  /*! FFTs accumulated since the last frame. */
 
-    void do_fft(const gr_complex *data_in, int size);
+    gr_complex                     d_zoom_phase;  /*! Phase of the zoom frequency shift. */
+    std::vector<gr_complex>        d_zoom_out;    /*! Decimated samples. */
+    int                            d_zoom_skip;   /*! Input samples until the next output. */
+
+    rx_triple_buffer<rx_fft_frame> d_frames;   /*! Published power spectra. */
+
+    void configure();
+    void restart();
+    void process(const gr_complex *in, int num);
+    int  zoom(const gr_complex *in, int num, gr_complex *out);
+    void do_fft(unsigned int start);
+    void accumulate();
+    void publish_frame();
 
 };
 
@@ -115,10 +222,13 @@ rx_fft_f_sptr make_rx_fft_f(int fftsize=1024, int wintype=gr_firdes::WIN_HAMMING
  * This block is used to compute the FFT of the audio spectrum or anything
  * else where real FFT is useful.
  *
- * The samples are collected in a cicular buffer with size FFT_SIZE.
- * When the GUI asks for a new set of FFT data using get_fft_data() an FFT
- * will be performed on the data stored in the circular buffer - assuming
- * that the buffer contains at least fftsize samples.
+ * The FFT is computed in work() and published to get_fft_data() the same
+ * way as in rx_fft_c, but without averaging. Since the input is real a
+ * real-to-complex FFT is used and only the fftsize/2+1 bins from 0 Hz to
+ * fs/2 are computed and returned, as power in dBFS.
+ *
+ * While the squelch is closed the spectrum of the silence is published
+ * once and no further FFTs are computed.
  *
  * \note Uses code from qtgui_sink_f
  */
@@ -136,7 +246,7 @@ public:
              gr_vector_const_void_star &input_items,
              gr_vector_void_star &output_items);
 
-    void get_fft_data(std::complex<float>* fftPoints, int &fftSize);
+    void get_fft_data(float* fftPoints, int &fftSize);
 
     void set_window_type(int wintype);
     int  get_window_type();
@@ -148,14 +258,22 @@ private:
     int  d_fftsize;   /*! Current FFT size. */
     int  d_wintype;   /*! Current window type. */
 
-    boost::mutex d_mutex;  /*! Used to lock FFT output buffer. */
+    boost::mutex d_mutex;  /*! Serializes the setters, never taken by work(). */
+
+    rx_fft_config                 *d_cfg;      /*! Configuration used by work(). */
+    rx_fft_config * volatile       d_pending;  /*! New configuration for work(). */
+    rx_fft_config * volatile       d_retired;  /*! Old configuration to be deleted by the GUI. */
 
-    gri_fft_complex    *d_fft;    /*! FFT object. */
-    std::vector<float>  d_window; /*! FFT window taps. */
+    rx_ring_buffer<float>          d_ring;     /*! Sample history. */
+    unsigned int                   d_new;      /*! Samples since the last FFT. */
+    unsigned int                   d_silence;  /*! Samples since the squelch closed. */
+    bool                           d_silent;   /*! Spectrum of silence has been published. */
+    rx_squelch_gate                d_gate;     /*! Squelch state of the input. */
 
-    boost::circular_buffer<float> d_cbuf; /*! buffer to accumulate samples. */
+    rx_triple_buffer< std::vector<float> >  d_frames;  /*! Published power spectra. */
 
-    void do_fft(const float *data_in, int size);
+    void configure();
+    void do_fft();
 
 };
 
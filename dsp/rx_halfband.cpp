@@ -0,0 +1,123 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <cmath>
+#include <gr_io_signature.h>
+#include <gr_firdes.h>
+#include <dsp/rx_halfband.h>
+
+
+rx_halfband_cc_sptr make_rx_halfband_cc(const std::vector<float> &taps)
+{
+    return gnuradio::get_initial_sptr(new rx_halfband_cc(taps));
+}
+
+rx_halfband_cc::rx_halfband_cc(const std::vector<float> &taps)
+    : gr_sync_decimator ("rx_halfband_cc",
+          gr_make_io_signature(1, 1, sizeof(gr_complex)),
+          gr_make_io_signature(1, 1, sizeof(gr_complex)),
+          2),
+      d_mid((taps.size() - 1) / 2)
+{
+    unsigned int i;
+
+    /* taps are symmetric so the order used by work() does not matter */
+    for (i = 0; i < taps.size(); i += 2)
+        d_taps.push_back(taps[i]);
+    d_ntaps = d_taps.size();
+    d_center = taps[d_mid];
+
+    set_history(taps.size());
+}
+
+rx_halfband_cc::~rx_halfband_cc()
+{
+}
+
+
+int rx_halfband_cc::work(int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    gr_complex *out = (gr_complex *) output_items[0];
+    const gr_complex *x;
+    gr_complex acc0, acc1;
+    int i, j;
+
+    for (i = 0; i < noutput_items; i++)
+    {
+        x = &in[2*i];
+        acc0 = acc1 = gr_complex(0.0f, 0.0f);
+
+        /* two partial sums over the non-zero taps, 4 input samples apart */
+        for (j = 0; j < d_ntaps; j += 2)
+        {
+            acc0 += d_taps[j] * x[2*j];
+            acc1 += d_taps[j+1] * x[2*j+2];
+        }
+
+        out[i] = acc0 + acc1 + d_center * x[d_mid];
+    }
+
+    return noutput_items;
+}
+
+
+/*! \brief Design half-band low pass filter.
+ *  \param sample_rate The input sample rate.
+ *  \param trans_width The transition width centered on sample_rate/4.
+ *  \return The filter taps with unity gain at DC.
+ *
+ * The length is estimated like gr_firdes::low_pass() for the Hamming window
+ * and rounded up to 4m+3. The taps that should be zero are set to exactly
+ * zero.
+ */
+std::vector<float> rx_halfband_cc::design(double sample_rate, double trans_width)
+{
+    std::vector<float> win;
+    std::vector<float> taps;
+    double gain = 0.0;
+    int len, mid, n, k;
+
+    len = (int) ceil(53.0 * sample_rate / (22.0 * trans_width));
+    len = (len <= 3) ? 3 : 4 * ((len - 3 + 3) / 4) + 3;
+    mid = (len - 1) / 2;
+
+    win = gr_firdes::window(gr_firdes::WIN_HAMMING, len, 6.76);
+    taps.resize(len);
+
+    for (n = 0; n < len; n++)
+    {
+        k = n - mid;
+        if (k == 0)
+            taps[n] = 0.5 * win[n];
+        else if (k % 2 == 0)
+            taps[n] = 0.0f;
+        else
+            taps[n] = win[n] * sin(0.5 * M_PI * k) / (M_PI * k);
+
+        gain += taps[n];
+    }
+
+    for (n = 0; n < len; n++)
+        taps[n] /= gain;
+
+    return taps;
+}
@@ -0,0 +1,82 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RX_HALFBAND_H
+#define RX_HALFBAND_H
+
+#include <gr_sync_decimator.h>
+#include <gr_complex.h>
+#include <vector>
+
+
+class rx_halfband_cc;
+
+typedef boost::shared_ptr<rx_halfband_cc> rx_halfband_cc_sptr;
+
+
+/*! \brief Return a shared_ptr to a new instance of rx_halfband_cc.
+ *  \param taps The half-band filter taps, see rx_halfband_cc::design().
+ *
+ * This is effectively the public constructor. To avoid accidental use
+ * of raw pointers, the rx_halfband_cc constructor is private.
+ * make_rx_halfband_cc is the public interface for creating new instances.
+ */
+rx_halfband_cc_sptr make_rx_halfband_cc(const std::vector<float> &taps);
+
+
+/*! \brief Half-band decimator by 2.
+ *  \ingroup DSP
+ *
+ * A half-band low pass filter has its cutoff at a quarter of the sample rate
+ * and every other tap is zero except for the center tap. This block only
+ * multiplies the non-zero taps, i.e. an N tap filter costs (N+3)/2 MACs per
+ * output sample instead of N.
+ *
+ * The taps must have a length of 4m+3 so that the center tap is at an odd
+ * position and the taps at the even positions are the non-zero ones.
+ */
+class rx_halfband_cc : public gr_sync_decimator
+{
+    friend rx_halfband_cc_sptr make_rx_halfband_cc(const std::vector<float> &taps);
+
+protected:
+    rx_halfband_cc(const std::vector<float> &taps);
+
+public:
+    ~rx_halfband_cc();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    static std::vector<float> design(double sample_rate, double trans_width);
+
+    /*! \brief Number of taps that are multiplied per output sample. */
+    static unsigned int nonzero_taps(const std::vector<float> &taps) { return (taps.size() + 3) / 2; }
+
+private:
+    std::vector<float> d_taps;  /*! The taps at the even positions. */
+    float  d_center;            /*! The center tap. */
+    int    d_ntaps;             /*! Number of taps in d_taps (even). */
+    int    d_mid;               /*! Position of the center tap. */
+
+};
+
+
+#endif /* RX_HALFBAND_H */
@@ -20,27 +20,40 @@
 #include <math.h>
 #include <gr_io_signature.h>
 #include <dsp/rx_meter.h>
-#include <iostream>
 
 
-rx_meter_c_sptr make_rx_meter_c (int detector)
+/*! \brief Number of samples processed in parallel by accumulate(). */
+#define METER_LANES 8
+
+/*! \brief Level reported before the first window is complete. */
+#define METER_FLOOR_DB -200.0f
+
+
+rx_meter_c_sptr make_rx_meter_c (int detector, double sample_rate)
 {
-    return gnuradio::get_initial_sptr(new rx_meter_c (detector));
+    return gnuradio::get_initial_sptr(new rx_meter_c (detector, sample_rate));
 }
 
-rx_meter_c::rx_meter_c(int detector)
+rx_meter_c::rx_meter_c(int detector, double sample_rate)
     : gr_sync_block ("rx_meter_c",
           gr_make_io_signature(1, 1, sizeof(gr_complex)),
           gr_make_io_signature(0, 0, 0)),
       d_detector(detector),
-      d_level(0.0),
-      d_level_db(0.0),
       d_fs(1.0),
-      d_sum(0.0),
-      d_sumsq(0.0),
-      d_num(0)
+      d_sample_rate(sample_rate),
+      d_window(0.1),
+      d_window_seen(0),
+      d_history(METER_HISTORY)
 {
+    d_latest.peak = METER_FLOOR_DB;
+    d_latest.avg = METER_FLOOR_DB;
+    d_latest.rms = METER_FLOOR_DB;
+    d_latest.min = METER_FLOOR_DB;
+    d_result.write(d_latest);
 
+    update_window();
+    d_window_len.read(d_len, d_window_seen);
+    reset_stats();
 }
 
 rx_meter_c::~rx_meter_c()
@@ -48,128 +61,214 @@ rx_meter_c::~rx_meter_c()
 }
 
 
-#define ALPHA 0.4
-
+/*! \brief Signal meter work method.
+ *
+ * Accumulates the samples into the current window and publishes the
+ * result each time a window is complete.
+ */
 int rx_meter_c::work (int noutput_items,
                       gr_vector_const_void_star &input_items,
                       gr_vector_void_star &output_items)
 {
     const gr_complex *in = (const gr_complex *) input_items[0];
-    float sum;
-    float pwr = 0.0;
-    int   i = 0;
-
+    int done, num;
 
-    sum = in[0].real()*in[0].real() + in[0].imag()*in[0].imag();
-
-    if (d_num == 0)
+    // new window length; start a new window
+    if (d_window_len.read(num, d_window_seen))
     {
-        // first sample after a reset
-        d_level = in[0].real()*in[0].real() + in[0].imag()*in[0].imag();
-        d_sum = d_level;
-        d_sumsq = d_level*d_level;
-        i = 1;
+        d_len = num;
+        reset_stats();
     }
 
-    d_num += noutput_items;
-
-    // processing depends on detector type
-    switch (d_detector)
+    for (done = 0; done < noutput_items; done += num)
     {
-    case DETECTOR_TYPE_SAMPLE:
-        // just take the first sample
-        d_level = in[0].real()*in[0].real() + in[0].imag()*in[0].imag();
-        break;
+        num = noutput_items - done;
+        if (num > d_len - d_num)
+            num = d_len - d_num;
 
-    case DETECTOR_TYPE_MIN:
-        // minimum peak
-        while (i < noutput_items)
-        {
-            pwr = in[i].real()*in[i].real() + in[i].imag()*in[i].imag();
-            if (pwr < d_level)
-                d_level = pwr;
-            i++;
-        }
-        break;
+        accumulate(in + done, num);
+        d_num += num;
 
-    case DETECTOR_TYPE_MAX:
-        // maximum peak
-        while (i < noutput_items)
+        if (d_num >= d_len)
         {
-            pwr = in[i].real()*in[i].real() + in[i].imag()*in[i].imag();
-            if (pwr > d_level)
-                d_level = pwr;
-            i++;
+            publish();
+            reset_stats();
         }
-        break;
+    }
 
-    case DETECTOR_TYPE_AVG:
-        // mean value
-        while (i < noutput_items)
-        {
-            pwr = in[i].real()*in[i].real() + in[i].imag()*in[i].imag();
-            d_sum += pwr;
-            i++;
-        }
-        d_level = d_sum / (float)(d_num);
-        break;
+    return noutput_items;
+}
+
+/*! \brief Add samples to the current window.
+ *
+ * All detectors are updated in the same pass. The samples are processed
+ * METER_LANES at a time with separate partial results, which lets the
+ * compiler vectorize the loop without reordering floating point sums.
+ */
+void rx_meter_c::accumulate(const gr_complex *in, int num)
+{
+    const float *x = (const float *) in;
+    float sum_pwr[METER_LANES];
+    float sum_mag[METER_LANES];
+    float max[METER_LANES];
+    float min[METER_LANES];
+    float pwr, sp = 0.0f, sm = 0.0f;
+    int i, k;
 
-    case DETECTOR_TYPE_RMS:
-        // root mean square
-        while (i < noutput_items)
+    for (k = 0; k < METER_LANES; k++)
+    {
+        sum_pwr[k] = 0.0f;
+        sum_mag[k] = 0.0f;
+        max[k] = d_max;
+        min[k] = d_min;
+    }
+
+    for (i = 0; i + METER_LANES <= num; i += METER_LANES)
+    {
+        for (k = 0; k < METER_LANES; k++)
         {
-            pwr = in[i].real()*in[i].real() + in[i].imag()*in[i].imag();
-            d_sumsq += pwr*pwr;
-            i++;
+            pwr = x[2*(i+k)]*x[2*(i+k)] + x[2*(i+k)+1]*x[2*(i+k)+1];
+            sum_pwr[k] += pwr;
+            sum_mag[k] += sqrtf(pwr);
+            max[k] = (pwr > max[k]) ? pwr : max[k];
+            min[k] = (pwr < min[k]) ? pwr : min[k];
         }
-        d_level = sqrt(d_sumsq / (float)(d_num));
-        break;
+    }
 
-    default:
-        std::cout << "Invalid detector type: " << d_detector << std::endl;
-        std::cout << "Fallback to DETECTOR_TYPE_RMS." << std::endl;
-        d_detector = DETECTOR_TYPE_RMS;
-        break;
+    // remaining samples
+    for (; i < num; i++)
+    {
+        pwr = x[2*i]*x[2*i] + x[2*i+1]*x[2*i+1];
+        sum_pwr[0] += pwr;
+        sum_mag[0] += sqrtf(pwr);
+        max[0] = (pwr > max[0]) ? pwr : max[0];
+        min[0] = (pwr < min[0]) ? pwr : min[0];
     }
 
-    d_level_db = (float) 10. * log10(d_level / d_fs + 1.0e-20);
+    for (k = 0; k < METER_LANES; k++)
+    {
+        sp += sum_pwr[k];
+        sm += sum_mag[k];
+        d_max = (max[k] > d_max) ? max[k] : d_max;
+        d_min = (min[k] < d_min) ? min[k] : d_min;
+    }
 
-    return noutput_items;
+    d_sum_pwr += sp;
+    d_sum_mag += sm;
+}
+
+/*! \brief Publish the result of the current window. */
+void rx_meter_c::publish()
+{
+    const double fs_db = 10.0 * log10(d_fs);
+    double mean_pwr = d_sum_pwr / d_num;
+    double mean_mag = d_sum_mag / d_num;
+
+    d_latest.peak = (float)(10.0 * log10(d_max + 1.0e-20) - fs_db);
+    d_latest.avg  = (float)(20.0 * log10(mean_mag + 1.0e-10) - fs_db);
+    d_latest.rms  = (float)(10.0 * log10(mean_pwr + 1.0e-20) - fs_db);
+    d_latest.min  = (float)(10.0 * log10(d_min + 1.0e-20) - fs_db);
+
+    d_result.publish(d_latest);
+    d_history.write(&d_latest, 1);
 }
 
 
+/*! \brief Get the current signal level of the selected detector as power. */
 float rx_meter_c::get_level()
 {
-    float retval = d_level;
-    reset_stats();
-
-    return retval;
+    return powf(10.0f, get_level_db() / 10.0f) * d_fs;
 }
 
+/*! \brief Get the current signal level of the selected detector in dBFS. */
 float rx_meter_c::get_level_db()
 {
-    float retval = d_level_db;
-    reset_stats();
+    rx_meter_level levels = d_result.get();
+
+    switch (d_detector)
+    {
+    case DETECTOR_TYPE_MIN:
+        return levels.min;
+
+    case DETECTOR_TYPE_MAX:
+        return levels.peak;
+
+    case DETECTOR_TYPE_AVG:
+        return levels.avg;
+
+    default:
+        return levels.rms;
+    }
+}
 
-    return retval;
+/*! \brief Get all levels of the last complete window. */
+rx_meter_level rx_meter_c::get_levels()
+{
+    return d_result.get();
+}
+
+/*! \brief Get the levels of the windows completed since the last call.
+ *  \param levels Buffer for the levels, oldest first.
+ *  \param max_num The size of the buffer. If more windows have been
+ *                 completed only the newest max_num are returned.
+ *  \param pos The history position of the caller. Should be initialized
+ *             to 0 and is updated by each call.
+ *  \return The number of levels returned.
+ */
+unsigned int rx_meter_c::get_history(rx_meter_level *levels, unsigned int max_num,
+                                     unsigned int &pos)
+{
+    if (max_num > METER_HISTORY)
+        max_num = METER_HISTORY;
+
+    return d_history.read_newest(levels, 1, max_num, pos);
 }
 
 
 void rx_meter_c::set_detector_type(int detector)
 {
-    if (d_detector == detector)
+    d_detector = detector;
+}
+
+/*! \brief Set the input sample rate.
+ *
+ * The window length in samples is adjusted to keep the integration time.
+ */
+void rx_meter_c::set_sample_rate(double sample_rate)
+{
+    if (sample_rate <= 0.0)
         return;
 
-    d_detector = detector;
-    reset_stats();
+    d_sample_rate = sample_rate;
+    update_window();
+}
+
+/*! \brief Set the integration time.
+ *  \param seconds The length of a window in seconds.
+ */
+void rx_meter_c::set_window(double seconds)
+{
+    if (seconds <= 0.0)
+        return;
+
+    d_window = seconds;
+    update_window();
+}
+
+/*! \brief Pass the window length in samples to work(). */
+void rx_meter_c::update_window()
+{
+    int len = (int)(d_sample_rate * d_window + 0.5);
+
+    d_window_len.write(len > 0 ? len : 1);
 }
 
-/*! \brief Reset statistics. */
+/*! \brief Start a new window (work() only). */
 void rx_meter_c::reset_stats()
 {
-    //d_level = 0.0;
-    d_level_db = 0.0;
-    d_sum = 0.0;
-    d_sumsq = 0.0;
     d_num = 0;
+    d_sum_pwr = 0.0;
+    d_sum_mag = 0.0;
+    d_max = 0.0f;
+    d_min = 1.0e30f;
 }
@@ -21,6 +21,7 @@
 #define RX_METER_H
 
 #include <gr_sync_block.h>
+#include "dsp/lockfree.h"
 
 enum detector_type_e {
     DETECTOR_TYPE_NONE   = 0,
@@ -32,35 +33,52 @@ enum detector_type_e {
 };
 
 
+#define METER_HISTORY 1024   /*!< Number of results kept by rx_meter_c. */
+
+
+/*! \brief Signal levels measured over one integration window, in dBFS. */
+struct rx_meter_level
+{
+    float  peak;   /*!< Highest instantaneous power. */
+    float  avg;    /*!< Average of the envelope (magnitude). */
+    float  rms;    /*!< Root mean square, i.e. the average power. */
+    float  min;    /*!< Lowest instantaneous power. */
+};
+
+
 class rx_meter_c;
 
 typedef boost::shared_ptr<rx_meter_c> rx_meter_c_sptr;
 
 
 /*! \brief Return a shared_ptr to a new instance of rx_meter_c.
- *  \param detector Detector type.
+ *  \param detector Detector type returned by get_level().
+ *  \param sample_rate The input sample rate.
  *
  * This is effectively the public constructor. To avoid accidental use
  * of raw pointers, the rx_meter_c constructor is private.
  * make_rxfilter is the public interface for creating new instances.
  */
-rx_meter_c_sptr make_rx_meter_c(int detector=DETECTOR_TYPE_RMS);
+rx_meter_c_sptr make_rx_meter_c(int detector=DETECTOR_TYPE_RMS, double sample_rate=96000.0);
 
 
 /*! \brief Block for measuring signal strength (complex input).
  *  \ingroup DSP
  *
  * This block can be used to meausre the received signal strength.
- * For each group of samples received this block stores the maximum power level,
- * which then can be retrieved using the get_level() and get_level_db()
- * methods.
+ * All detectors are computed together in one pass over the samples and
+ * integrated over a fixed time window (see set_window()). When a window
+ * is complete its result is published to get_levels() and appended to a
+ * history of the last METER_HISTORY windows, which can be read using
+ * get_history(), e.g. for peak hold or logging. Reading the results
+ * never affects the measurement and work() never waits for the reader.
  */
 class rx_meter_c : public gr_sync_block
 {
-    friend rx_meter_c_sptr make_rx_meter_c(int detector);
+    friend rx_meter_c_sptr make_rx_meter_c(int detector, double sample_rate);
 
 protected:
-    rx_meter_c(int detector=DETECTOR_TYPE_RMS);
+    rx_meter_c(int detector=DETECTOR_TYPE_RMS, double sample_rate=96000.0);
 
 public:
     ~rx_meter_c();
@@ -69,23 +87,27 @@ public:
              gr_vector_const_void_star &input_items,
              gr_vector_void_star &output_items);
 
-    /*! \brief Get the current signal level. */
+    /*! \brief Get the current signal level of the selected detector. */
     float get_level();
 
-    /*! \brief Get the current signal level in dBFS. */
+    /*! \brief Get the current signal level of the selected detector in dBFS. */
     float get_level_db();
 
-    /*! \brief Enable or disable averaging.
+    rx_meter_level get_levels();
+    unsigned int get_history(rx_meter_level *levels, unsigned int max_num,
+                             unsigned int &pos);
+
+    /*! \brief Select the detector used by get_level() and get_level_db().
      *  \param detector Detector type.
      */
     void set_detector_type(int detector);
 
-    /*! \brief Get averaging status
-     *  \returns TRUE if averaging is enabled, FALSE if it is disabled.
-     */
+    /*! \brief Get the detector used by get_level() and get_level_db(). */
     int get_detector_type() {return d_detector;}
 
-    /* In case we add a set_fs(), remember that it must be > 0.0 */
+    void   set_sample_rate(double sample_rate);
+    void   set_window(double seconds);
+    double get_window() {return d_window;}
 
     /*! \brief Get full scale value.
      *  \return The current full scale value.
@@ -93,14 +115,29 @@ public:
     float get_fs() {return d_fs;}
 
 private:
-    bool   d_detector;  /*! Detector type. */
-    float  d_level;     /*! The current level in the range 0.0 to 1.0 */
-    float  d_level_db;  /*! The current level in dBFS with FS = 1.0 */
-    float  d_sum;       /*! Sum of msamples. */
-    float  d_sumsq;     /*! Sum of samples squared. */
-    int    d_num;       /*! Number of samples in d_sum and d_sumsq. */
-    float  d_fs;        /*! Full scale value (default = 1.0). */
-
+    int     d_detector;     /*! Detector type of get_level(). */
+    float   d_fs;           /*! Full scale value (default = 1.0). */
+    double  d_sample_rate;  /*! Input sample rate. */
+    double  d_window;       /*! Integration time in seconds. */
+
+    rx_seqlock<int>         d_window_len;   /*! Window length in samples for work(). */
+    unsigned int            d_window_seen;  /*! Last window length read by work(). */
+    int                     d_len;          /*! Window length used by work(). */
+
+    /* accumulators of the current window (work() only) */
+    int     d_num;          /*! Number of samples. */
+    double  d_sum_pwr;      /*! Sum of the power. */
+    double  d_sum_mag;      /*! Sum of the magnitude. */
+    float   d_max;          /*! Highest power. */
+    float   d_min;          /*! Lowest power. */
+
+    rx_meter_level                  d_latest;   /*! Result of the last window (work()). */
+    rx_seqlock<rx_meter_level>      d_result;   /*! Result of the last window (GUI). */
+    rx_ring_buffer<rx_meter_level>  d_history;  /*! Results of the last windows. */
+
+    void update_window();
+    void accumulate(const gr_complex *in, int num);
+    void publish();
     void reset_stats();
 };
 
@@ -19,9 +19,20 @@
  * Boston, MA 02110-1301, USA.
  */
 #include <math.h>
+#include <string.h>
 #include <gr_io_signature.h>
 #include <gr_complex.h>
 #include "dsp/rx_noise_blanker_cc.h"
+#include "dsp/fast_math.h"
+
+
+/* Time constants of the original DTTSP code converted from samples
+   at 48 ksps to seconds. */
+#define MAG_TIMECONST  20.8e-3  /* magnitude averagers (alpha = 0.001) */
+#define SIG_TIMECONST  72.4e-6  /* NB2 signal averager (alpha = 0.25) */
+#define HANG_TIME      146e-6   /* NB1 hang time (7 samples) */
+#define DELAY_TIME     41.7e-6  /* NB1 delay (2 samples) */
+
 
 rx_nb_cc_sptr make_rx_nb_cc(double sample_rate, float thld1, float thld2)
 {
@@ -37,18 +48,22 @@ rx_nb_cc::rx_nb_cc(double sample_rate, float thld1, float thld2)
     : gr_sync_block ("rx_nb_cc",
           gr_make_io_signature(1, 1, sizeof(gr_complex)),
           gr_make_io_signature(1, 1, sizeof(gr_complex))),
-      d_sample_rate(sample_rate),
-      d_thld_nb1(thld1),
-      d_thld_nb2(thld2),
-      d_nb1_on(false),
-      d_nb2_on(false),
+      d_params_seen(0),
       d_avgmag_nb1(1.0),
       d_avgmag_nb2(1.0),
-      d_hangtime(0),
-      d_sigidx(0),
-      d_delidx(2)
+      d_avgsig(0.0, 0.0),
+      d_delidx(0),
+      d_hangtime(0)
 {
-    memset(d_delay, 0, 8 * sizeof(gr_complex));
+    d_set.nb1_on = false;
+    d_set.nb2_on = false;
+    d_set.thld_nb1 = thld1;
+    d_set.thld_nb2 = thld2;
+    d_set.sample_rate = sample_rate;
+    d_params.write(d_set);
+
+    d_cur = d_set;
+    update_params();
 }
 
 rx_nb_cc::~rx_nb_cc()
@@ -67,48 +82,115 @@ int rx_nb_cc::work(int noutput_items,
 {
     const gr_complex *in = (const gr_complex *) input_items[0];
     gr_complex *out = (gr_complex *) output_items[0];
-    int i;
-
-    boost::mutex::scoped_lock lock(d_mutex);
 
-    // copy data into output buffer then perform the processing on that buffer
-    for (i = 0; i < noutput_items; i++)
-	out[i] = gr_complex(in[i].real(), in[i].imag());
+    rx_nb_params p;
 
-    if (d_nb1_on)
+    /* pick up new parameters, if any */
+    if (d_params.read(p, d_params_seen))
     {
-        process_nb1(out, noutput_items);
+        bool new_rate = (p.sample_rate != d_cur.sample_rate);
+
+        d_cur = p;
+        if (new_rate)
+            update_params();
     }
-    if (d_nb2_on)
+
+    if (in != out)
+        memcpy(out, in, noutput_items * sizeof(gr_complex));
+
+    if (d_cur.nb1_on || d_cur.nb2_on)
     {
-        process_nb2(out, noutput_items);
+        if ((int) d_mag.size() < noutput_items)
+            d_mag.resize(noutput_items);
+
+        if (d_cur.nb1_on)
+        {
+            process_nb1(out, noutput_items, d_cur.thld_nb1);
+        }
+        if (d_cur.nb2_on)
+        {
+            process_nb2(out, noutput_items, d_cur.thld_nb2);
+        }
     }
 
     return noutput_items;
 }
 
+/*! \brief Set new sample rate.
+ *
+ * The derived parameters are recalculated at the beginning of the next
+ * call to work().
+ */
+void rx_nb_cc::set_sample_rate(double sample_rate)
+{
+    d_set.sample_rate = sample_rate;
+    d_params.write(d_set);
+}
+
+/*! \brief Enable or disable noise blanker 1. */
+void rx_nb_cc::set_nb1_on(bool nb1_on)
+{
+    d_set.nb1_on = nb1_on;
+    d_params.write(d_set);
+}
+
+/*! \brief Enable or disable noise blanker 2. */
+void rx_nb_cc::set_nb2_on(bool nb2_on)
+{
+    d_set.nb2_on = nb2_on;
+    d_params.write(d_set);
+}
+
+/*! \brief Calculate parameters derived from the sample rate.
+ *
+ * Called by work() (and the constructor) only.
+ */
+void rx_nb_cc::update_params()
+{
+    double rate = d_cur.sample_rate;
+    int delay;
+
+    d_mag_alpha = 1.0 - exp(-1.0 / (rate * MAG_TIMECONST));
+    d_sig_alpha = 1.0 - exp(-1.0 / (rate * SIG_TIMECONST));
+
+    d_hang_samples = (int) floor(rate * HANG_TIME + 0.5);
+    if (d_hang_samples < 1)
+        d_hang_samples = 1;
+
+    delay = (int) floor(rate * DELAY_TIME + 0.5);
+    if (delay < 1)
+        delay = 1;
+
+    d_delay.assign(delay, gr_complex(0.0, 0.0));
+    d_delidx = 0;
+    d_hangtime = 0;
+}
+
 /*! \brief Perform noise blanker 1 processing.
  *  \param buf The data buffer holding gr_complex samples.
  *  \param num The number of samples in the buffer.
+ *  \param thld The threshold.
  *
  * Noise blanker 1 is the first noise blanker in the processing chain.
  * It is intended to reduce the effect of impulse type noise.
- *
- * FIXME: Needs different constants for higher sample rates?
  */
-void rx_nb_cc::process_nb1(gr_complex *buf, int num)
+void rx_nb_cc::process_nb1(gr_complex *buf, int num, float thld)
 {
-    float cmag;
+    const float alpha = d_mag_alpha;
+    const int   dlen = d_delay.size();
+    float avgmag = d_avgmag_nb1;
+    gr_complex sample;
     gr_complex zero(0.0, 0.0);
 
+    fm_mag(buf, &d_mag[0], num);
+
     for (int i = 0; i < num; i++)
     {
-        cmag = abs(buf[i]);
-        d_delay[d_sigidx] = buf[i];
-        d_avgmag_nb1 = 0.999*d_avgmag_nb1 + 0.001*cmag;
+        sample = buf[i];
+        avgmag += alpha * (d_mag[i] - avgmag);
 
-        if ((d_hangtime == 0) && (cmag > (d_thld_nb1*d_avgmag_nb1)))
-            d_hangtime = 7;
+        if ((d_hangtime == 0) && (d_mag[i] > thld * avgmag))
+            d_hangtime = d_hang_samples;
 
         if (d_hangtime > 0)
         {
@@ -120,45 +202,58 @@ void rx_nb_cc::process_nb1(gr_complex *buf, int num)
             buf[i] = d_delay[d_delidx];
         }
 
-        d_sigidx = (d_sigidx + 7) & 7;
-        d_delidx = (d_delidx + 7) & 7;
+        d_delay[d_delidx] = sample;
+        if (++d_delidx == dlen)
+            d_delidx = 0;
     }
+
+    d_avgmag_nb1 = avgmag;
 }
 
 /*! \brief Perform noise blanker 2 processing.
  *  \param buf The data buffer holding gr_complex samples.
  *  \param num The number of samples in the buffer.
+ *  \param thld The threshold.
  *
  * Noise blanker 2 is the second noise blanker in the processing chain.
  * It is intended to reduce non-pulse type noise (i.e. longer time constants).
- *
- * FIXME: Needs different constants for higher sample rates?
  */
-void rx_nb_cc::process_nb2(gr_complex *buf, int num)
+void rx_nb_cc::process_nb2(gr_complex *buf, int num, float thld)
 {
-    float cmag;
-    gr_complex c1(0.75);
-    gr_complex c2(0.25);
+    const float mag_alpha = d_mag_alpha;
+    const float sig_alpha = d_sig_alpha;
+    float avgmag = d_avgmag_nb2;
+    gr_complex avgsig = d_avgsig;
+
+    fm_mag(buf, &d_mag[0], num);
 
     for (int i = 0; i < num; i++)
     {
-        cmag = abs(buf[i]);
-        d_avgsig = c1*d_avgsig + c2*buf[i];
-        d_avgmag_nb2 = 0.999*d_avgmag_nb2 + 0.001*cmag;
+        avgsig += sig_alpha * (buf[i] - avgsig);
+        avgmag += mag_alpha * (d_mag[i] - avgmag);
 
-        if (cmag > d_thld_nb2*d_avgmag_nb2)
-            buf[i] = d_avgsig;
+        if (d_mag[i] > thld * avgmag)
+            buf[i] = avgsig;
     }
+
+    d_avgmag_nb2 = avgmag;
+    d_avgsig = avgsig;
 }
 
 void rx_nb_cc::set_threshold1(float threshold)
 {
     if ((threshold >= 1.0) && (threshold <= 20.0))
-        d_thld_nb1 = threshold;
+    {
+        d_set.thld_nb1 = threshold;
+        d_params.write(d_set);
+    }
 }
 
 void rx_nb_cc::set_threshold2(float threshold)
 {
     if ((threshold >= 0.0) && (threshold <= 15.0))
-        d_thld_nb2 = threshold;
+    {
+        d_set.thld_nb2 = threshold;
+        d_params.write(d_set);
+    }
 }
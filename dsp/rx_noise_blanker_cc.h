@@ -22,7 +22,8 @@
 
 #include <gr_sync_block.h>
 #include <gr_complex.h>
-#include <boost/thread/mutex.hpp>
+#include <vector>
+#include "dsp/lockfree.h"
 
 class rx_nb_cc;
 
@@ -40,13 +41,33 @@ typedef boost::shared_ptr<rx_nb_cc> rx_nb_cc_sptr;
 rx_nb_cc_sptr make_rx_nb_cc(double sample_rate, float thld1=3.3, float thld2=2.5);
 
 
+/*! \brief Noise blanker parameters passed from the setters to work(). */
+struct rx_nb_params
+{
+    bool   nb1_on;
+    bool   nb2_on;
+    float  thld_nb1;
+    float  thld_nb2;
+    double sample_rate;
+};
+
+
 /*! \brief Noise blanker block.
  *  \ingroup DSP
  *
  * This block implements noise blanking filters based on the noise blanker code
  * from DTTSP.
-
  *
+ * The time constants, hang time and delay of the original code were designed
+ * for 48 ksps. Here they are specified in seconds and converted to samples
+ * using the actual sample rate so that the blanker behaves the same at any
+ * input rate.
+ *
+ * The setters publish a parameter snapshot that work() reads at the
+ * beginning of each call, and derived parameters are recalculated by work()
+ * itself after a call to set_sample_rate(). When both blankers are off the
+ * block is a plain copy; the receiver removes it from the flow graph in that
+ * case.
  */
 class rx_nb_cc : public gr_sync_block
 {
@@ -62,30 +83,36 @@ public:
              gr_vector_const_void_star &input_items,
              gr_vector_void_star &output_items);
 
-    void set_sample_rate(double sample_rate) { d_sample_rate = sample_rate; }
-    void set_nb1_on(bool nb1_on) { d_nb1_on = nb1_on; }
-    void set_nb2_on(bool nb2_on) { d_nb2_on = nb2_on; }
-    bool get_nb1_on() { return d_nb1_on; }
-    bool get_nb2_on() { return d_nb2_on; }
+    void set_sample_rate(double sample_rate);
+    void set_nb1_on(bool nb1_on);
+    void set_nb2_on(bool nb2_on);
+    bool get_nb1_on() { return d_set.nb1_on; }
+    bool get_nb2_on() { return d_set.nb2_on; }
     void set_threshold1(float threshold);
     void set_threshold2(float threshold);
 
 private:
-    void process_nb1(gr_complex *buf, int num);
-    void process_nb2(gr_complex *buf, int num);
+    void update_params();
+    void process_nb1(gr_complex *buf, int num, float thld);
+    void process_nb2(gr_complex *buf, int num, float thld);
 
 private:
-    boost::mutex  d_mutex;  /*! Used to lock internal data while processing or setting parameters. */
+    rx_nb_params               d_set;          /*! Parameters set by the setters. */
+    rx_seqlock<rx_nb_params>   d_params;       /*! Parameters published to work(). */
+    unsigned int               d_params_seen;  /*! Last snapshot used by work(). */
+    rx_nb_params               d_cur;          /*! Parameters used by work(). */
 
-    bool   d_nb1_on;        /*! Current NB1 status (true/false). */
-    bool   d_nb2_on;        /*! Current NB2 status (true/false). */
-    double d_sample_rate;   /*! Current sample rate. */
-    float  d_thld_nb1;      /*! Current threshold for noise blanker 1 (1.0 to 20.0 TBC). */
-    float  d_thld_nb2;      /*! Current threshold for noise blanker 2 (0.0 to 15.0 TBC). */
     float  d_avgmag_nb1;    /*! Average magnitude. */
     float  d_avgmag_nb2;    /*! Average magnitude. */
-    gr_complex d_avgsig, d_delay[8];
-    int    d_delidx, d_sigidx, d_hangtime;   // FIXME: need longer buffer for higher sampel rates?
+    float  d_mag_alpha;     /*! Coefficient of the magnitude averagers. */
+    float  d_sig_alpha;     /*! Coefficient of the NB2 signal averager. */
+    gr_complex d_avgsig;    /*! Average signal (NB2). */
+
+    std::vector<gr_complex> d_delay;  /*! NB1 delay line. */
+    std::vector<float>      d_mag;    /*! Magnitude of the current block. */
+    int    d_delidx;        /*! Delay line index. */
+    int    d_hangtime;      /*! Remaining hang time in samples. */
+    int    d_hang_samples;  /*! Hang time in samples. */
 
 };
 
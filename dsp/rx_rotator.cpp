@@ -0,0 +1,93 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <math.h>
+#include <gr_io_signature.h>
+#include <dsp/rx_rotator.h>
+
+
+rx_rotator_cc_sptr make_rx_rotator_cc(double sample_rate, double freq)
+{
+    return gnuradio::get_initial_sptr(new rx_rotator_cc(sample_rate, freq));
+}
+
+rx_rotator_cc::rx_rotator_cc(double sample_rate, double freq)
+    : gr_sync_block ("rx_rotator_cc",
+          gr_make_io_signature(1, 1, sizeof(gr_complex)),
+          gr_make_io_signature(1, 1, sizeof(gr_complex))),
+      d_incr_seen(0),
+      d_phase(1.0, 0.0),
+      d_phase_incr(1.0, 0.0),
+      d_sample_rate(sample_rate)
+{
+    set_freq(freq);
+}
+
+rx_rotator_cc::~rx_rotator_cc()
+{
+}
+
+
+int rx_rotator_cc::work(int noutput_items,
+                        gr_vector_const_void_star &input_items,
+                        gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    gr_complex *out = (gr_complex *) output_items[0];
+    gr_complex phase_incr;
+    gr_complex phase = d_phase;
+    int i;
+
+    /* pick up new frequency, if any */
+    d_incr.read(d_phase_incr, d_incr_seen);
+    phase_incr = d_phase_incr;
+
+    for (i = 0; i < noutput_items; i++)
+    {
+        out[i] = in[i] * phase;
+        phase *= phase_incr;
+    }
+
+    /* keep the phasor on the unit circle */
+    d_phase = phase / std::abs(phase);
+
+    return noutput_items;
+}
+
+
+/*! \brief Set frequency shift.
+ *  \param freq The new frequency shift in Hz.
+ */
+void rx_rotator_cc::set_freq(double freq)
+{
+    d_freq = freq;
+    d_incr.write(gr_complex(cos(2.0 * M_PI * d_freq / d_sample_rate),
+                            sin(2.0 * M_PI * d_freq / d_sample_rate)));
+}
+
+
+/*! \brief Set new sample rate.
+ *
+ * The frequency shift in Hz is preserved.
+ */
+void rx_rotator_cc::set_sample_rate(double sample_rate)
+{
+    d_sample_rate = sample_rate;
+    set_freq(d_freq);
+}
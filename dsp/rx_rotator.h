@@ -0,0 +1,84 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RX_ROTATOR_H
+#define RX_ROTATOR_H
+
+#include <gr_sync_block.h>
+#include <gr_complex.h>
+#include "dsp/lockfree.h"
+
+
+class rx_rotator_cc;
+
+typedef boost::shared_ptr<rx_rotator_cc> rx_rotator_cc_sptr;
+
+
+/*! \brief Return a shared_ptr to a new instance of rx_rotator_cc.
+ *  \param sample_rate The sample rate.
+ *  \param freq The frequency shift in Hz.
+ *
+ * This is effectively the public constructor. To avoid accidental use
+ * of raw pointers, the rx_rotator_cc constructor is private.
+ * make_rx_rotator_cc is the public interface for creating new instances.
+ */
+rx_rotator_cc_sptr make_rx_rotator_cc(double sample_rate, double freq=0.0);
+
+
+/*! \brief Frequency shifter.
+ *  \ingroup DSP
+ *
+ * This block multiplies the input with a complex oscillator, i.e. it shifts
+ * the spectrum by freq Hz. The oscillator is a recursive phasor that is
+ * renormalized once per call to work(), so changing the frequency is only a
+ * change of the phase increment and does not cause phase discontinuities.
+ * The new phase increment is picked up by the next call to work() without
+ * locking.
+ */
+class rx_rotator_cc : public gr_sync_block
+{
+    friend rx_rotator_cc_sptr make_rx_rotator_cc(double sample_rate, double freq);
+
+protected:
+    rx_rotator_cc(double sample_rate, double freq);
+
+public:
+    ~rx_rotator_cc();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    void set_freq(double freq);
+    double freq() { return d_freq; }
+
+    void set_sample_rate(double sample_rate);
+
+private:
+    rx_seqlock<gr_complex>  d_incr;  /*! Phase increment published to work(). */
+    unsigned int  d_incr_seen;   /*! Last phase increment read by work(). */
+    gr_complex    d_phase;       /*! Current phase. */
+    gr_complex    d_phase_incr;  /*! Phase increment per sample used by work(). */
+    double        d_sample_rate; /*! Sample rate. */
+    double        d_freq;        /*! Frequency shift. */
+
+};
+
+
+#endif /* RX_ROTATOR_H */
@@ -0,0 +1,248 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <math.h>
+#include <string.h>
+#include <gr_io_signature.h>
+#include <dsp/rx_squelch.h>
+
+
+rx_squelch_cc_sptr make_rx_squelch_cc(double threshold_db, double alpha, int preroll)
+{
+    return gnuradio::get_initial_sptr(new rx_squelch_cc(threshold_db, alpha, preroll));
+}
+
+
+/*! \brief Create squelch object.
+ *
+ * Use make_rx_squelch_cc() instead.
+ */
+rx_squelch_cc::rx_squelch_cc(double threshold_db, double alpha, int preroll)
+    : gr_sync_block ("rx_squelch_cc",
+          gr_make_io_signature(1, 1, sizeof(gr_complex)),
+          gr_make_io_signature(1, 1, sizeof(gr_complex))),
+      d_params_seen(0),
+      d_threshold_db(threshold_db),
+      d_pwr(0.0),
+      d_detect(true),
+      d_state(SQL_OPEN),
+      d_unmuted(true),
+      d_pos(0)
+{
+    d_key = pmt::pmt_string_to_symbol(SQL_TAG);
+
+    d_set.threshold = pow(10.0, threshold_db / 10.0);
+    d_set.alpha = alpha;
+    d_set.preroll = (preroll > 0) ? preroll : 0;
+    d_cur = d_set;
+    d_params.write(d_set);
+
+    d_delay.assign(d_cur.preroll, gr_complex(0.0, 0.0));
+}
+
+rx_squelch_cc::~rx_squelch_cc()
+{
+
+}
+
+
+/*! \brief Squelch work method.
+ *
+ * The detector runs on the input; its changes of state are turned into
+ * state changes of the delayed output, which are applied and tagged when
+ * the output reaches them.
+ */
+int rx_squelch_cc::work(int noutput_items,
+                        gr_vector_const_void_star &input_items,
+                        gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    gr_complex *out = (gr_complex *) output_items[0];
+    uint64_t offset = nitems_written(0);
+    rx_squelch_params p;
+    gr_complex x;
+    bool detect;
+    int i;
+
+    if (d_params.read(p, d_params_seen))
+    {
+        if (p.preroll != d_cur.preroll)
+        {
+            /* restart the delay line; pending changes would be misplaced */
+            d_delay.assign(p.preroll, gr_complex(0.0, 0.0));
+            d_pos = 0;
+            d_events.clear();
+            if (d_state != (d_detect ? SQL_OPEN : SQL_CLOSED))
+                set_state(offset, d_detect ? SQL_OPEN : SQL_CLOSED);
+        }
+        d_cur = p;
+    }
+
+    const float alpha = d_cur.alpha;
+    const float threshold = d_cur.threshold;
+    const int preroll = d_cur.preroll;
+
+    for (i = 0; i < noutput_items; i++)
+    {
+        x = in[i];
+        d_pwr = alpha * (x.real() * x.real() + x.imag() * x.imag()) + (1.0f - alpha) * d_pwr;
+        detect = (d_pwr >= threshold);
+
+        if (detect != d_detect)
+        {
+            d_detect = detect;
+
+            if (preroll == 0)
+                set_state(offset + i, detect ? SQL_OPEN : SQL_CLOSED);
+            else if (!detect)
+                d_events.push_back(std::make_pair(offset + i + preroll, (int) SQL_CLOSED));
+            else if (!d_events.empty() && (d_events.back().second == SQL_CLOSED))
+                d_events.pop_back();  /* short dropout, stay open */
+            else {
+                /* the delayed samples up to the opening are the pre-roll */
+                set_state(offset + i, SQL_PREROLL);
+                d_events.push_back(std::make_pair(offset + i + preroll, (int) SQL_OPEN));
+            }
+        }
+
+        while (!d_events.empty() && (d_events.front().first <= offset + i))
+        {
+            set_state(offset + i, d_events.front().second);
+            d_events.pop_front();
+        }
+
+        if (preroll > 0)
+        {
+            out[i] = (d_state == SQL_CLOSED) ? gr_complex(0.0, 0.0) : d_delay[d_pos];
+            d_delay[d_pos] = x;
+            if (++d_pos == preroll)
+                d_pos = 0;
+        }
+        else
+        {
+            out[i] = (d_state == SQL_CLOSED) ? gr_complex(0.0, 0.0) : x;
+        }
+    }
+
+    d_unmuted = (d_state != SQL_CLOSED);
+
+    return noutput_items;
+}
+
+
+/*! \brief Change output state and tag the sample.
+ *  \param offset The absolute output sample from which the state applies.
+ *  \param state The new state.
+ */
+void rx_squelch_cc::set_state(uint64_t offset, int state)
+{
+    d_state = state;
+    add_item_tag(0, offset, d_key, pmt::pmt_from_long(state));
+}
+
+
+/*! \brief Set squelch threshold.
+ *  \param level_db The new threshold in dB, compared to the averaged power.
+ */
+void rx_squelch_cc::set_threshold(double level_db)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    d_threshold_db = level_db;
+    d_set.threshold = pow(10.0, level_db / 10.0);
+    d_params.write(d_set);
+}
+
+/*! \brief Get squelch threshold in dB. */
+double rx_squelch_cc::threshold()
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    return d_threshold_db;
+}
+
+/*! \brief Set averaging constant of the signal power.
+ *  \param alpha The new averaging constant between 0 and 1.
+ */
+void rx_squelch_cc::set_alpha(double alpha)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    d_set.alpha = alpha;
+    d_params.write(d_set);
+}
+
+/*! \brief Set pre-roll.
+ *  \param preroll The number of samples output in SQL_PREROLL state before
+ *                 the squelch opens; 0 disables pre-roll and the delay.
+ */
+void rx_squelch_cc::set_preroll(int preroll)
+{
+    boost::mutex::scoped_lock lock(d_mutex);
+
+    d_set.preroll = (preroll > 0) ? preroll : 0;
+    d_params.write(d_set);
+}
+
+
+rx_squelch_gate::rx_squelch_gate()
+    : d_state(SQL_OPEN)
+{
+    d_key = pmt::pmt_string_to_symbol(SQL_TAG);
+}
+
+
+/*! \brief Pick up squelch tags from the input of a block.
+ *  \param blk The block; the tags are read from input 0.
+ *  \param num The number of input samples available.
+ *  \return The number of samples, at most num, in the state given by state().
+ *
+ * A tag on the first sample sets the state, the next tag ends the
+ * samples the call may process. Tags after the first sample are kept
+ * in case the block consumes past them.
+ */
+int rx_squelch_gate::update(gr_block *blk, int num)
+{
+    uint64_t start = blk->nitems_read(0);
+    uint64_t end = start + num;
+    unsigned int i;
+
+    /* tags the block has consumed past */
+    for (i = 0; i < d_ahead.size(); i++)
+        if (d_ahead[i].offset < start)
+            d_state = pmt::pmt_to_long(d_ahead[i].value);
+    d_ahead.clear();
+
+    d_tags.clear();
+    blk->get_tags_in_range(d_tags, 0, start, end, d_key);
+
+    for (i = 0; i < d_tags.size(); i++)
+    {
+        if (d_tags[i].offset == start) {
+            d_state = pmt::pmt_to_long(d_tags[i].value);
+        }
+        else {
+            d_ahead.push_back(d_tags[i]);
+            if (d_tags[i].offset < end)
+                end = d_tags[i].offset;
+        }
+    }
+
+    return (int) (end - start);
+}
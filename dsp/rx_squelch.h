@@ -0,0 +1,169 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RX_SQUELCH_H
+#define RX_SQUELCH_H
+
+#include <gr_sync_block.h>
+#include <gr_complex.h>
+#include <gr_tags.h>
+#include <gruel/pmt.h>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <vector>
+#include "dsp/lockfree.h"
+
+
+#define SQL_TAG  "squelch"   /*!< Key of the stream tags with the squelch state. */
+
+
+/*! \brief Squelch state carried downstream by stream tags.
+ *
+ * The value of an SQL_TAG tag is the state from the tagged sample on.
+ * Samples before the first tag are open.
+ */
+enum rx_squelch_state {
+    SQL_CLOSED  = 0,  /*!< Muted, the samples are zero. */
+    SQL_PREROLL = 1,  /*!< Valid samples preceding the opening, not to be heard. */
+    SQL_OPEN    = 2   /*!< Not muted. */
+};
+
+
+/*! \brief Parameters passed from the setters to work(). */
+struct rx_squelch_params
+{
+    float  threshold;  /*!< Threshold, linear power. */
+    float  alpha;      /*!< Power averaging. */
+    int    preroll;    /*!< Pre-roll in samples. */
+};
+
+
+class rx_squelch_cc;
+
+typedef boost::shared_ptr<rx_squelch_cc> rx_squelch_cc_sptr;
+
+
+/*! \brief Return a shared_ptr to a new instance of rx_squelch_cc.
+ *  \param threshold_db The squelch threshold in dB.
+ *  \param alpha The averaging constant of the signal power.
+ *  \param preroll The number of samples let through before the squelch opens.
+ *
+ * This is effectively the public constructor. To avoid accidental use
+ * of raw pointers, rx_squelch_cc's constructor is private.
+ * make_rx_squelch_cc is the public interface for creating new instances.
+ */
+rx_squelch_cc_sptr make_rx_squelch_cc(double threshold_db, double alpha, int preroll=0);
+
+
+/*! \brief Power squelch that lets the blocks downstream idle while closed.
+ *  \ingroup DSP
+ *
+ * This block replaces gr_simple_squelch_cc. It uses the same detector,
+ * i.e. the averaged power compared to a threshold, and also outputs
+ * zeros while closed, but every change of state is marked with an
+ * SQL_TAG stream tag. The tags propagate through the flow graph and the
+ * blocks downstream use rx_squelch_gate to skip their processing and
+ * output zeros while the squelch is closed. Blocks that delay the signal,
+ * like rx_agc_cc, move the tags by the same delay.
+ *
+ * The output is delayed by the pre-roll. When the detector opens, the
+ * preroll samples before the opening are output in SQL_PREROLL state so
+ * that the AGC can settle before the signal is heard, and the beginning
+ * of the signal is not lost to the averaging of the detector. A dropout
+ * shorter than the pre-roll does not close the squelch.
+ */
+class rx_squelch_cc : public gr_sync_block
+{
+    friend rx_squelch_cc_sptr make_rx_squelch_cc(double threshold_db, double alpha, int preroll);
+
+protected:
+    rx_squelch_cc(double threshold_db, double alpha, int preroll);
+
+public:
+    ~rx_squelch_cc();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    void   set_threshold(double level_db);
+    double threshold();
+    void   set_alpha(double alpha);
+    void   set_preroll(int preroll);
+
+    /*! \brief Whether the squelch is open or in pre-roll. */
+    bool unmuted() const { return d_unmuted; }
+
+private:
+    rx_seqlock<rx_squelch_params> d_params;  /*! Parameters for work(). */
+    unsigned int       d_params_seen;  /*! Last parameters picked up by work(). */
+    rx_squelch_params  d_set;          /*! Parameters set by the GUI. */
+    rx_squelch_params  d_cur;          /*! Parameters used by work(). */
+    boost::mutex       d_mutex;        /*! Serializes the setters. */
+    double             d_threshold_db; /*! Threshold in dB. */
+
+    float  d_pwr;       /*! Averaged power. */
+    bool   d_detect;    /*! State of the detector. */
+    int    d_state;     /*! State of the output. */
+    volatile bool d_unmuted;  /*! Output state for the GUI. */
+
+    std::vector<gr_complex> d_delay;  /*! Pre-roll delay line. */
+    int                     d_pos;    /*! Oldest sample in d_delay. */
+
+    /*! State changes of the output that have not been reached yet. */
+    std::deque<std::pair<uint64_t, int> > d_events;
+
+    pmt::pmt_t d_key;   /*! SQL_TAG */
+
+    void set_state(uint64_t offset, int state);
+};
+
+
+/*! \brief Follows the squelch state on the input of a gated block.
+ *  \ingroup DSP
+ *
+ * A block that only needs to process audible samples calls update() at
+ * the beginning of work() and limits the call to the returned number of
+ * samples, so that every call is either fully open or fully closed.
+ * A block that needs a few more samples to complete an output may consume
+ * past that; the tags it skipped take effect at the next call. Blocks that
+ * are not downstream of rx_squelch_cc never see a tag and stay open.
+ */
+class rx_squelch_gate
+{
+public:
+    rx_squelch_gate();
+
+    int  update(gr_block *blk, int num);
+
+    /*! \brief The squelch state of the samples of the current call. */
+    int  state() const { return d_state; }
+
+    /*! \brief Whether the samples of the current call are audible. */
+    bool open() const { return d_state == SQL_OPEN; }
+
+private:
+    int                    d_state;  /*! Current state. */
+    pmt::pmt_t             d_key;    /*! SQL_TAG */
+    std::vector<gr_tag_t>  d_tags;   /*! Tags in the current call. */
+    std::vector<gr_tag_t>  d_ahead;  /*! Tags after the first sample of the last call. */
+};
+
+
+#endif // RX_SQUELCH_H
@@ -0,0 +1,216 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <cmath>
+#include <gr_io_signature.h>
+#include <dsp/rx_vfo.h>
+
+
+/*
+ * Create a new instance of rx_vfo and return
+ * a boost shared_ptr. This is effectively the public constructor.
+ */
+rx_vfo_sptr make_rx_vfo(double chan_rate, double quad_rate, double audio_rate, double offset)
+{
+    return gnuradio::get_initial_sptr(new rx_vfo(chan_rate, quad_rate, audio_rate, offset));
+}
+
+
+static const int MIN_IN = 1;  /* Mininum number of input streams. */
+static const int MAX_IN = 1;  /* Maximum number of input streams. */
+static const int MIN_OUT = 1; /* Minimum number of output streams. */
+static const int MAX_OUT = 1; /* Maximum number of output streams. */
+
+
+rx_vfo::rx_vfo(double chan_rate, double quad_rate, double audio_rate, double offset)
+    : gr_hier_block2 ("rx_vfo",
+                      gr_make_io_signature (MIN_IN, MAX_IN, sizeof (gr_complex)),
+                      gr_make_io_signature (MIN_OUT, MAX_OUT, sizeof (float))),
+      d_chan_rate(chan_rate),
+      d_quad_rate(quad_rate),
+      d_audio_rate(audio_rate),
+      d_offset(offset),
+      d_demod(DEMOD_FM)
+{
+    /* same channel selectivity as the main receiver channel */
+    ddc = make_rx_decimator_cc(d_chan_rate, d_quad_rate, 40000, 15000, d_offset);
+    ddc->set_band_pass(-5000.0, 5000.0, 1000.0);
+    meter = make_rx_meter_c(DETECTOR_TYPE_RMS);
+    sql = make_rx_squelch_cc(-150.0, 0.001, (int) (d_quad_rate * 0.01));
+    agc = make_rx_agc_cc(d_quad_rate, true, -100, 0, 2, 100, false);
+    demod_ssb = make_rx_demod_ssb(d_quad_rate, 0.0);
+    demod_cw = make_rx_demod_ssb(d_quad_rate, 700.0);
+    demod_fm = make_rx_demod_fm(d_quad_rate, d_audio_rate, 5000.0, 75.0e-6);
+    demod_am = make_rx_demod_am(d_quad_rate, d_quad_rate, true);
+    audio_rr = make_resampler_ff(d_quad_rate, d_audio_rate);
+    audio_gain = gr_make_multiply_const_ff(0.1);
+
+    connect(self(), 0, ddc, 0);
+    connect(ddc, 0, meter, 0);
+    connect(ddc, 0, sql, 0);
+    connect(sql, 0, agc, 0);
+    connect_demod(d_demod);
+    connect(audio_gain, 0, self(), 0);
+}
+
+
+rx_vfo::~rx_vfo()
+{
+
+}
+
+
+/*! \brief Set frequency offset from the center of the input channel.
+ *  \param offset The new offset in Hz.
+ *
+ * The offset must be within the passband of the channelizer channel,
+ * i.e. +/- half the channel spacing.
+ */
+void rx_vfo::set_offset(double offset)
+{
+    d_offset = offset;
+    ddc->set_offset(d_offset);
+}
+
+
+/*! \brief Set channel filter.
+ *  \param low The lower edge relative to the VFO frequency.
+ *  \param high The upper edge relative to the VFO frequency.
+ *  \param trans_width The transition width.
+ */
+void rx_vfo::set_filter(double low, double high, double trans_width)
+{
+    /* mirrored band edges, same as the main channel filter */
+    ddc->set_band_pass(-high, -low, trans_width);
+
+    /* VFOs have no sideband setting; use the side the filter is on */
+    demod_ssb->set_sideband(low + high < 0.0 ? rx_demod_ssb::SIDEBAND_LSB : rx_demod_ssb::SIDEBAND_USB);
+    demod_cw->set_sideband(low + high < 0.0 ? rx_demod_ssb::SIDEBAND_LSB : rx_demod_ssb::SIDEBAND_USB);
+}
+
+
+/*! \brief Select new demodulator.
+ *  \param demod The new demodulator.
+ */
+void rx_vfo::set_demod(demod_type demod)
+{
+    if (demod == d_demod)
+        return;
+
+    lock();
+    disconnect_demod(d_demod);
+    connect_demod(demod);
+    unlock();
+
+    d_demod = demod;
+}
+
+
+/*! \brief Set squelch level in dBFS. */
+void rx_vfo::set_sql_level(double level_db)
+{
+    sql->set_threshold(level_db);
+}
+
+
+/*! \brief Set audio gain in dB. */
+void rx_vfo::set_af_gain(float gain_db)
+{
+    audio_gain->set_k(pow(10.0, gain_db / 20.0));
+}
+
+
+/*! \brief Get current signal power.
+ *  \param dbfs Whether to use dbfs or absolute power.
+ */
+float rx_vfo::get_signal_pwr(bool dbfs)
+{
+    if (dbfs)
+        return meter->get_level_db();
+    else
+        return meter->get_level();
+}
+
+
+/*! \brief Connect demodulator between AGC and audio gain.
+ *
+ * The FM demodulator resamples to the audio rate itself, the other
+ * demodulators are followed by the audio resampler.
+ */
+void rx_vfo::connect_demod(demod_type demod)
+{
+    switch (demod) {
+
+    case DEMOD_SSB:
+        connect(agc, 0, demod_ssb, 0);
+        connect(demod_ssb, 0, audio_rr, 0);
+        connect(audio_rr, 0, audio_gain, 0);
+        break;
+
+    case DEMOD_CW:
+        connect(agc, 0, demod_cw, 0);
+        connect(demod_cw, 0, audio_rr, 0);
+        connect(audio_rr, 0, audio_gain, 0);
+        break;
+
+    case DEMOD_AM:
+        connect(agc, 0, demod_am, 0);
+        connect(demod_am, 0, audio_rr, 0);
+        connect(audio_rr, 0, audio_gain, 0);
+        break;
+
+    case DEMOD_FM:
+    default:
+        connect(agc, 0, demod_fm, 0);
+        connect(demod_fm, 0, audio_gain, 0);
+        break;
+    }
+}
+
+
+/*! \brief Disconnect demodulator from AGC and audio gain. */
+void rx_vfo::disconnect_demod(demod_type demod)
+{
+    switch (demod) {
+
+    case DEMOD_SSB:
+        disconnect(agc, 0, demod_ssb, 0);
+        disconnect(demod_ssb, 0, audio_rr, 0);
+        disconnect(audio_rr, 0, audio_gain, 0);
+        break;
+
+    case DEMOD_CW:
+        disconnect(agc, 0, demod_cw, 0);
+        disconnect(demod_cw, 0, audio_rr, 0);
+        disconnect(audio_rr, 0, audio_gain, 0);
+        break;
+
+    case DEMOD_AM:
+        disconnect(agc, 0, demod_am, 0);
+        disconnect(demod_am, 0, audio_rr, 0);
+        disconnect(audio_rr, 0, audio_gain, 0);
+        break;
+
+    case DEMOD_FM:
+    default:
+        disconnect(agc, 0, demod_fm, 0);
+        disconnect(demod_fm, 0, audio_gain, 0);
+        break;
+    }
+}
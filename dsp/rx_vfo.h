@@ -0,0 +1,118 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RX_VFO_H
+#define RX_VFO_H
+
+#include <gr_hier_block2.h>
+#include <gr_multiply_const_ff.h>
+#include "dsp/rx_decimator.h"
+#include "dsp/rx_meter.h"
+#include "dsp/rx_squelch.h"
+#include "dsp/rx_agc_xx.h"
+#include "dsp/rx_demod_fm.h"
+#include "dsp/rx_demod_am.h"
+#include "dsp/rx_demod_ssb.h"
+#include "dsp/resampler_ff.h"
+
+
+class rx_vfo;
+
+
+typedef boost::shared_ptr<rx_vfo> rx_vfo_sptr;
+
+
+/*! \brief Return a shared_ptr to a new instance of rx_vfo.
+ *  \param chan_rate The input (channelizer output) sample rate.
+ *  \param quad_rate The internal rate used by filter, AGC and demodulator.
+ *  \param audio_rate The audio output rate.
+ *  \param offset The frequency offset from the center of the input channel.
+ *
+ * This is effectively the public constructor. To avoid accidental use
+ * of raw pointers, rx_vfo's constructor is private.
+ * make_rx_vfo is the public interface for creating new instances.
+ */
+rx_vfo_sptr make_rx_vfo(double chan_rate, double quad_rate, double audio_rate, double offset);
+
+
+/*! \brief Receiver channel for one VFO.
+ *  \ingroup DSP
+ *
+ * This block contains a complete receiver channel, i.e. fine tuning,
+ * channel filter, squelch, AGC, demodulator and audio resampler. It takes
+ * one output of the rx_channelizer as input and produces audio samples at
+ * audio_rate.
+ *
+ * The demodulator is selected using rx_vfo::demod_type so that the block
+ * does not depend on the receiver class.
+ */
+class rx_vfo : public gr_hier_block2
+{
+
+public:
+    /*! \brief Available demodulators. */
+    enum demod_type {
+        DEMOD_SSB = 0,  /*!< SSB, the sideband follows the filter. */
+        DEMOD_CW  = 1,  /*!< CW (SSB with 700 Hz BFO). */
+        DEMOD_AM  = 2,  /*!< Amplitude modulation. */
+        DEMOD_FM  = 3   /*!< Narrow band FM. */
+    };
+
+    rx_vfo(double chan_rate, double quad_rate, double audio_rate, double offset); // FIXME: should be private
+    ~rx_vfo();
+
+    void set_offset(double offset);
+    double offset() { return d_offset; }
+
+    void set_filter(double low, double high, double trans_width);
+
+    void set_demod(demod_type demod);
+    demod_type demod() { return d_demod; }
+
+    void set_sql_level(double level_db);
+    void set_af_gain(float gain_db);
+
+    float get_signal_pwr(bool dbfs);
+
+private:
+    void connect_demod(demod_type demod);
+    void disconnect_demod(demod_type demod);
+
+private:
+    rx_decimator_cc_sptr      ddc;        /*! Fine tuning, decimation to quad_rate and bandpass filter. */
+    rx_meter_c_sptr           meter;      /*! Signal strength. */
+    rx_squelch_cc_sptr        sql;        /*! Squelch. */
+    rx_agc_cc_sptr            agc;        /*! AGC. */
+    rx_demod_ssb_sptr         demod_ssb;  /*! SSB demodulator. */
+    rx_demod_ssb_sptr         demod_cw;   /*! CW demodulator. */
+    rx_demod_fm_sptr          demod_fm;   /*! FM demodulator. */
+    rx_demod_am_sptr          demod_am;   /*! AM demodulator. */
+    resampler_ff_sptr         audio_rr;   /*! Audio resampler. */
+    gr_multiply_const_ff_sptr audio_gain; /*! Audio gain. */
+
+    double d_chan_rate;    /*! Input sample rate. */
+    double d_quad_rate;    /*! Internal sample rate. */
+    double d_audio_rate;   /*! Audio output rate. */
+    double d_offset;       /*! Offset from the center of the input channel. */
+    demod_type d_demod;    /*! Current demodulator. */
+
+};
+
+
+#endif // RX_VFO_H
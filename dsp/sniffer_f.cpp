@@ -40,11 +40,12 @@ sniffer_f::sniffer_f(int buffsize)
     : gr_sync_block ("rx_fft_c",
           gr_make_io_signature(1, 1, sizeof(float)),
           gr_make_io_signature(0, 0, 0)),
+      d_read_pos(0),
       d_minsamp(1000)
 {
 
-    /* allocate circular buffer */
-    d_buffer.set_capacity(buffsize);
+    /* allocate ring buffer */
+    set_buffer_size(buffsize);
 
 }
 
@@ -60,21 +61,16 @@ sniffer_f::~sniffer_f()
  *  \param output_items
  *
  * This method does nothing except dumping the incoming samples into the
- * circular buffer.
+ * ring buffer.
  */
 int sniffer_f::work(int noutput_items,
                     gr_vector_const_void_star &input_items,
                     gr_vector_void_star &output_items)
 {
-    int i,j = 0;
     const float *in = (const float *)input_items[0];
 
-    boost::mutex::scoped_lock lock(d_mutex);
-
     /* dump new samples into the buffer */
-    for (i = 0; i < noutput_items; i++) {
-        d_buffer.push_back(in[i]);
-    }
+    d_ring.write(in, noutput_items);
 
     return noutput_items;
 }
@@ -88,9 +84,9 @@ int sniffer_f::work(int noutput_items,
  */
 int  sniffer_f::samples_available()
 {
-    boost::mutex::scoped_lock lock(d_mutex);
+    unsigned int num = d_ring.head() - d_read_pos;
 
-    return d_buffer.size();
+    return (num > (unsigned int) d_buffsize) ? d_buffsize : num;
 }
 
 /*! \brief Fetch avaialble samples.
@@ -100,32 +96,25 @@ int  sniffer_f::samples_available()
  */
 void sniffer_f::get_samples(float * out, int &num)
 {
-    boost::mutex::scoped_lock lock(d_mutex);
-
-    if (d_buffer.size() < d_minsamp) {
-        /* not enough samples in buffer */
-        num = 0;
-        return;
-    }
-
-    num = d_buffer.size();
-    float *buff = d_buffer.linearize();
-
-    memcpy(out, buff, sizeof(float)*num);
-
-    d_buffer.clear();
+    /* returns 0 if there are not enough samples in buffer */
+    num = d_ring.read_newest(out, d_minsamp, d_buffsize, d_read_pos);
 }
 
 
 /*! \brief Resize internal buffer.
  *  \param newsize The new size of the buffer (number of samples, not bytes)
+ *
+ * The buffer is cleared. This must not be called while the sniffer is
+ * connected in a running flow graph.
+ *
+ * The ring buffer is twice as large as the requested size so that work()
+ * can continue writing while the samples are being copied.
  */
 void sniffer_f::set_buffer_size(int newsize)
 {
-    boost::mutex::scoped_lock lock(d_mutex);
-
-    //d_buffer.clear();
-    d_buffer.set_capacity(newsize);
+    d_buffsize = newsize;
+    d_ring.resize(2 * newsize);
+    d_read_pos = 0;
 }
 
 
@@ -136,7 +125,5 @@ void sniffer_f::set_buffer_size(int newsize)
  */
 int  sniffer_f::buffer_size()
 {
-    boost::mutex::scoped_lock lock(d_mutex);
-
-    return d_buffer.capacity();
+    return d_buffsize;
 }
@@ -21,8 +21,8 @@
 #define SNIFFER_F_H
 
 #include <gr_sync_block.h>
-#include <boost/thread/mutex.hpp>
-#include <boost/circular_buffer.hpp>
+#include <vector>
+#include "dsp/lockfree.h"
 
 
 class sniffer_f;
@@ -48,9 +48,10 @@ sniffer_f_sptr make_sniffer_f(int buffsize=48000);
  * flow graph. For example, a sniffer can be connected to the output of the demodulator
  * and used by data decoders.
  *
- * The class uses a circular buffer for internal storage and if the received samples
- * exceed the buffer size, old samples will be overwritten. The collected samples
- * can be accessed via the get_samples() method.
+ * The class uses a lock-free ring buffer for internal storage and if the received
+ * samples exceed the buffer size, old samples will be overwritten. The collected
+ * samples can be accessed via the get_samples() method. work() never waits for
+ * the reader.
  */
 class sniffer_f : public gr_sync_block
 {
@@ -77,8 +78,9 @@ public:
 
 private:
 
-    boost::mutex d_mutex;                   /*! Used to prevent concurrent access to buffer. */
-    boost::circular_buffer<float> d_buffer; /*! buffer to accumulate samples. */
+    rx_ring_buffer<float> d_ring;           /*! buffer to accumulate samples. */
+    unsigned int d_read_pos;                /*! Ring position after the last sample read. */
+    int d_buffsize;                         /*! Largest number of samples returned. */
     int d_minsamp;                          /*! smallest number of samples we want to return. */
 
 };
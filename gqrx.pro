@@ -28,6 +28,9 @@ CONFIG(debug, debug|release) {
     ## QMAKE_LFLAGS += '-Wl,-rpath,\'\$$ORIGIN/lib\''
 }
 
+# allow the compiler to vectorize the DSP kernels (see dsp/fast_math.h)
+QMAKE_CXXFLAGS += -ftree-vectorize -fno-math-errno -fno-trapping-math
+
 # Tip from: http://www.qtcentre.org/wiki/index.php?title=Version_numbering_using_QMake
 VERSTR = '\\"$${VER}\\"'          # place quotes around the version string
 DEFINES += VERSION=\"$${VERSTR}\" # create a VERSION macro containing the version string
@@ -40,12 +43,22 @@ SOURCES += \
     qtgui/freqctrl.cpp \
     qtgui/meter.cpp \
     qtgui/plotter.cpp \
+    qtgui/framestats.cpp \
+    qtgui/spectrumlog.cpp \
+    dsp/fft_cache.cpp \
     dsp/rx_fft.cpp \
-    dsp/rx_filter.cpp \
+    dsp/rx_channelizer.cpp \
+    dsp/rx_vfo.cpp \
+    dsp/rx_decimator.cpp \
+    dsp/rx_halfband.cpp \
+    dsp/rx_rotator.cpp \
     dsp/rx_demod_fm.cpp \
+    dsp/rx_demod_wfm.cpp \
     dsp/rx_meter.cpp \
+    dsp/rx_squelch.cpp \
     qtgui/dockrxopt.cpp \
     dsp/rx_demod_am.cpp \
+    dsp/rx_demod_ssb.cpp \
     qtgui/ioconfig.cpp \
     qtgui/dockfcdctl.cpp \
     qtgui/dockaudio.cpp \
@@ -77,12 +90,24 @@ HEADERS += \
     qtgui/freqctrl.h \
     qtgui/meter.h \
     qtgui/plotter.h \
+    qtgui/framestats.h \
+    qtgui/spectrumlog.h \
+    dsp/fft_cache.h \
     dsp/rx_fft.h \
-    dsp/rx_filter.h \
+    dsp/rx_channelizer.h \
+    dsp/rx_vfo.h \
+    dsp/rx_decimator.h \
+    dsp/rx_halfband.h \
+    dsp/rx_rotator.h \
+    dsp/fast_math.h \
+    dsp/lockfree.h \
     dsp/rx_demod_fm.h \
+    dsp/rx_demod_wfm.h \
     dsp/rx_meter.h \
+    dsp/rx_squelch.h \
     qtgui/dockrxopt.h \
     dsp/rx_demod_am.h \
+    dsp/rx_demod_ssb.h \
     qtgui/ioconfig.h \
     qtgui/dockfcdctl.h \
     qtgui/dockaudio.h \
@@ -129,12 +154,12 @@ FORMS += \
 unix {
     CONFIG += link_pkgconfig
     PKGCONFIG += gnuradio-core gnuradio-audio gnuradio-osmosdr
-    PKGCONFIG += libusb-1.0
+    PKGCONFIG += libusb-1.0 fftw3f
 }
 
 macx-g++ {
     CONFIG += link_pkgconfig
-    PKGCONFIG += gnuradio-core gnuradio-audio
+    PKGCONFIG += gnuradio-core gnuradio-audio fftw3f
     INCLUDEPATH += /opt/local/include
     INCLUDEPATH += /opt/local/include/gnuradio
 }
@@ -31,12 +31,21 @@
 
 /* DSP */
 #include "receiver.h"
+#include "dsp/fft_cache.h"
+
+/* default length of the waterfall history in minutes */
+#define DEFAULT_WF_HISTORY 5
+
+/* S-meter peak hold time in ms and number of meter windows read per update */
+#define METER_PEAK_HOLD 2000
+#define METER_READ_MAX  64
 
 
 MainWindow::MainWindow(const QString cfgfile, QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
     d_lnb_lo(0),
+    d_wf_history(DEFAULT_WF_HISTORY),
     dec_bpsk1000(0),
     dec_afsk1200(0)
 {
@@ -57,6 +66,12 @@ MainWindow::MainWindow(const QString cfgfile, QWidget *parent) :
 
     d_filter_shape = receiver::FILTER_SHAPE_NORMAL;
 
+    /* load FFTW wisdom before the receiver creates its FFTs */
+    QDir().mkpath(m_cfg_dir);
+    m_fft_wisdom = QString("%1/fftw_wisdom").arg(m_cfg_dir);
+    if (!rx_fft_cache::load_wisdom(m_fft_wisdom.toStdString()))
+        qDebug() << "No FFTW wisdom in" << m_fft_wisdom;
+
     /* create receiver object */
     QString indev = CIoConfig::getFcdDeviceName();
     //QString outdev = settings.value("output").toString();
@@ -69,6 +84,9 @@ MainWindow::MainWindow(const QString cfgfile, QWidget *parent) :
     /* meter timer */
     meter_timer = new QTimer(this);
     connect(meter_timer, SIGNAL(timeout()), this, SLOT(meterTimeout()));
+    d_meter_pos = 0;
+    d_meter_peak = -200.0;
+    d_peak_clock.start();
 
     /* FFT timer & data */
     iq_fft_timer = new QTimer(this);
@@ -77,8 +95,10 @@ MainWindow::MainWindow(const QString cfgfile, QWidget *parent) :
     audio_fft_timer = new QTimer(this);
     connect(audio_fft_timer, SIGNAL(timeout()), this, SLOT(audioFftTimeout()));
 
-    d_fftData = new std::complex<float>[MAX_FFT_SIZE];
-    d_realFftData = new double[MAX_FFT_SIZE];
+    spec_replay_timer = new QTimer(this);
+    connect(spec_replay_timer, SIGNAL(timeout()), this, SLOT(specReplayTimeout()));
+
+    d_fftData = new float[MAX_FFT_SIZE];
 
     /* timer for data decoders */
     dec_timer = new QTimer(this);
@@ -138,6 +158,10 @@ MainWindow::MainWindow(const QString cfgfile, QWidget *parent) :
     connect(uiDockRxOpt, SIGNAL(demodSelected(int)), this, SLOT(selectDemod(int)));
     connect(uiDockRxOpt, SIGNAL(fmMaxdevSelected(float)), this, SLOT(setFmMaxdev(float)));
     connect(uiDockRxOpt, SIGNAL(fmEmphSelected(double)), this, SLOT(setFmEmph(double)));
+    connect(uiDockRxOpt, SIGNAL(fmStereoToggled(bool)), this, SLOT(setFmStereo(bool)));
+    connect(uiDockRxOpt, SIGNAL(amDetectorSelected(int)), this, SLOT(setAmDetector(int)));
+    connect(uiDockRxOpt, SIGNAL(amDcrToggled(bool)), this, SLOT(setAmDcrStatus(bool)));
+    connect(uiDockRxOpt, SIGNAL(cwPitchChanged(int)), this, SLOT(setCwPitch(int)));
     connect(uiDockRxOpt, SIGNAL(agcToggled(bool)), this, SLOT(setAgcOn(bool)));
     connect(uiDockRxOpt, SIGNAL(agcHangToggled(bool)), this, SLOT(setAgcHang(bool)));
     connect(uiDockRxOpt, SIGNAL(agcThresholdChanged(int)), this, SLOT(setAgcThreshold(int)));
@@ -155,6 +179,15 @@ MainWindow::MainWindow(const QString cfgfile, QWidget *parent) :
     connect(uiDockFft, SIGNAL(fftSizeChanged(int)), this, SLOT(setIqFftSize(int)));
     connect(uiDockFft, SIGNAL(fftRateChanged(int)), this, SLOT(setIqFftRate(int)));
     connect(uiDockFft, SIGNAL(fftSplitChanged(int)), this, SLOT(setIqFftSplit(int)));
+    connect(uiDockFft, SIGNAL(fftAvgChanged(int)), this, SLOT(setIqFftAvg(int)));
+
+    /* plan the FFT sizes offered by the FFT dock in the background and
+       save the wisdom for the next start */
+    QList<int> sizes = uiDockFft->fftSizes();
+    std::vector<int> iq_sizes;
+    for (int i = 0; i < sizes.size(); i++)
+        iq_sizes.push_back(qMin(sizes.at(i), MAX_FFT_SIZE));
+    rx_fft_cache::prepare(iq_sizes, std::vector<int>(), m_fft_wisdom.toStdString());
 
     // restore last session
     loadConfig(cfgfile);
@@ -162,6 +195,9 @@ MainWindow::MainWindow(const QString cfgfile, QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
+    /* stop background FFT planning */
+    rx_fft_cache::stop();
+
     /* stop and delete timers */
     dec_timer->stop();
     delete dec_timer;
@@ -175,6 +211,10 @@ MainWindow::~MainWindow()
     audio_fft_timer->stop();
     delete audio_fft_timer;
 
+    spec_replay_timer->stop();
+    delete spec_replay_timer;
+    d_spec_log.close();
+
     if (m_settings)
     {
         m_settings->setValue("configversion", 2);
@@ -202,6 +242,11 @@ MainWindow::~MainWindow()
         else
             m_settings->remove("input/corr_iq_phase");
 
+        if (d_wf_history != DEFAULT_WF_HISTORY)
+            m_settings->setValue("fft/waterfall_history", d_wf_history);
+        else
+            m_settings->remove("fft/waterfall_history");
+
         m_settings->sync();
         delete m_settings;
     }
@@ -214,7 +259,6 @@ MainWindow::~MainWindow()
     delete uiDockFcdCtl;
     delete rx;
     delete [] d_fftData;
-    delete [] d_realFftData;
 }
 
 /*! \brief Load new configuration.
@@ -256,6 +300,11 @@ bool MainWindow::loadConfig(const QString cfgfile)
     uiDockFcdCtl->setIqGain(m_settings->value("input/corr_iq_gain", 1.0).toDouble(&cok));
     uiDockFcdCtl->setIqPhase(m_settings->value("input/corr_iq_phase", 0.0).toDouble(&cok));
 
+    d_wf_history = m_settings->value("fft/waterfall_history", DEFAULT_WF_HISTORY).toInt(&cok);
+    if (!cok || (d_wf_history < 1))
+        d_wf_history = DEFAULT_WF_HISTORY;
+    ui->plotter->setWaterfallHistory(d_wf_history * 60 * uiDockFft->fftRate());
+
     return true;
 }
 
@@ -440,8 +489,8 @@ void MainWindow::selectDemod(int index)
 
         /* FM */
     case 2:
-        rx->set_demod(receiver::DEMOD_FM);
         maxdev = uiDockRxOpt->currentMaxdev();
+        rx->set_demod(maxdev < 20000.0 ? receiver::DEMOD_FM : receiver::DEMOD_WFM);
         if (maxdev < 20000.0) {
             ui->plotter->SetDemodRanges(-25000, -100, 100, 25000, true);
             uiDockAudio->setFftRange(0,12000);
@@ -461,21 +510,22 @@ void MainWindow::selectDemod(int index)
             }
         }
         else {
-            ui->plotter->SetDemodRanges(-45000, -10000, 10000, 45000, true);
+            /* stereo and RDS extend to 60 kHz plus deviation; the channel
+               rate is 240 kHz so the filter can not be wider than 96 kHz */
+            ui->plotter->SetDemodRanges(-95000, -10000, 10000, 95000, true);
             uiDockAudio->setFftRange(0,24000);
             switch (filter_preset) {
-            /** FIXME: not sure about these **/
             case 0: //wide
-                flo = -45000;
-                fhi = 45000;
+                flo = -95000;
+                fhi = 95000;
                 break;
-            case 2: // narrow
-                flo = -10000;
-                fhi = 10000;
+            case 2: // narrow (mono)
+                flo = -60000;
+                fhi = 60000;
                 break;
             default: // normal
-                flo = -35000;
-                fhi = 35000;
+                flo = -80000;
+                fhi = 80000;
                 break;
             }
         }
@@ -484,6 +534,7 @@ void MainWindow::selectDemod(int index)
         /* LSB */
     case 3:
         rx->set_demod(receiver::DEMOD_SSB);
+        rx->set_sideband(rx_demod_ssb::SIDEBAND_LSB);
         ui->plotter->SetDemodRanges(-10000, -100, -5000, 0, false);
         uiDockAudio->setFftRange(0,3500);
         switch (filter_preset) {
@@ -505,6 +556,7 @@ void MainWindow::selectDemod(int index)
         /* USB */
     case 4:
         rx->set_demod(receiver::DEMOD_SSB);
+        rx->set_sideband(rx_demod_ssb::SIDEBAND_USB);
         ui->plotter->SetDemodRanges(0, 5000, 100, 10000, false);
         uiDockAudio->setFftRange(0,3500);
         switch (filter_preset) {
@@ -523,44 +575,26 @@ void MainWindow::selectDemod(int index)
         }
         break;
 
-        /* CWL */
+        /* CWL and CWU; the BFO gives the pitch so the filter is
+           centred on the carrier */
     case 5:
-        rx->set_demod(receiver::DEMOD_SSB);
-        ui->plotter->SetDemodRanges(-10000, -100, -5000, 0, false);
-        uiDockAudio->setFftRange(0,1500);
-        switch (filter_preset) {
-        case 0: //wide
-            flo = -2300;
-            fhi = -200;
-            break;
-        case 2: // narrow
-            flo = -900;
-            fhi = -400;
-            break;
-        default: // normal
-            flo = -1200;
-            fhi = -200;
-            break;
-        }
-        break;
-
-        /* CWU */
     case 6:
-        rx->set_demod(receiver::DEMOD_SSB);
-        ui->plotter->SetDemodRanges(0, 5000, 100, 10000, false);
-        uiDockAudio->setFftRange(0,1500);
+        rx->set_demod(receiver::DEMOD_CW);
+        rx->set_sideband(index == 5 ? rx_demod_ssb::SIDEBAND_LSB : rx_demod_ssb::SIDEBAND_USB);
+        ui->plotter->SetDemodRanges(-2400, -50, 50, 2400, true);
+        uiDockAudio->setFftRange(0,2500);
         switch (filter_preset) {
         case 0: //wide
-            flo = 200;
-            fhi = 2300;
+            flo = -1000;
+            fhi = 1000;
             break;
         case 2: // narrow
-            flo = 400;
-            fhi = 900;
+            flo = -100;
+            fhi = 100;
             break;
         default: // normal
-            flo = 200;
-            fhi = 1200;
+            flo = -250;
+            fhi = 250;
             break;
         }
         break;
@@ -585,6 +619,9 @@ void MainWindow::setFmMaxdev(float max_dev)
 {
     qDebug() << "FM MAX_DEV: " << max_dev;
 
+    /* wideband FM needs a higher channel rate */
+    rx->set_demod(max_dev < 20000.0 ? receiver::DEMOD_FM : receiver::DEMOD_WFM);
+
     /* receiver will check range */
     rx->set_fm_maxdev(max_dev);
 
@@ -595,9 +632,9 @@ void MainWindow::setFmMaxdev(float max_dev)
         rx->set_filter(-5000.0, 5000.0, receiver::FILTER_SHAPE_NORMAL);
     }
     else {
-        ui->plotter->SetDemodRanges(-45000, -10000, 10000, 45000, true);
-        ui->plotter->SetHiLowCutFrequencies(-35000, 35000);
-        rx->set_filter(-35000.0, 35000.0, receiver::FILTER_SHAPE_NORMAL);
+        ui->plotter->SetDemodRanges(-95000, -10000, 10000, 95000, true);
+        ui->plotter->SetHiLowCutFrequencies(-80000, 80000);
+        rx->set_filter(-80000.0, 80000.0, receiver::FILTER_SHAPE_NORMAL);
     }
 }
 
@@ -614,6 +651,15 @@ void MainWindow::setFmEmph(double tau)
 }
 
 
+/*! \brief WFM stereo decoding toggled.
+ *  \param enabled Whether stereo is decoded when a pilot is received.
+ */
+void MainWindow::setFmStereo(bool enabled)
+{
+    rx->set_wfm_stereo(enabled);
+}
+
+
 /*! \brief AM DCR status changed (slot).
  *  \param enabled Whether DCR is enabled or not.
  */
@@ -622,6 +668,22 @@ void MainWindow::setAmDcrStatus(bool enabled)
     rx->set_am_dcr(enabled);
 }
 
+/*! \brief CW pitch changed (slot).
+ *  \param pitch The new pitch in Hz.
+ */
+void MainWindow::setCwPitch(int pitch)
+{
+    rx->set_cw_pitch(pitch);
+}
+
+/*! \brief AM detector changed (slot).
+ *  \param detector The new detector, see rx_demod_am::mode.
+ */
+void MainWindow::setAmDetector(int detector)
+{
+    rx->set_am_detector(detector);
+}
+
 /*! \brief Audio gain changed.
  *  \param value The new audio gain in dB.
  */
@@ -704,74 +766,139 @@ void MainWindow::setSqlLevel(double level_db)
 /*! \brief Signal strength meter timeout */
 void MainWindow::meterTimeout()
 {
-    float level;
+    rx_meter_level levels[METER_READ_MAX];
+    unsigned int i, num;
+
+    updateWfmStatus();
+
+    /* all windows completed since the last update, oldest first */
+    num = rx->get_signal_history(levels, METER_READ_MAX, d_meter_pos);
+    if (num == 0)
+        return;
+
+    /* hold the highest peak for METER_PEAK_HOLD ms */
+    for (i = 0; i < num; i++) {
+        if ((levels[i].peak >= d_meter_peak) || (d_peak_clock.elapsed() > METER_PEAK_HOLD)) {
+            d_meter_peak = levels[i].peak;
+            d_peak_clock.start();
+        }
+    }
+
+    ui->sMeter->setPeak(d_meter_peak);
+    ui->sMeter->setLevel(levels[num-1].rms);
+}
+
+/*! \brief Show the stereo and RDS status when the WFM demodulator is active. */
+void MainWindow::updateWfmStatus()
+{
+    rx_wfm_status st;
+    QString text;
+
+    if ((uiDockRxOpt->currentDemod() == 2) && (uiDockRxOpt->currentMaxdev() >= 20000.0)) {
+        st = rx->get_wfm_status();
+        text = QString("%1, pilot %2%").arg(st.stereo ? "Stereo" : "Mono")
+                                       .arg(100.0 * st.pilot, 0, 'f', 1);
+        if (st.pi >= 0)
+            text += QString("\nPI %1  PTY %2").arg(st.pi, 4, 16, QChar('0')).arg(st.pty)
+                    .toUpper();
+        if (st.ps[0])
+            text += QString("\nPS: %1").arg(QString::fromLatin1(st.ps));
+        if (st.rt[0])
+            text += QString("\nRT: %1").arg(QString::fromLatin1(st.rt).trimmed());
+    }
 
-    level = rx->get_signal_pwr(true);
-    ui->sMeter->setLevel(level);
+    uiDockRxOpt->setWfmStatus(text);
 }
 
 /*! \brief Baseband FFT plot timeout. */
 void MainWindow::iqFftTimeout()
 {
     int fftsize;
-    int i;
-    std::complex<float> pt;             /* a single FFT point used in calculations */
-    std::complex<float> scaleFactor;    /* normalizing factor (fftsize cast to complex) */
-    double min=0.0,max=-120.0,avg=0.0;
+    double center, span;
+    QElapsedTimer timer;
+    CFrameStats &stats = ui->plotter->frameStats();
+
+    /* show the display timing once per second */
+    if (!d_stats_clock.isValid() || (d_stats_clock.elapsed() >= 1000)) {
+        if (d_stats_clock.isValid())
+            uiDockFft->setFrameStats(stats, d_stats_clock.elapsed());
+        stats.resetCounts();
+        d_stats_clock.start();
+    }
 
+    /* the plotter is showing a spectrum log */
+    if (spec_replay_timer->isActive())
+        return;
 
-    rx->get_iq_fft_data(d_fftData, fftsize);
+    /* power spectrum in dBFS, already shifted by rx_fft_c */
+    timer.start();
+    rx->get_iq_fft_data(d_fftData, fftsize, center, span);
 
     if (fftsize == 0) {
         /* nothing to do, wait until next activation. */
         return;
     }
 
-    scaleFactor = std::complex<float>((float)fftsize);
-
-    /** FIXME: move post processing to rx_fft_c **/
-    /* Normalize, calculcate power and shift the FFT */
-    for (i = 0; i < fftsize; i++) {
+    stats.add(CFrameStats::FETCH, timer.nsecsElapsed() / 1000);
 
-        /* normalize and shift */
-        if (i < fftsize/2) {
-            pt = d_fftData[fftsize/2+i] / scaleFactor;
-        }
-        else {
-            pt = d_fftData[i-fftsize/2] / scaleFactor;
-        }
+    if (d_spec_log.isOpen() &&
+        !d_spec_log.write(ui->freqCtrl->GetFrequency() + (qint64) center, span,
+                          d_fftData, fftsize))
+    {
+        ui->actionSpecRec->setChecked(false);
+        on_actionSpecRec_triggered(false);
+        ui->statusBar->showMessage(tr("Spectrum recording stopped (FFT size changed or write error)"));
+    }
 
-        /* calculate power in dBFS */
-        d_realFftData[i] = 10.0 * log10(pt.imag()*pt.imag() + pt.real()*pt.real() + 1.0e-20);
+    /* Frame pacing: drop this frame if the previous one has not been
+       painted yet, or if less than twice the time it takes to display a
+       frame has passed since the previous one. This keeps at least half of
+       the GUI thread free for user input when drawing is slower than the
+       FFT rate. */
+    if (ui->plotter->paintPending() ||
+        (d_frame_clock.isValid() && (d_frame_clock.nsecsElapsed() < 2000.0 * stats.frameCost())))
+    {
+        stats.skipped();
+        return;
+    }
+    d_frame_clock.start();
 
-/*
-        if (d_realFftData[i] < min)
-            min = d_realFftData[i];
+    /* range covered by the data, which may be zoomed */
+    ui->plotter->SetFftDataRange((qint64) center, span);
+    ui->plotter->SetNewFttData(d_fftData, fftsize);
+}
 
-        if (d_realFftData[i] > max)
-            max = d_realFftData[i];
+/*! \brief Show the next frame of the spectrum log being replayed. */
+void MainWindow::specReplayTimeout()
+{
+    const spectrum_log_frame *frame;
 
-        avg = (avg+d_realFftData[i]) / 2.0;
-*/
+    if (d_spec_pos >= d_spec_replay.frames()) {
+        ui->actionSpecReplay->setChecked(false);
+        on_actionSpecReplay_triggered(false);
+        return;
     }
 
-    ui->plotter->SetNewFttData(d_realFftData, fftsize);
+    frame = &d_spec_replay.frame(d_spec_pos);
+    d_spec_replay.readFrame(d_spec_pos, d_fftData);
+    d_spec_pos++;
 
-    //qDebug() << "FFT size: " << fftsize;
-    //qDebug() << "FFT[0]=" << d_realFftData[0] << "  FFT[MID]=" << d_realFftData[fftsize/2];
-    //qDebug() << "MIN:" << min << "  AVG:" << avg << "  MAX:" << max;
+    ui->plotter->SetCenterFreq(frame->center);
+    ui->plotter->SetFftDataRange(0, frame->span);
+    ui->plotter->SetNewFttData(d_fftData, d_spec_replay.fftSize());
+
+    ui->statusBar->showMessage(tr("Spectrum replay: %1 UTC (%2 / %3)")
+                               .arg(QDateTime::fromMSecsSinceEpoch(frame->time).toUTC()
+                                    .toString("yyyy-MM-dd hh:mm:ss"))
+                               .arg(d_spec_pos).arg(d_spec_replay.frames()));
 }
 
 /*! \brief Audio FFT plot timeout. */
 void MainWindow::audioFftTimeout()
 {
     int fftsize;
-    int i;
-    std::complex<float> pt;             /* a single FFT point used in calculations */
-    std::complex<float> scaleFactor;    /* normalizing factor (fftsize cast to complex) */
-    double min=0.0,max=-120.0,avg=0.0;
-
 
+    /* power spectrum in dBFS from 0 Hz to fs/2 */
     rx->get_audio_fft_data(d_fftData, fftsize);
 
     if (fftsize == 0) {
@@ -780,25 +907,7 @@ void MainWindow::audioFftTimeout()
         return;
     }
 
-    scaleFactor = std::complex<float>((float)fftsize);
-
-    /** FIXME: move post processing to rx_fft_f **/
-    /* Normalize, calculcate power and shift the FFT */
-    for (i = 0; i < fftsize; i++) {
-
-        /* normalize and shift */
-        if (i < fftsize/2) {
-            pt = d_fftData[fftsize/2+i] / scaleFactor;
-        }
-        else {
-            pt = d_fftData[i-fftsize/2] / scaleFactor;
-        }
-
-        /* calculate power in dBFS */
-        d_realFftData[i] = 10.0 * log10(pt.imag()*pt.imag() + pt.real()*pt.real() + 1.0e-20);
-    }
-
-    uiDockAudio->setNewFttData(d_realFftData, fftsize);
+    uiDockAudio->setNewFttData(d_fftData, fftsize);
 }
 
 
@@ -900,7 +1009,7 @@ void MainWindow::toggleIqPlayback(bool play, const QString filename)
 /*! \brief FFT size has changed. */
 void MainWindow::setIqFftSize(int size)
 {
-    qDebug() << "Changing baseband FFT size TBD...";
+    rx->set_iq_fft_size(size);
 }
 
 /*! \brief Baseband FFT rate has changed. */
@@ -913,6 +1022,17 @@ void MainWindow::setIqFftRate(int fps)
 
     if (iq_fft_timer->isActive())
         iq_fft_timer->setInterval(interval);
+
+    /* keep the same waterfall history time */
+    ui->plotter->setWaterfallHistory(d_wf_history * 60 * fps);
+}
+
+/*! \brief Baseband FFT averaging mode has changed.
+ *  \param mode The new averaging mode (see rx_fft_avg).
+ */
+void MainWindow::setIqFftAvg(int mode)
+{
+    rx->set_iq_fft_averaging(mode);
 }
 
 /*! \brief Vertical split between waterfall and pandapter changed.
@@ -1023,6 +1143,81 @@ void MainWindow::on_actionSaveSettings_triggered()
 }
 
 
+/*! \brief Start/stop recording the baseband spectrum.
+ *  \param checked Whether recording should be started or stopped.
+ *
+ * Frames are stored quantized to 8 bits and at most four per second (the
+ * peak of the FFT frames in between), i.e. about 15 kB/s with 4096 bins.
+ */
+void MainWindow::on_actionSpecRec_triggered(bool checked)
+{
+    if (checked) {
+        int freq = (int)(ui->freqCtrl->GetFrequency()/1000);
+        QString name = QDateTime::currentDateTimeUtc().toString("gqrx-yyyyMMdd-hhmmss-%1.'spec'").arg(freq);
+
+        name = QFileDialog::getSaveFileName(this, tr("Record spectrum"),
+                                            QDir(m_last_dir.isEmpty() ? QDir::homePath() : m_last_dir).filePath(name),
+                                            tr("Spectrum logs (*.spec)"));
+
+        if (name.isEmpty() ||
+            !d_spec_log.open(name, rx->get_iq_fft_size(), rx->get_rf_sample_rate()))
+        {
+            ui->actionSpecRec->setChecked(false);
+            if (!name.isEmpty())
+                ui->statusBar->showMessage(tr("Error creating spectrum log %1").arg(name));
+            return;
+        }
+
+        d_spec_log.setInterval(250);
+        ui->actionSpecReplay->setEnabled(false);
+        ui->statusBar->showMessage(tr("Recording spectrum to: %1").arg(name), 5000);
+    }
+    else {
+        d_spec_log.close();
+        ui->actionSpecReplay->setEnabled(true);
+        ui->statusBar->showMessage(tr("Spectrum recording stopped: %1 frames, %2 kB")
+                                   .arg(d_spec_log.frames())
+                                   .arg(d_spec_log.bytes()/1024), 5000);
+    }
+}
+
+/*! \brief Start/stop replaying a spectrum log in the main plotter.
+ *  \param checked Whether replay should be started or stopped.
+ *
+ * The log is memory mapped and one frame is shown per FFT update, so the
+ * replay runs faster than the recording.
+ */
+void MainWindow::on_actionSpecReplay_triggered(bool checked)
+{
+    if (checked) {
+        QString name = QFileDialog::getOpenFileName(this, tr("Replay spectrum"),
+                                                    m_last_dir.isEmpty() ? QDir::homePath() : m_last_dir,
+                                                    tr("Spectrum logs (*.spec)"));
+
+        if (name.isEmpty() || !d_spec_replay.open(name, MAX_FFT_SIZE)) {
+            ui->actionSpecReplay->setChecked(false);
+            if (!name.isEmpty())
+                ui->statusBar->showMessage(tr("%1 is not a spectrum log").arg(name));
+            return;
+        }
+
+        d_spec_pos = 0;
+        ui->plotter->setSampleRate(d_spec_replay.sampleRate());
+        ui->actionSpecRec->setEnabled(false);
+        spec_replay_timer->start(1000/uiDockFft->fftRate());
+    }
+    else {
+        spec_replay_timer->stop();
+        d_spec_replay.close();
+
+        /* back to the live spectrum */
+        ui->plotter->setSampleRate(rx->get_rf_sample_rate());
+        ui->plotter->SetCenterFreq(ui->freqCtrl->GetFrequency());
+        ui->actionSpecRec->setEnabled(true);
+        ui->statusBar->showMessage(tr("Spectrum replay stopped"), 5000);
+    }
+}
+
 /*! \brief Toggle I/Q recording. */
 void MainWindow::on_actionIqRec_triggered(bool checked)
 {
@@ -1082,6 +1277,18 @@ void MainWindow::on_plotter_NewFilterFreq(int low, int high)
 
 }
 
+/*! \brief Shown range of the main plotter has changed.
+ *  \param center The center of the range relative to the RF frequency.
+ *  \param span The width of the shown range.
+ *
+ * The baseband FFT is zoomed to the shown range so that its resolution
+ * follows the span.
+ */
+void MainWindow::on_plotter_NewFftRange(qint64 center, qint32 span)
+{
+    rx->set_iq_fft_zoom((double) center, (double) span);
+}
+
 /*! \brief Full screen button or menu item toggled. */
 void MainWindow::on_actionFullScreen_triggered(bool checked)
 {
@@ -26,6 +26,7 @@
 #include <QSettings>
 #include <QString>
 #include <QTimer>
+#include <QElapsedTimer>
 
 #include "qtgui/dockrxopt.h"
 #include "qtgui/dockaudio.h"
@@ -34,6 +35,7 @@
 #include "qtgui/dockfft.h"
 #include "qtgui/afsk1200win.h"
 #include "qtgui/bpsk1000win.h"
+#include "qtgui/spectrumlog.h"
 
 #include <receiver.h>
 
@@ -63,13 +65,13 @@ private:
     QPointer<QSettings> m_settings;  /*!< Application wide settings. */
     QString             m_cfg_dir;   /*!< Default config dir, e.g. XDG_CONFIG_HOME. */
     QString             m_last_dir;
+    QString             m_fft_wisdom;  /*!< FFTW wisdom file in m_cfg_dir. */
 
     qint64 d_lnb_lo;  /* LNB LO in Hz. */
+    int    d_wf_history;  /* Waterfall history in minutes. */
 
     enum receiver::filter_shape d_filter_shape;
-    std::complex<float>* d_fftData;
-    double *d_realFftData;
-    //double *d_audioFttData;
+    float  *d_fftData;  /*!< FFT power spectrum in dBFS (IQ and audio). */
 
     Ui::MainWindow *ui;
 
@@ -88,9 +90,23 @@ private:
     QTimer   *meter_timer;
     QTimer   *iq_fft_timer;
     QTimer   *audio_fft_timer;
+    QTimer   *spec_replay_timer;
+
+    CSpectrumLogWriter  d_spec_log;     /*!< Spectrum recorder. */
+    CSpectrumLogReader  d_spec_replay;  /*!< Spectrum log being replayed. */
+    int                 d_spec_pos;     /*!< Next frame to replay. */
+
+    unsigned int   d_meter_pos;     /*!< Position in the signal level history. */
+    float          d_meter_peak;    /*!< Peak hold level of the S-meter. */
+    QElapsedTimer  d_peak_clock;    /*!< Time since d_meter_peak was set. */
+
+    QElapsedTimer  d_frame_clock;   /*!< Time since the last displayed FFT frame. */
+    QElapsedTimer  d_stats_clock;   /*!< Time since the display timing was shown. */
 
     receiver *rx;
 
+    void updateWfmStatus();
+
 private slots:
     /* rf */
     void setLnbLo(double freq_mhz);
@@ -105,7 +121,10 @@ private slots:
     void selectDemod(int index);
     void setFmMaxdev(float max_dev);
     void setFmEmph(double tau);
+    void setFmStereo(bool enabled);
     void setAmDcrStatus(bool enabled);
+    void setAmDetector(int detector);
+    void setCwPitch(int pitch);
     void setAgcOn(bool agc_on);
     void setAgcHang(bool use_hang);
     void setAgcThreshold(int threshold);
@@ -128,16 +147,20 @@ private slots:
     void setIqFftSize(int size);
     void setIqFftRate(int fps);
     void setIqFftSplit(int pct_wf);
+    void setIqFftAvg(int mode);
     void setAudioFftRate(int fps);
 
     void on_plotter_NewDemodFreq(qint64 freq, qint64 delta);   /*! New demod freq (aka. filter offset). */
     void on_plotter_NewFilterFreq(int low, int high);    /*! New filter width */
+    void on_plotter_NewFftRange(qint64 center, qint32 span);  /*! Zoom the FFT to the shown range. */
 
     /* menu and toolbar actions */
     void on_actionDSP_triggered(bool checked);
     void on_actionLoadSettings_triggered();
     void on_actionSaveSettings_triggered();
     void on_actionIqRec_triggered(bool checked);
+    void on_actionSpecRec_triggered(bool checked);
+    void on_actionSpecReplay_triggered(bool checked);
     void on_actionFullScreen_triggered(bool checked);
     void on_actionIODevices_triggered();
     void on_actionAFSK1200_triggered();
@@ -155,6 +178,7 @@ private slots:
     void meterTimeout();
     void iqFftTimeout();
     void audioFftTimeout();
+    void specReplayTimeout();
 
 };
 
@@ -57,8 +57,28 @@ int CDemodOptions::currentPage()
     return ui->demodOptions->currentIndex();
 }
 
+/*! \brief Get the currently selected FM deviation in Hz. */
+float CDemodOptions::currentMaxdev()
+{
+    return maxdevFromIndex(ui->maxdevSelector->currentIndex());
+}
+
+/*! \brief Show the stereo and RDS status of the WFM demodulator.
+ *  \param status Status text, empty when not in WFM mode.
+ */
+void CDemodOptions::setWfmStatus(const QString &status)
+{
+    ui->wfmStatusLabel->setText(status);
+}
+
 
 void CDemodOptions::on_maxdevSelector_activated(int index)
+{
+    emit fmMaxdevSelected(maxdevFromIndex(index));
+}
+
+/*! \brief Convert maxdevSelector index to deviation in Hz. */
+float CDemodOptions::maxdevFromIndex(int index)
 {
     float max_dev;
 
@@ -87,7 +107,7 @@ void CDemodOptions::on_maxdevSelector_activated(int index)
         break;
     }
 
-    emit fmMaxdevSelected(max_dev);
+    return max_dev;
 }
 
 void CDemodOptions::on_emphSelector_activated(int index)
@@ -103,3 +123,23 @@ void CDemodOptions::on_emphSelector_activated(int index)
     tau = tau_tbl[index] * 1.0e-6;
     emit fmEmphSelected(tau);
 }
+
+void CDemodOptions::on_stereoCheckBox_toggled(bool checked)
+{
+    emit fmStereoToggled(checked);
+}
+
+void CDemodOptions::on_amDetectorSelector_activated(int index)
+{
+    emit amDetectorSelected(index);
+}
+
+void CDemodOptions::on_dcrCheckBox_toggled(bool checked)
+{
+    emit amDcrToggled(checked);
+}
+
+void CDemodOptions::on_cwPitchSpinBox_valueChanged(int value)
+{
+    emit cwPitchChanged(value);
+}
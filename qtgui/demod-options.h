@@ -41,7 +41,9 @@ public:
     enum page {
         PAGE_NO_OPT = 0,
         PAGE_FM_OPT = 1,
-        PAGE_NUM    = 2
+        PAGE_AM_OPT = 2,
+        PAGE_CW_OPT = 3,
+        PAGE_NUM    = 4
     };
 
     explicit CDemodOptions(QWidget *parent = 0);
@@ -52,6 +54,9 @@ public:
     void setCurrentPage(int index);
     int  currentPage();
 
+    float currentMaxdev();
+    void  setWfmStatus(const QString &status);
+
 signals:
     /*! \brief Signal emitted when new FM deviation is selected. */
     void fmMaxdevSelected(float max_dev);
@@ -59,11 +64,29 @@ signals:
     /*! \brief Signal emitted when new FM de-emphasis constant is selected. */
     void fmEmphSelected(double tau);
 
+    /*! \brief Signal emitted when WFM stereo decoding is toggled. */
+    void fmStereoToggled(bool enabled);
+
+    /*! \brief Signal emitted when a new AM detector is selected. */
+    void amDetectorSelected(int detector);
+
+    /*! \brief Signal emitted when AM DCR is toggled. */
+    void amDcrToggled(bool enabled);
+
+    /*! \brief Signal emitted when the CW pitch has changed. */
+    void cwPitchChanged(int pitch);
+
 private slots:
     void on_maxdevSelector_activated(int index);
     void on_emphSelector_activated(int index);
+    void on_stereoCheckBox_toggled(bool checked);
+    void on_amDetectorSelector_activated(int index);
+    void on_dcrCheckBox_toggled(bool checked);
+    void on_cwPitchSpinBox_valueChanged(int value);
 
 private:
+    float maxdevFromIndex(int index);
+
     Ui::CDemodOptions *ui;
 };
 
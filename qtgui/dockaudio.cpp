@@ -32,8 +32,9 @@ DockAudio::DockAudio(QWidget *parent) :
     ui->audioSpectrum->SetPercent2DScreen(100);
     ui->audioSpectrum->SetFreqUnits(1000);
     ui->audioSpectrum->setSampleRate(48000);  // Full bandwidth
+    ui->audioSpectrum->SetHalfSpectrum(true); // Real FFT: 0 to 24 kHz
     ui->audioSpectrum->SetSpanFreq(12000);
-    ui->audioSpectrum->SetCenterFreq(6000);
+    ui->audioSpectrum->SetCenterFreq(0);
     ui->audioSpectrum->SetFftCenterFreq(6000);
     ui->audioSpectrum->SetDemodCenterFreq(3000);
     ui->audioSpectrum->SetFilterBoxEnabled(false);
@@ -57,13 +58,12 @@ void DockAudio::setFftRange(quint64 minf, quint64 maxf)
         qint32 span = (qint32)(maxf - minf);
         quint64 fc = minf + (maxf - minf)/2;
 
-        ui->audioSpectrum->SetFftCenterFreq(fc);
         ui->audioSpectrum->SetSpanFreq(span);
-        ui->audioSpectrum->SetCenterFreq(fc);
+        ui->audioSpectrum->SetFftCenterFreq(fc);
     }
 }
 
-void DockAudio::setNewFttData(double *fftData, int size)
+void DockAudio::setNewFttData(float *fftData, int size)
 {
     ui->audioSpectrum->SetNewFttData(fftData, size);
 }
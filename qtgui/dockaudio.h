@@ -45,7 +45,7 @@ public:
     ~DockAudio();
 
     void setFftRange(quint64 minf, quint64 maxf);
-    void setNewFttData(double *fftData, int size);
+    void setNewFttData(float *fftData, int size);
     int  fftRate() { return 10; }
 
     void setAudioGain(int gain);
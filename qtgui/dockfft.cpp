@@ -59,6 +59,44 @@ int DockFft::fftRate()
     return fps;
 }
 
+/*! \brief Get the FFT sizes that can be selected. */
+QList<int> DockFft::fftSizes()
+{
+    QList<int> sizes;
+    int i;
+
+    for (i = 0; i < ui->fftSizeComboBox->count(); i++)
+        sizes.append(ui->fftSizeComboBox->itemText(i).toInt());
+
+    return sizes;
+}
+
+/*! \brief Show the timing of the spectrum display.
+ *  \param stats The timing statistics of the plotter.
+ *  \param msec The time since the frame counters were reset.
+ */
+void DockFft::setFrameStats(const CFrameStats &stats, int msec)
+{
+    QString text = tr("Stage       avg   p95   max");
+    int total = stats.drawnCount() + stats.skippedCount();
+    int i;
+
+    for (i = 0; i < CFrameStats::NUM_STAGES; i++)
+    {
+        text += QString("\n%1%2%3%4")
+                .arg(CFrameStats::stageName(i), -9)
+                .arg(stats.mean(i) / 1000.0, 6, 'f', 2)
+                .arg(stats.percentile(i, 95.0) / 1000.0, 6, 'f', 2)
+                .arg(stats.maximum(i) / 1000.0, 6, 'f', 2);
+    }
+
+    text += tr("\n%1 fps, %2% skipped")
+            .arg(msec > 0 ? 1000.0 * stats.drawnCount() / msec : 0.0, 0, 'f', 1)
+            .arg(total > 0 ? 100 * stats.skippedCount() / total : 0);
+
+    ui->fftTimingLabel->setText(text);
+}
+
 /*! \brief FFT size changed. */
 void DockFft::on_fftSizeComboBox_currentIndexChanged(const QString &text)
 {
@@ -82,3 +120,14 @@ void DockFft::on_fftSplitSlider_valueChanged(int value)
 {
     emit fftSplitChanged(value);
 }
+
+/*! \brief FFT averaging mode selected.
+ *
+ * The combo box items are in the same order as rx_fft_avg. This is also
+ * emitted when the current mode is selected again, which restarts peak
+ * and min hold.
+ */
+void DockFft::on_fftAvgComboBox_activated(int index)
+{
+    emit fftAvgChanged(index);
+}
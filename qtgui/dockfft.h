@@ -21,6 +21,8 @@
 #define DOCKFFT_H
 
 #include <QDockWidget>
+#include <QList>
+#include "qtgui/framestats.h"
 
 namespace Ui {
     class DockFft;
@@ -37,16 +39,21 @@ public:
     ~DockFft();
 
     int fftRate();
+    QList<int> fftSizes();
+
+    void setFrameStats(const CFrameStats &stats, int msec);
 
 signals:
     void fftSizeChanged(int size);  /*! \brief FFT size changed. */
     void fftRateChanged(int fps);   /*! \brief FFT rate changed. */
     void fftSplitChanged(int pct);  /*! \brief Split between pandapter and waterfall changed. */
+    void fftAvgChanged(int mode);   /*! \brief FFT averaging mode selected. */
 
 private slots:
     void on_fftSizeComboBox_currentIndexChanged(const QString & text);
     void on_fftRateComboBox_currentIndexChanged(const QString & text);
     void on_fftSplitSlider_valueChanged(int value);
+    void on_fftAvgComboBox_activated(int index);
 
 private:
     Ui::DockFft *ui;
@@ -38,6 +38,10 @@ DockRxOpt::DockRxOpt(QWidget *parent) :
     demodOpt->setCurrentPage(CDemodOptions::PAGE_FM_OPT);
     connect(demodOpt, SIGNAL(fmMaxdevSelected(float)), this, SLOT(demodOpt_fmMaxdevSelected(float)));
     connect(demodOpt, SIGNAL(fmEmphSelected(double)), this, SLOT(demodOpt_fmEmphSelected(double)));
+    connect(demodOpt, SIGNAL(fmStereoToggled(bool)), this, SLOT(demodOpt_fmStereoToggled(bool)));
+    connect(demodOpt, SIGNAL(amDetectorSelected(int)), this, SLOT(demodOpt_amDetectorSelected(int)));
+    connect(demodOpt, SIGNAL(amDcrToggled(bool)), this, SLOT(demodOpt_amDcrToggled(bool)));
+    connect(demodOpt, SIGNAL(cwPitchChanged(int)), this, SLOT(demodOpt_cwPitchChanged(int)));
 }
 
 DockRxOpt::~DockRxOpt()
@@ -115,8 +119,13 @@ int  DockRxOpt::currentDemod()
 
 float DockRxOpt::currentMaxdev()
 {
-    qDebug() << __FILE__ << __FUNCTION__ << "FIXME";
-    return 5000.0;
+    return demodOpt->currentMaxdev();
+}
+
+/*! \brief Show the stereo and RDS status of the WFM demodulator. */
+void DockRxOpt::setWfmStatus(const QString &status)
+{
+    demodOpt->setWfmStatus(status);
 }
 
 /*! \brief Channel filter offset has changed
@@ -178,6 +187,10 @@ void DockRxOpt::on_modeSelector_activated(int index)
     /* update demodulator option widget */
     if (index == 2)
         demodOpt->setCurrentPage(CDemodOptions::PAGE_FM_OPT);
+    else if (index == 1)
+        demodOpt->setCurrentPage(CDemodOptions::PAGE_AM_OPT);
+    else if ((index == 5) || (index == 6))
+        demodOpt->setCurrentPage(CDemodOptions::PAGE_CW_OPT);
     else
         demodOpt->setCurrentPage(CDemodOptions::PAGE_NO_OPT);
 
@@ -335,6 +348,36 @@ void DockRxOpt::demodOpt_fmEmphSelected(double tau)
     emit fmEmphSelected(tau);
 }
 
+/*! \brief WFM stereo decoding toggled by user.
+ *  \param enabled Whether stereo should be decoded.
+ */
+void DockRxOpt::demodOpt_fmStereoToggled(bool enabled)
+{
+    emit fmStereoToggled(enabled);
+}
+
+/*! \brief AM detector changed by user.
+ *  \param detector The new detector, see rx_demod_am::mode.
+ */
+void DockRxOpt::demodOpt_amDetectorSelected(int detector)
+{
+    emit amDetectorSelected(detector);
+}
+
+/*! \brief AM DCR toggled by user. */
+void DockRxOpt::demodOpt_amDcrToggled(bool enabled)
+{
+    emit amDcrToggled(enabled);
+}
+
+/*! \brief CW pitch changed by user.
+ *  \param pitch The new pitch in Hz.
+ */
+void DockRxOpt::demodOpt_cwPitchChanged(int pitch)
+{
+    emit cwPitchChanged(pitch);
+}
+
 /*! \brief Noise blanker 1 button has been toggled. */
 void DockRxOpt::on_nb1Button_toggled(bool checked)
 {
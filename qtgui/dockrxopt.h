@@ -59,6 +59,8 @@ public:
 
     float currentMaxdev();
 
+    void setWfmStatus(const QString &status);
+
 private:
     void updateRxFreq();
 
@@ -75,9 +77,18 @@ signals:
     /*! \brief Signal emitted when new FM de-emphasis constant is selected. */
     void fmEmphSelected(double tau);
 
+    /*! \brief Signal emitted when WFM stereo decoding is toggled. */
+    void fmStereoToggled(bool enabled);
+
     /*! \brief Signal emitted when AM DCR status is toggled. */
     void amDcrToggled(bool enabled);
 
+    /*! \brief Signal emitted when a new AM detector is selected. */
+    void amDetectorSelected(int detector);
+
+    /*! \brief Signal emitted when the CW pitch has changed. */
+    void cwPitchChanged(int pitch);
+
     /*! \brief Signal emitted when baseband gain has changed. Gain is in dB. */
     void bbGainChanged(float gain);
 
@@ -127,6 +138,10 @@ private slots:
     /* Signals coming from demod options pop-up */
     void demodOpt_fmMaxdevSelected(float max_dev);
     void demodOpt_fmEmphSelected(double tau);
+    void demodOpt_fmStereoToggled(bool enabled);
+    void demodOpt_amDetectorSelected(int detector);
+    void demodOpt_amDcrToggled(bool enabled);
+    void demodOpt_cwPitchChanged(int pitch);
 
 private:
     Ui::DockRxOpt *ui;        /*! The Qt designer UI file. */
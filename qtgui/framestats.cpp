@@ -0,0 +1,148 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <math.h>
+#include <string.h>
+#include "qtgui/framestats.h"
+
+
+/*! \brief Histogram bucket of a duration, 4 buckets per octave. */
+static int bucket_of(qint64 us)
+{
+    int b;
+
+    if (us < 1)
+        return 0;
+
+    b = (int)(4.0 * log2((double)us));
+
+    return (b < FRAME_STATS_BUCKETS) ? b : FRAME_STATS_BUCKETS - 1;
+}
+
+CFrameStats::CFrameStats()
+{
+    reset();
+}
+
+/*! \brief Add the duration of a stage.
+ *  \param stage The stage (see CFrameStats::stage).
+ *  \param us The duration in microseconds.
+ *
+ * The oldest duration of the stage is removed from the window.
+ */
+void CFrameStats::add(int stage, qint64 us)
+{
+    int pos = m_Head[stage];
+
+    if (us > 0x7fffffff)
+        us = 0x7fffffff;
+
+    if (m_Count[stage] == FRAME_STATS_WINDOW)
+    {
+        m_Sum[stage] -= m_Time[stage][pos];
+        m_Hist[stage][m_Bucket[stage][pos]]--;
+    }
+    else
+    {
+        m_Count[stage]++;
+    }
+
+    m_Time[stage][pos] = (qint32)us;
+    m_Bucket[stage][pos] = (quint8)bucket_of(us);
+    m_Sum[stage] += us;
+    m_Hist[stage][m_Bucket[stage][pos]]++;
+
+    m_Head[stage] = (pos + 1) % FRAME_STATS_WINDOW;
+}
+
+/*! \brief Clear all statistics. */
+void CFrameStats::reset()
+{
+    memset(m_Hist, 0, sizeof(m_Hist));
+    memset(m_Sum, 0, sizeof(m_Sum));
+    memset(m_Head, 0, sizeof(m_Head));
+    memset(m_Count, 0, sizeof(m_Count));
+    m_Drawn = 0;
+    m_Skipped = 0;
+}
+
+/*! \brief Mean duration of a stage in microseconds. */
+double CFrameStats::mean(int stage) const
+{
+    return m_Count[stage] ? (double)m_Sum[stage] / m_Count[stage] : 0.0;
+}
+
+/*! \brief Percentile of the duration of a stage.
+ *  \param stage The stage.
+ *  \param p The percentile, 0 to 100.
+ *  \return The upper edge of the histogram bucket containing the percentile,
+ *          in microseconds (at most 19% too high).
+ */
+double CFrameStats::percentile(int stage, double p) const
+{
+    int target = (int)ceil(p * m_Count[stage] / 100.0);
+    int sum = 0;
+    int b;
+
+    if (m_Count[stage] == 0)
+        return 0.0;
+
+    for (b = 0; b < FRAME_STATS_BUCKETS - 1; b++)
+    {
+        sum += m_Hist[stage][b];
+        if (sum >= target)
+            break;
+    }
+
+    return pow(2.0, (b + 1) / 4.0);
+}
+
+/*! \brief Longest duration of a stage in the window in microseconds. */
+double CFrameStats::maximum(int stage) const
+{
+    qint32 max = 0;
+    int i;
+
+    for (i = 0; i < m_Count[stage]; i++)
+        max = (m_Time[stage][i] > max) ? m_Time[stage][i] : max;
+
+    return max;
+}
+
+/*! \brief Mean time spent on a frame in microseconds (all stages). */
+double CFrameStats::frameCost() const
+{
+    double cost = 0.0;
+    int i;
+
+    for (i = 0; i < NUM_STAGES; i++)
+        cost += mean(i);
+
+    return cost;
+}
+
+/*! \brief Short name of a stage for display. */
+const char *CFrameStats::stageName(int stage)
+{
+    static const char *names[NUM_STAGES] = {
+        "Fetch", "Convert", "Waterfall", "Trace", "Paint"
+    };
+
+    return ((stage >= 0) && (stage < NUM_STAGES)) ? names[stage] : "";
+}
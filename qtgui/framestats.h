@@ -0,0 +1,81 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <QtGlobal>
+
+#define FRAME_STATS_WINDOW   256   /*!< Number of frames in the rolling statistics. */
+#define FRAME_STATS_BUCKETS  80    /*!< Histogram buckets, 4 per octave from 1 us. */
+
+
+/*! \brief Timing statistics of the spectrum display.
+ *
+ * Keeps the duration of each stage of the last FRAME_STATS_WINDOW frames
+ * and a rolling histogram of them, so that the mean, percentiles and
+ * maximum can be shown without storing or sorting more than the window.
+ * Everything runs in the GUI thread.
+ */
+class CFrameStats
+{
+public:
+    /*! \brief The stages of a frame. */
+    enum stage {
+        FETCH = 0,    /*!< Getting the FFT data from the receiver. */
+        CONVERT,      /*!< Quantizing and reducing the data to pixels. */
+        WATERFALL,    /*!< Rendering the waterfall. */
+        TRACE,        /*!< Drawing the 2D spectrum. */
+        PAINT,        /*!< Painting the widget. */
+        NUM_STAGES
+    };
+
+    CFrameStats();
+
+    void add(int stage, qint64 us);
+    void reset();
+
+    double mean(int stage) const;
+    double percentile(int stage, double p) const;
+    double maximum(int stage) const;
+    double frameCost() const;
+
+    /*! \brief Count a displayed frame. */
+    void drawn() { m_Drawn++; }
+    /*! \brief Count a frame skipped by the frame pacing. */
+    void skipped() { m_Skipped++; }
+
+    int  drawnCount() const { return m_Drawn; }
+    int  skippedCount() const { return m_Skipped; }
+    void resetCounts() { m_Drawn = 0; m_Skipped = 0; }
+
+    static const char *stageName(int stage);
+
+private:
+    qint32  m_Time[NUM_STAGES][FRAME_STATS_WINDOW];     /*!< Durations in us, ring buffer. */
+    quint8  m_Bucket[NUM_STAGES][FRAME_STATS_WINDOW];   /*!< Histogram bucket of each duration. */
+    quint16 m_Hist[NUM_STAGES][FRAME_STATS_BUCKETS];    /*!< Number of durations per bucket. */
+    qint64  m_Sum[NUM_STAGES];                          /*!< Sum of the durations in the window. */
+    int     m_Head[NUM_STAGES];                         /*!< Next position in the ring buffers. */
+    int     m_Count[NUM_STAGES];                        /*!< Number of durations in the window. */
+    int     m_Drawn;
+    int     m_Skipped;
+};
+
+#endif // FRAMESTATS_H
@@ -57,6 +57,7 @@ CMeter::CMeter(QWidget *parent) : QFrame(parent)
     m_Size = QSize(0,0);
     m_Slevel = 0;
     m_dBm = -120;
+    m_Speak = -1;
     d_alpha_decay = 0.25; // FIXME: Should set delta-t and Fs instead
     d_alpha_rise = 0.7;   // FIXME: Should set delta-t and Fs instead
 }
@@ -133,6 +134,28 @@ void CMeter::setLevel(float dbfs)
     draw();
 }
 
+/*! \brief Set the peak hold level.
+ *  \param dbfs The peak level in dBFS, below the scale to hide the marker.
+ *
+ * The marker is drawn with the next setLevel().
+ */
+void CMeter::setPeak(float dbfs)
+{
+    if (dbfs < MIN_DB)
+    {
+        m_Speak = -1;
+        return;
+    }
+
+    if (dbfs > MAX_DB)
+        dbfs = MAX_DB;
+
+    qreal w = (qreal)m_2DPixmap.width();
+    w = w - 2.0*CTRL_MARGIN*w;
+
+    m_Speak = (int)(-(MIN_DB-dbfs) * w / fabs(MAX_DB - MIN_DB));
+}
+
 //////////////////////////////////////////////////////////////////////
 // Called by QT when screen needs to be redrawn
 //////////////////////////////////////////////////////////////////////
@@ -181,6 +204,13 @@ void CMeter::draw()
     //painter.drawPolygon(pts,3);
     painter.drawRect(marg, ht+2, x-marg, 6);
 
+    // peak hold marker
+    if (m_Speak >= 0)
+    {
+        painter.setPen(QPen(QColor(0xEF, 0xEF, 0x00, 0xFF), 2));
+        painter.drawLine(QLineF(marg + m_Speak, ht, marg + m_Speak, ht + 10));
+    }
+
     // create Font to use for scales
     QFont Font("Arial");
     QFontMetrics metrics(Font);
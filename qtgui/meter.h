@@ -58,6 +58,7 @@ signals:
 
 public slots:
     void setLevel(float dbfs);
+    void setPeak(float dbfs);
 
 
 protected:
@@ -73,6 +74,7 @@ private:
     QString m_Str;
     int m_Slevel;
     int m_dBm;
+    int m_Speak;     /*!< Peak hold marker position in pixels, -1 if off. */
 
     float d_alpha_decay;
     float d_alpha_rise;
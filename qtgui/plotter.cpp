@@ -37,6 +37,11 @@
 //////////////////////////////////////////////////////////////////////
 #define CUR_CUT_DELTA 5		//cursor capture delta in pixels
 
+// waterfall history is stored as one byte per FFT bin
+#define HIST_DB_MIN     -150.0f	//level of quantized value 0
+#define HIST_DB_STEP    0.625f	//dB per quantized step (up to +9.4 dB)
+#define HIST_MAX_BYTES  (64*1024*1024)	//upper limit of history memory
+
 
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
@@ -71,7 +76,14 @@ CPlotter::CPlotter(QWidget *parent) :
             m_ColorTbl[i].setRgb( 255, 0, 128*(i-217)/38);
     }
 
+    // the waterfall is drawn using pixel values of the scaled FFT data
+    for (int i = 0; i < 256; i++)
+        m_WaterfallLut[i] = m_ColorTbl[255-i].rgb();
+
     m_FftCenter = 0;
+    m_HalfSpectrum = false;
+    m_MapWidth = 0;
+    m_MapFftSize = 0;
     m_CenterFreq = 144500000;
     m_DemodCenterFreq = 144500000;
     m_DemodHiCutFreq = 5000;
@@ -92,6 +104,8 @@ CPlotter::CPlotter(QWidget *parent) :
 
     m_Span = 1920000;
     m_SampleFreq = 1920000;
+    m_FftDataCenter = 0;
+    m_FftDataSpan = 1920000;
 
     m_HorDivs = 12;
     m_VerDivs = 6;
@@ -102,10 +116,19 @@ CPlotter::CPlotter(QWidget *parent) :
     m_FreqUnits = 1000000;
     m_CursorCaptured = NONE;
     m_Running = false;
+    m_PaintPending = false;
     m_DrawOverlay = false;
     m_2DPixmap = QPixmap(0,0);
     m_OverlayPixmap = QPixmap(0,0);
-    m_WaterfallPixmap = QPixmap(0,0);
+    m_WaterfallImage = QImage();
+    m_WaterfallLine = 0;
+    m_WaterfallDirty = true;
+    m_HistFrames = 1000;
+    m_HistSize = 0;
+    m_HistBins = 0;
+    m_HistCount = 0;
+    m_HistHead = 0;
+    m_HistOffset = 0;
     m_Size = QSize(0,0);
     m_GrabPosition = 0;
     m_Percent2DScreen = 50;	//percent of screen used for 2D display
@@ -423,6 +446,24 @@ void CPlotter::wheelEvent(QWheelEvent * event)
     {
         m_MindB += 5*numSteps;
         m_MaxdB -= 5*numSteps;
+        m_WaterfallDirty = true;
+    }
+    else if ((event->modifiers() & Qt::ShiftModifier) &&
+             (pt.y() > m_Percent2DScreen*m_Size.height()/100))
+    {
+        // shift + wheel on the waterfall: scroll back in history
+        scrollWaterfall(numSteps * m_WaterfallImage.height() / 10);
+        return;
+    }
+    else if (event->modifiers() & Qt::ControlModifier)
+    {
+        // ctrl + wheel: zoom in and out around the demodulator
+        if (numSteps > 0)
+            SetSpanFreq(m_Span / 2);
+        else if (numSteps < 0)
+            SetSpanFreq(m_Span * 2);
+        SetFftCenterFreq(m_DemodCenterFreq - m_CenterFreq);
+        return;
     }
     else
     { // inc/dec demod frequency if right button NOT pressed
@@ -452,9 +493,12 @@ void CPlotter::resizeEvent(QResizeEvent* )
         m_OverlayPixmap.fill(Qt::black);
         m_2DPixmap = QPixmap(m_Size.width(), m_Percent2DScreen*m_Size.height()/100);
         m_2DPixmap.fill(Qt::black);
-        m_WaterfallPixmap = QPixmap(m_Size.width(), (100-m_Percent2DScreen)*m_Size.height()/100);
+        m_WaterfallImage = QImage(m_Size.width(), (100-m_Percent2DScreen)*m_Size.height()/100,
+                                  QImage::Format_RGB32);
     }
-    m_WaterfallPixmap.fill(Qt::black);
+    m_WaterfallImage.fill(qRgb(0, 0, 0));
+    m_WaterfallLine = 0;
+    m_WaterfallDirty = true;
     DrawOverlay();
 }
 
@@ -463,10 +507,31 @@ void CPlotter::resizeEvent(QResizeEvent* )
 //////////////////////////////////////////////////////////////////////
 void CPlotter::paintEvent(QPaintEvent *)
 {
+    QElapsedTimer timer;
+
+    timer.start();
+
     QPainter painter(this);
 
     painter.drawPixmap(0,0,m_2DPixmap);
-    painter.drawPixmap(0, m_Percent2DScreen*m_Size.height()/100,m_WaterfallPixmap);
+
+    // the waterfall image is a ring buffer with the newest line at
+    // m_WaterfallLine, so it is drawn in two pieces
+    int y = m_Percent2DScreen*m_Size.height()/100;
+    int w = m_WaterfallImage.width();
+    int first = m_WaterfallImage.height() - m_WaterfallLine;
+
+    painter.drawImage(QPoint(0, y), m_WaterfallImage,
+                      QRect(0, m_WaterfallLine, w, first));
+    if (m_WaterfallLine > 0)
+        painter.drawImage(QPoint(0, y + first), m_WaterfallImage,
+                          QRect(0, 0, w, m_WaterfallLine));
+    painter.end();
+
+    // only count paints caused by new data
+    if (m_PaintPending)
+        m_Stats.add(CFrameStats::PAINT, timer.nsecsElapsed() / 1000);
+    m_PaintPending = false;
     //tell interface that its ok to signal a new line of fft data
     //m_pSdrInterface->ScreenUpdateDone();
     return;
@@ -481,6 +546,8 @@ void CPlotter::draw()
     int i;
     int w;
     int h;
+    int pw;
+    QElapsedTimer timer;
 
     if (m_DrawOverlay)
     {
@@ -493,35 +560,50 @@ void CPlotter::draw()
     if (!m_Running)
         return;
 
-    // get/draw the waterfall
-    w = m_WaterfallPixmap.width();
-    h = m_WaterfallPixmap.height();
+    timer.start();
 
-    // no need to draw if pixmap is invisible
-    if ((w != 0) || (h != 0))
-    {
-        // move current data down one line(must do before attaching a QPainter object)
-        m_WaterfallPixmap.scroll(0,1,0,0, w, h);
+    // store the new spectrum in the waterfall history (if there is a waterfall)
+    if (m_Percent2DScreen < 100)
+        AddHistory();
 
-        QPainter painter1(&m_WaterfallPixmap);
-        // get scaled FFT data
-        GetScreenIntegerFFTData(255, w, m_MaxdB, m_MindB,
-                                m_FftCenter-m_Span/2, m_FftCenter+m_Span/2,
-                                m_fftbuf);
+    // reduce the FFT data to one value per pixel for both views
+    pw = qMin(m_Size.width(), MAX_SCREENSIZE);
+    if ((pw > 0) && UpdatePixelData(pw, m_FftCenter-m_Span/2, m_FftCenter+m_Span/2))
+        m_WaterfallDirty = true;    // zoomed or resized
 
-        // draw new line of fft data at top of waterfall bitmap
-        for (i = 0; i < w; i++)
+    m_Stats.add(CFrameStats::CONVERT, timer.nsecsElapsed() / 1000);
+    timer.restart();
+
+    // get/draw the waterfall
+    w = qMin(m_WaterfallImage.width(), pw);
+    h = m_WaterfallImage.height();
+
+    // no need to draw if image is invisible
+    if ((w != 0) && (h != 0))
+    {
+        if (m_WaterfallDirty)
         {
-            painter1.setPen(m_ColorTbl[ 255-m_fftbuf[i] ]);
-            painter1.drawPoint(i,0);
+            RenderWaterfall();
+        }
+        else if (m_HistOffset == 0)
+        {
+            // the new line goes above the previous one, wrapping around at the top
+            m_WaterfallLine = (m_WaterfallLine > 0) ? m_WaterfallLine - 1 : h - 1;
+
+            // write new line directly into the image
+            RenderHistoryLine(0, (QRgb *) m_WaterfallImage.scanLine(m_WaterfallLine), w);
         }
+        // else scrolled back: keep showing the same part of the history
     }
 
+    m_Stats.add(CFrameStats::WATERFALL, timer.nsecsElapsed() / 1000);
+    timer.restart();
+
     // get/draw the 2D spectrum
-    w = m_2DPixmap.width();
+    w = qMin(m_2DPixmap.width(), pw);
     h = m_2DPixmap.height();
 
-    if ((w != 0) || (h != 0))
+    if ((w != 0) && (h != 0))
     {
         // first copy into 2Dbitmap the overlay bitmap.
         m_2DPixmap = m_OverlayPixmap.copy(0,0,w,h);
@@ -529,9 +611,7 @@ void CPlotter::draw()
         QPainter painter2(&m_2DPixmap);
 
         // get new scaled fft data
-        GetScreenIntegerFFTData(h, w, m_MaxdB, m_MindB,
-                                m_FftCenter-m_Span/2, m_FftCenter+m_Span/2,
-                                m_fftbuf);
+        GetScreenIntegerFFTData(h, w, m_MaxdB, m_MindB, m_fftbuf);
 
         // draw the 2D spectrum
         painter2.setPen(QColor(0x97,0xD0,0x97,0xFF));
@@ -543,14 +623,29 @@ void CPlotter::draw()
         painter2.drawPolyline(LineBuf,w);
     }
 
+    m_Stats.add(CFrameStats::TRACE, timer.nsecsElapsed() / 1000);
+    m_Stats.drawn();
+
     // trigger a new paintEvent
+    m_PaintPending = true;
     update();
 
 }
 
 
+/*! \brief Whether the last frame has been drawn but not painted yet.
+ *
+ * A hidden or minimized plotter does not get paint events, so there is
+ * nothing to wait for and the flag is ignored until it is shown again.
+ */
+bool CPlotter::paintPending() const
+{
+    return m_PaintPending && isVisible() && !window()->isMinimized();
+}
+
+
 /*! \brief Set new FFT data. */
-void CPlotter::SetNewFttData(double *fftData, int size)
+void CPlotter::SetNewFttData(float *fftData, int size)
 {
 
     /** FIXME **/
@@ -564,113 +659,343 @@ void CPlotter::SetNewFttData(double *fftData, int size)
 }
 
 
-void CPlotter::GetScreenIntegerFFTData(qint32 MaxHeight, qint32 MaxWidth,
-                                       double MaxdB, double MindB,
-                                       qint32 StartFreq, qint32 StopFreq,
-                                       qint32* OutBuf)
+/*! \brief Update the mapping between FFT bins and screen pixels.
+ *  \param PlotWidth The number of pixels.
+ *  \param StartFreq The frequency of the first pixel.
+ *  \param StopFreq The frequency of the last pixel.
+ *
+ * Pixel x shows the bins from m_BinMap[x] up to, but not including,
+ * m_BinMap[x+1] (at least one bin). The map is only recalculated when the
+ * width, frequency range, FFT size or FFT data range has changed.
+ *
+ * \return true if the map has been recalculated.
+ */
+bool CPlotter::UpdateBinMap(qint32 PlotWidth, qint32 StartFreq, qint32 StopFreq)
 {
-    qint32 i;
-    qint32 y;
     qint32 x;
-    qint32 m;
-    qint32 ymax = 10000;
-    qint32 xprev = -1;
     qint32 maxbin;
-    //double dBmaxOffset = 0.0;//MaxdB/10.0;   FIXME
-    //double dBGainFactor = 1.0/MindB;//-1.0/(MaxdB-MindB);  FIXME
-    double dBGainFactor = ((double)MaxHeight)/abs(MaxdB-MindB);
-
-    qint32 m_PlotWidth = MaxWidth;
-    qint32 m_BinMin, m_BinMax;
-    qint32 m_FFTSize = m_fftDataSize;
-    double* m_pFFTAveBuf = m_fftData;
-    qint32* m_pTranslateTbl = new qint32[m_FFTSize];
-
-
-    maxbin = m_FFTSize - 1;
-    m_BinMin = (qint32)((double)StartFreq*(double)m_FFTSize/m_SampleFreq);
-    m_BinMin += (m_FFTSize/2);
-    m_BinMax = (qint32)((double)StopFreq*(double)m_FFTSize/m_SampleFreq);
-    m_BinMax += (m_FFTSize/2);
-
-    if (m_BinMin < 0)	//don't allow these go outside the translate table
-        m_BinMin = 0;
-    if (m_BinMin >= maxbin)
-        m_BinMin = maxbin;
-    if (m_BinMax < 0)
-        m_BinMax = 0;
-    if (m_BinMax >= maxbin)
-        m_BinMax = maxbin;
-    if ((m_BinMax-m_BinMin) > m_PlotWidth)
-    {
-        //if more FFT points than plot points
-        for (i = m_BinMin; i <= m_BinMax; i++)
-            m_pTranslateTbl[i] = ((i-m_BinMin)*m_PlotWidth) / (m_BinMax - m_BinMin);
+    qint32 BinMin, BinMax;
+
+    if ((PlotWidth == m_MapWidth) && (StartFreq == m_MapStartFreq) &&
+        (StopFreq == m_MapStopFreq) && (m_fftDataSize == m_MapFftSize) &&
+        (m_FftDataCenter == m_MapDataCenter) && (m_FftDataSpan == m_MapDataSpan) &&
+        (m_HalfSpectrum == m_MapHalfSpectrum))
+        return false;
+
+    m_MapWidth = PlotWidth;
+    m_MapStartFreq = StartFreq;
+    m_MapStopFreq = StopFreq;
+    m_MapFftSize = m_fftDataSize;
+    m_MapDataCenter = m_FftDataCenter;
+    m_MapDataSpan = m_FftDataSpan;
+    m_MapHalfSpectrum = m_HalfSpectrum;
+
+    // the FFT data may be zoomed to a part of the spectrum
+    StartFreq -= m_FftDataCenter;
+    StopFreq -= m_FftDataCenter;
+
+    maxbin = m_fftDataSize - 1;
+    if (m_HalfSpectrum)
+    {
+        // fftsize/2+1 bins from 0 Hz to fs/2
+        BinMin = (qint32)((double)StartFreq*(double)(2*maxbin)/m_FftDataSpan);
+        BinMax = (qint32)((double)StopFreq*(double)(2*maxbin)/m_FftDataSpan);
     }
     else
     {
-        //if more plot points than FFT points
-        for (i = 0; i < m_PlotWidth; i++)
-            m_pTranslateTbl[i] = m_BinMin + (i*(m_BinMax - m_BinMin)) / m_PlotWidth;
+        BinMin = (qint32)((double)StartFreq*(double)m_fftDataSize/m_FftDataSpan);
+        BinMin += (m_fftDataSize/2);
+        BinMax = (qint32)((double)StopFreq*(double)m_fftDataSize/m_FftDataSpan);
+        BinMax += (m_fftDataSize/2);
     }
 
-    m = (m_FFTSize);
-    if ((m_BinMax-m_BinMin) > m_PlotWidth)
+    if (BinMin < 0)	//don't allow these go outside the FFT data
+        BinMin = 0;
+    if (BinMin >= maxbin)
+        BinMin = maxbin;
+    if (BinMax < 0)
+        BinMax = 0;
+    if (BinMax >= maxbin)
+        BinMax = maxbin;
+
+    for (x = 0; x <= PlotWidth; x++)
+        m_BinMap[x] = BinMin + (x*(BinMax - BinMin)) / PlotWidth;
+
+    return true;
+}
+
+/*! \brief Reduce new FFT data to one value per pixel.
+ *  \param PlotWidth The number of pixels.
+ *  \param StartFreq The frequency of the first pixel.
+ *  \param StopFreq The frequency of the last pixel.
+ *
+ * Stores the strongest bin of each pixel in m_PixelDb. This is done once
+ * per frame and used by the 2D spectrum.
+ *
+ * \return true if the bin to pixel map has changed.
+ */
+bool CPlotter::UpdatePixelData(qint32 PlotWidth, qint32 StartFreq, qint32 StopFreq)
+{
+    const float *data = m_fftData;
+    qint32 x, i, first, last;
+    float max;
+    bool changed;
+
+    changed = UpdateBinMap(PlotWidth, StartFreq, StopFreq);
+
+    for (x = 0; x < PlotWidth; x++)
     {
-        //if more FFT points than plot points
-        for (i = m_BinMin; i <= m_BinMax; i++ )
-        {
-            y = (qint32)(dBGainFactor*(MaxdB-m_pFFTAveBuf[i]));
+        first = m_BinMap[x];
+        last = m_BinMap[x+1];
 
-            if (y > MaxHeight)
-                y = MaxHeight;
-            else if (y < 0)
-                y = 0;
+        max = data[first];
+        for (i = first + 1; i < last; i++)
+            max = (data[i] > max) ? data[i] : max;
 
-            x = m_pTranslateTbl[i];	//get fft bin to plot x coordinate transform
+        m_PixelDb[x] = max;
+    }
 
-            if (x == xprev)	// still mappped to same fft bin coordinate
-            {
-                if (y < ymax)		//store only the max value
-                {
-                    OutBuf[x] = y;
-                    ymax = y;
-                }
+    return changed;
+}
 
-            }
-            else
-            {
-                OutBuf[x] = y;
-                xprev = x;
-                ymax = y;
-            }
-        }
+/*! \brief Scale the pixel data to screen coordinates.
+ *  \param MaxHeight The height of the plot (y of MindB).
+ *  \param MaxWidth The number of pixels.
+ *  \param MaxdB The level shown at the top (y = 0).
+ *  \param MindB The level shown at the bottom.
+ *  \param OutBuf The y coordinate of each pixel.
+ *
+ * Uses the data prepared by UpdatePixelData().
+ */
+void CPlotter::GetScreenIntegerFFTData(qint32 MaxHeight, qint32 MaxWidth,
+                                       double MaxdB, double MindB,
+                                       qint32* OutBuf)
+{
+    const float dBGainFactor = (float)MaxHeight/qAbs(MaxdB-MindB);
+    const float top = MaxdB;
+    qint32 x, y;
+
+    for (x = 0; x < MaxWidth; x++)
+    {
+        y = (qint32)(dBGainFactor*(top-m_PixelDb[x]));
+
+        if (y > MaxHeight)
+            y = MaxHeight;
+        else if (y < 0)
+            y = 0;
+
+        OutBuf[x] = y;
     }
-    else
+}
+
+
+/*! \brief Set length of the waterfall history.
+ *  \param frames The number of FFT frames to keep.
+ *
+ * The history is limited to HIST_MAX_BYTES, i.e. fewer frames are kept
+ * with large FFT sizes. Changing the length clears the history.
+ */
+void CPlotter::setWaterfallHistory(int frames)
+{
+    if ((frames < 1) || (frames == m_HistFrames))
+        return;
+
+    m_HistFrames = frames;
+    ResetHistory();
+    m_WaterfallDirty = true;
+}
+
+/*! \brief Scroll the waterfall through the history.
+ *  \param lines The number of lines to scroll back (negative to scroll forward).
+ *
+ * New lines are not shown while the waterfall is scrolled back. Scrolling
+ * forward to the newest line resumes normal operation.
+ */
+void CPlotter::scrollWaterfall(int lines)
+{
+    m_HistOffset += lines;
+    if (m_HistOffset > m_HistCount - 1)
+        m_HistOffset = m_HistCount - 1;
+    if (m_HistOffset < 0)
+        m_HistOffset = 0;
+
+    RenderWaterfall();
+    update();
+}
+
+/*! \brief Clear the history and adapt it to the current FFT size. */
+void CPlotter::ResetHistory()
+{
+    m_HistBins = m_fftDataSize;
+    m_HistSize = 0;
+
+    if (m_HistBins > 0)
+        m_HistSize = qMin(m_HistFrames, HIST_MAX_BYTES / m_HistBins);
+
+    m_History.resize(m_HistSize * m_HistBins);
+    m_HistCenter.resize(m_HistSize);
+    m_HistSpan.resize(m_HistSize);
+    m_HistCount = 0;
+    m_HistHead = 0;
+    m_HistOffset = 0;
+}
+
+/*! \brief Quantize the new FFT data and store it in the history.
+ *
+ * The FFT data range (zoom) is stored with each frame so that zooming
+ * and panning keep the history. A change of FFT size clears it.
+ */
+void CPlotter::AddHistory()
+{
+    const float *data = m_fftData;
+    const float scale = 1.0f / HIST_DB_STEP;
+    quint8 *row;
+    float v;
+    int i;
+
+    if (m_fftDataSize != m_HistBins)
+        ResetHistory();
+
+    if (m_HistSize == 0)
+        return;
+
+    m_HistHead = (m_HistHead + 1) % m_HistSize;
+    if (m_HistCount < m_HistSize)
+        m_HistCount++;
+
+    // keep a scrolled back waterfall on the same data
+    if (m_HistOffset > 0)
+        m_HistOffset = qMin(m_HistOffset + 1, m_HistCount - 1);
+
+    m_HistCenter[m_HistHead] = m_FftDataCenter;
+    m_HistSpan[m_HistHead] = m_FftDataSpan;
+
+    row = m_History.data() + m_HistHead * m_HistBins;
+    for (i = 0; i < m_HistBins; i++)
+    {
+        v = (data[i] - HIST_DB_MIN) * scale + 0.5f;
+        v = (v < 0.0f) ? 0.0f : v;
+        v = (v > 255.0f) ? 255.0f : v;
+        row[i] = (quint8)v;
+    }
+}
+
+/*! \brief Render a waterfall line from the history.
+ *  \param age The age of the frame (0 is the newest).
+ *  \param line The line to render into.
+ *  \param width The number of pixels.
+ *
+ * Shows the strongest bin of each pixel. Frames with the current FFT data
+ * range use the bin to pixel map, frames from before a zoom or pan are
+ * mapped using their own range and pixels outside of it are black. Lines
+ * older than the history are black.
+ */
+void CPlotter::RenderHistoryLine(int age, QRgb *line, int width)
+{
+    const quint8 *row;
+    quint8 max;
+    double scale, base, step, f;
+    int x, i, last, slot;
+
+    if ((age >= m_HistCount) || (m_MapFftSize != m_HistBins))
+    {
+        for (x = 0; x < width; x++)
+            line[x] = qRgb(0, 0, 0);
+        return;
+    }
+
+    slot = (m_HistHead - age + m_HistSize) % m_HistSize;
+    row = m_History.constData() + slot * m_HistBins;
+
+    if ((m_HistCenter[slot] == m_MapDataCenter) && (m_HistSpan[slot] == m_MapDataSpan))
     {
-        //if more plot points than FFT points
-        for (x = 0; x < m_PlotWidth; x++ )
+        for (x = 0; x < width; x++)
         {
-            i = m_pTranslateTbl[x];	//get plot to fft bin coordinate transform
-            y = (qint32)(dBGainFactor*(MaxdB-m_pFFTAveBuf[i]));
+            i = m_BinMap[x];
+            last = m_BinMap[x+1];
 
-            if (y > MaxHeight)
-                y = MaxHeight;
-            else if (y < 0)
-                y = 0;
+            max = row[i];
+            for (i++; i < last; i++)
+                max = (row[i] > max) ? row[i] : max;
 
-            OutBuf[x] = y;
+            line[x] = m_HistLut[max];
         }
+        return;
+    }
+
+    // same bin numbering as UpdateBinMap() but with the range of this frame
+    if (m_HalfSpectrum)
+    {
+        scale = 2.0 * (m_HistBins - 1) / m_HistSpan[slot];
+        base = 0.0;
+    }
+    else
+    {
+        scale = m_HistBins / m_HistSpan[slot];
+        base = m_HistBins / 2;
     }
+    step = (double)(m_MapStopFreq - m_MapStartFreq) / m_MapWidth;
 
-    delete [] m_pTranslateTbl;
+    for (x = 0; x < width; x++)
+    {
+        f = m_MapStartFreq - m_HistCenter[slot] + x * step;
+        i = (int) floor(f * scale + base);
+        last = (int) floor((f + step) * scale + base);
+
+        if ((i < 0) || (i >= m_HistBins))
+        {
+            line[x] = qRgb(0, 0, 0);
+            continue;
+        }
+        last = qBound(i + 1, last, m_HistBins);
+
+        max = row[i];
+        for (i++; i < last; i++)
+            max = (row[i] > max) ? row[i] : max;
+
+        line[x] = m_HistLut[max];
+    }
 }
 
+/*! \brief Render the whole waterfall from the history.
+ *
+ * Called when the dB range, span, FFT size or plot size has changed or
+ * the waterfall is scrolled. No DSP is involved; the history contains
+ * the spectra as shown.
+ */
+void CPlotter::RenderWaterfall()
+{
+    const float gain = 255.0f / qAbs((float)(m_MaxdB - m_MindB));
+    int w = qMin(m_WaterfallImage.width(), m_MapWidth);
+    int h = m_WaterfallImage.height();
+    int q, y;
+
+    // colour of each quantized level for the current dB range
+    for (q = 0; q < 256; q++)
+    {
+        y = (int)(gain * (m_MaxdB - (HIST_DB_MIN + q * HIST_DB_STEP)));
+        if (y > 255)
+            y = 255;
+        else if (y < 0)
+            y = 0;
+        m_HistLut[q] = m_WaterfallLut[y];
+    }
+
+    m_WaterfallDirty = false;
+    m_WaterfallLine = 0;
+
+    if ((w <= 0) || (h <= 0))
+        return;
+
+    for (y = 0; y < h; y++)
+        RenderHistoryLine(m_HistOffset + y, (QRgb *) m_WaterfallImage.scanLine(y), w);
+}
 
 /*! \brief Set upper limit of dB scale. */
 void CPlotter::setMaxDB(qint32 max)
 {
     m_MaxdB = max;
+    m_WaterfallDirty = true;
 
     if (m_Running)
         m_DrawOverlay = true;
@@ -682,6 +1007,7 @@ void CPlotter::setMaxDB(qint32 max)
 void CPlotter::setMinDB(qint32 min)
 {
     m_MindB = min;
+    m_WaterfallDirty = true;
 
     if (m_Running)
         m_DrawOverlay = true;
@@ -694,6 +1020,7 @@ void CPlotter::setMinMaxDB(qint32 min, qint32 max)
 {
     m_MaxdB = max;
     m_MindB = min;
+    m_WaterfallDirty = true;
 
     if (m_Running)
         m_DrawOverlay = true;
@@ -827,7 +1154,7 @@ void CPlotter::DrawOverlay()
 void CPlotter::MakeFrequencyStrs()
 {
     qint64 FreqPerDiv = m_Span/m_HorDivs;
-    qint64 StartFreq = m_CenterFreq - m_Span/2;
+    qint64 StartFreq = m_CenterFreq + m_FftCenter - m_Span/2;
     float freq;
     int i,j;
 
@@ -865,7 +1192,7 @@ void CPlotter::MakeFrequencyStrs()
             max = j-dp;
     }
     // truncate all strings to maximum fractional length
-    StartFreq = m_CenterFreq - m_Span/2;
+    StartFreq = m_CenterFreq + m_FftCenter - m_Span/2;
     for (i = 0; i <= m_HorDivs; i++)
     {
         freq = (float)StartFreq/(float)m_FreqUnits;
@@ -879,9 +1206,9 @@ void CPlotter::MakeFrequencyStrs()
 //////////////////////////////////////////////////////////////////////
 int CPlotter::XfromFreq(qint64 freq)
 {
-    float w = m_OverlayPixmap.width();
-    float StartFreq = (float)m_CenterFreq - (float)m_Span/2.;
-    int x = (int) w * ((float)freq - StartFreq)/(float)m_Span;
+    double w = m_OverlayPixmap.width();
+    double StartFreq = (double)(m_CenterFreq + m_FftCenter) - (double)m_Span/2.;
+    int x = (int) (w * ((double)freq - StartFreq)/(double)m_Span);
     if (x < 0)
         return 0;
     if (x > (int)w)
@@ -891,9 +1218,9 @@ int CPlotter::XfromFreq(qint64 freq)
 
 qint64 CPlotter::FreqfromX(int x)
 {
-    float w = m_OverlayPixmap.width();
-    float StartFreq = (float)m_CenterFreq - (float)m_Span/2.;
-    qint64 f = (int)(StartFreq + (float)m_Span * (float)x/(float)w );
+    double w = m_OverlayPixmap.width();
+    double StartFreq = (double)(m_CenterFreq + m_FftCenter) - (double)m_Span/2.;
+    qint64 f = (qint64)(StartFreq + (double)m_Span * (double)x/w);
     return f;
 }
 
@@ -950,3 +1277,77 @@ void CPlotter::SetCenterFreq(quint64 f)
 
     DrawOverlay();
 }
+
+/*! \brief Set the sample rate.
+ *
+ * Shows the full bandwidth and expects unzoomed FFT data.
+ */
+void CPlotter::setSampleRate(double rate)
+{
+    if (rate <= 0.0)
+        return;
+
+    m_SampleFreq = rate;
+    m_Span = (qint32)rate;
+    m_FftCenter = 0;
+    SetFftDataRange(0, rate);
+    ClampFftRange();
+
+    emit NewFftRange(m_FftCenter, m_Span);
+}
+
+/*! \brief Set the shown bandwidth.
+ *
+ * Emits NewFftRange() so that the FFT can be zoomed to the shown range.
+ */
+void CPlotter::SetSpanFreq(quint32 s)
+{
+    m_Span = (qint32)s;
+    ClampFftRange();
+    DrawOverlay();
+
+    emit NewFftRange(m_FftCenter, m_Span);
+}
+
+/*! \brief Set the center of the shown bandwidth relative to the center frequency.
+ *
+ * Emits NewFftRange() so that the FFT can be zoomed to the shown range.
+ */
+void CPlotter::SetFftCenterFreq(qint64 f)
+{
+    m_FftCenter = f;
+    ClampFftRange();
+    DrawOverlay();
+
+    emit NewFftRange(m_FftCenter, m_Span);
+}
+
+/*! \brief Set the frequency range covered by the FFT data.
+ *  \param center The center of the data relative to the center frequency.
+ *  \param span The frequency range of the data, the sample rate unless zoomed.
+ *
+ * Used for zoomed FFT data, which only covers part of the sample rate.
+ * Takes effect with the next SetNewFttData().
+ */
+void CPlotter::SetFftDataRange(qint64 center, double span)
+{
+    if (span > 0.0)
+    {
+        m_FftDataCenter = center;
+        m_FftDataSpan = span;
+    }
+}
+
+/*! \brief Keep the shown bandwidth within the sample rate.
+ *
+ * The smallest span is 1/80 of the sample rate, which is the largest
+ * zoom the receiver FFT supports.
+ */
+void CPlotter::ClampFftRange()
+{
+    qint64 lo = m_HalfSpectrum ? 0 : -(qint64)m_SampleFreq/2;
+    qint64 hi = (qint64)m_SampleFreq/2;
+
+    m_Span = qBound((qint32)(m_SampleFreq/80), m_Span, (qint32)(hi - lo));
+    m_FftCenter = qBound(lo + m_Span/2, m_FftCenter, hi - m_Span/2);
+}
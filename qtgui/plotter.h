@@ -5,6 +5,8 @@
 #include <QtGui>
 #include <QFrame>
 #include <QImage>
+#include <QElapsedTimer>
+#include "qtgui/framestats.h"
 
 #define HORZ_DIVS_MAX 50 //12
 #define MAX_SCREENSIZE 4096
@@ -34,7 +36,7 @@ public:
         resizeEvent(NULL);
     }
 
-    void SetNewFttData(double *fftData, int size);
+    void SetNewFttData(float *fftData, int size);
 
     void SetCenterFreq(quint64 f);
     void SetFreqUnits(qint32 unit) { m_FreqUnits = unit; }
@@ -57,8 +59,8 @@ public:
 
     void SetDemodRanges(int FLowCmin, int FLowCmax, int FHiCmin, int FHiCmax, bool symetric);
 
-    /* Shown bandwidth around SetCenterFreq() */
-    void SetSpanFreq(quint32 s) { m_Span = (qint32)s; }
+    /* Shown bandwidth around SetCenterFreq() + SetFftCenterFreq() */
+    void SetSpanFreq(quint32 s);
     void UpdateOverlay() { DrawOverlay(); }
 
     void setMaxDB(qint32 max);
@@ -72,9 +74,23 @@ public:
     void setFreqDigits(int digits) { m_FreqDigits = digits>=0 ? digits : 0; }
 
     /* Determines full bandwidth. */
-    void setSampleRate(double rate) { if (rate > 0.0) { m_Span = rate; m_SampleFreq = rate; } }
+    void setSampleRate(double rate);
 
-    void SetFftCenterFreq(qint64 f) { m_FftCenter = f; }
+    /* Center of the shown bandwidth relative to SetCenterFreq() */
+    void SetFftCenterFreq(qint64 f);
+
+    void SetFftDataRange(qint64 center, double span);
+
+    /*! \brief FFT data only contains the bins from 0 Hz to fs/2 (real FFT). */
+    void SetHalfSpectrum(bool half) { m_HalfSpectrum = half; }
+
+    void setWaterfallHistory(int frames);
+    void scrollWaterfall(int lines);
+
+    /*! \brief Timing of the display stages. */
+    CFrameStats &frameStats() { return m_Stats; }
+
+    bool paintPending() const;
 
 signals:
     void NewCenterFreq(qint64 f);
@@ -82,6 +98,7 @@ signals:
     void NewLowCutFreq(int f);
     void NewHighCutFreq(int f);
     void NewFilterFreq(int low, int high);  /* substute for NewLow / NewHigh */
+    void NewFftRange(qint64 center, qint32 span);  /* center relative to the center frequency */
 
 public slots:
 
@@ -110,13 +127,28 @@ private:
     qint64 RoundFreq(qint64 freq, int resolution);
     bool IsPointCloseTo(int x, int xr, int delta){return ((x > (xr-delta) ) && ( x<(xr+delta)) );}
     void ClampDemodParameters();
+    bool UpdateBinMap(qint32 PlotWidth, qint32 StartFreq, qint32 StopFreq);
+    bool UpdatePixelData(qint32 PlotWidth, qint32 StartFreq, qint32 StopFreq);
+    void ClampFftRange();
+    void ResetHistory();
+    void AddHistory();
+    void RenderHistoryLine(int age, QRgb *line, int width);
+    void RenderWaterfall();
     void GetScreenIntegerFFTData(qint32 MaxHeight, qint32 MaxWidth,
                                  double MaxdB, double MindB,
-                                 qint32 StartFreq, qint32 StopFreq,
                                  qint32* OutBuf);
 
     qint32 m_fftbuf[MAX_SCREENSIZE];
-    double *m_fftData;     /*! pointer to incoming FFT data */
+    float  m_PixelDb[MAX_SCREENSIZE];      /*! Strongest FFT bin of each pixel in dB. */
+    qint32 m_BinMap[MAX_SCREENSIZE+1];     /*! First FFT bin of each pixel. */
+    qint32 m_MapWidth;                     /*! Plot width of m_BinMap. */
+    qint32 m_MapStartFreq;                 /*! Start frequency of m_BinMap. */
+    qint32 m_MapStopFreq;                  /*! Stop frequency of m_BinMap. */
+    int    m_MapFftSize;                   /*! FFT size of m_BinMap. */
+    qint64 m_MapDataCenter;                /*! FFT data center of m_BinMap. */
+    double m_MapDataSpan;                  /*! FFT data span of m_BinMap. */
+    bool   m_MapHalfSpectrum;              /*! Half spectrum mode of m_BinMap. */
+    float  *m_fftData;     /*! pointer to incoming FFT data */
     int     m_fftDataSize;
 
     int m_YAxisWidth;
@@ -124,15 +156,34 @@ private:
     eCapturetype m_CursorCaptured;
     QPixmap m_2DPixmap;
     QPixmap m_OverlayPixmap;
-    QPixmap m_WaterfallPixmap;
+    QImage m_WaterfallImage;   /*!< Waterfall ring buffer, one line per FFT. */
+    int    m_WaterfallLine;    /*!< Row of the newest line in m_WaterfallImage. */
     QColor m_ColorTbl[256];
+    QRgb   m_WaterfallLut[256];  /*!< Colour of each m_fftbuf value (0 = strongest). */
+    bool   m_WaterfallDirty;     /*!< Waterfall must be rendered again from the history. */
+
+    QVector<quint8> m_History;   /*!< Quantized spectra, m_HistBins per frame. */
+    int    m_HistFrames;         /*!< Requested history length in frames. */
+    int    m_HistSize;           /*!< Capacity of m_History in frames. */
+    int    m_HistBins;           /*!< FFT bins per frame in m_History. */
+    QVector<qint64> m_HistCenter; /*!< FFT data center of each frame in m_History. */
+    QVector<double> m_HistSpan;  /*!< FFT data span of each frame in m_History. */
+    int    m_HistCount;          /*!< Number of frames in m_History. */
+    int    m_HistHead;           /*!< Index of the newest frame in m_History. */
+    int    m_HistOffset;         /*!< Number of frames the waterfall is scrolled back. */
+    QRgb   m_HistLut[256];       /*!< Colour of each quantized level for the current dB range. */
     QSize m_Size;
     QString m_Str;
     QString m_HDivText[HORZ_DIVS_MAX+1];
     bool m_Running;
+    bool m_PaintPending;    /*!< update() called, paintEvent() not yet. */
+    CFrameStats m_Stats;    /*!< Timing of the display stages. */
     bool m_DrawOverlay;
     qint64 m_CenterFreq;
     qint64 m_FftCenter;
+    qint64 m_FftDataCenter; /*!< Center of the FFT data relative to m_CenterFreq. */
+    double m_FftDataSpan;   /*!< Frequency range covered by the FFT data. */
+    bool   m_HalfSpectrum;  /*!< FFT data is 0 to fs/2 instead of -fs/2 to fs/2. */
     qint64 m_DemodCenterFreq;
     bool m_CenterLineEnabled;  /*!< Distinguish center line. */
     bool m_FilterBoxEnabled;   /*!< Draw filter box. */
@@ -0,0 +1,293 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <string.h>
+#include <QDateTime>
+#include "qtgui/spectrumlog.h"
+
+// same quantization as the waterfall history: -150 dBFS to +9.4 dBFS
+#define LOG_DB_MIN   -150.0f
+#define LOG_DB_STEP  0.625f
+
+
+CSpectrumLogWriter::CSpectrumLogWriter()
+    : m_PeakCount(0), m_PeakCenter(0), m_PeakSpan(0.0), m_LastTime(0),
+      m_Interval(250), m_Frames(0)
+{
+    memset(&m_Header, 0, sizeof(m_Header));
+}
+
+CSpectrumLogWriter::~CSpectrumLogWriter()
+{
+    close();
+}
+
+/*! \brief Create a new spectrum log.
+ *  \param name The file name. An existing file is overwritten.
+ *  \param fft_size The number of bins of each frame.
+ *  \param sample_rate The receiver sample rate.
+ *  \return true if the file has been created.
+ */
+bool CSpectrumLogWriter::open(const QString &name, int fft_size, double sample_rate)
+{
+    close();
+
+    memset(&m_Header, 0, sizeof(m_Header));
+    memcpy(m_Header.magic, SPECTRUM_LOG_MAGIC, sizeof(m_Header.magic));
+    m_Header.version = SPECTRUM_LOG_VERSION;
+    m_Header.header_size = sizeof(spectrum_log_header);
+    m_Header.fft_size = fft_size;
+    m_Header.frame_size = sizeof(spectrum_log_frame) + fft_size;
+    m_Header.sample_rate = sample_rate;
+    m_Header.db_min = LOG_DB_MIN;
+    m_Header.db_step = LOG_DB_STEP;
+    m_Header.start_time = QDateTime::currentMSecsSinceEpoch();
+
+    // unbuffered so that a reader or a crash never sees half a frame for long
+    m_File.setFileName(name);
+    if (!m_File.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+        return false;
+
+    if (m_File.write((const char *)&m_Header, sizeof(m_Header)) != sizeof(m_Header))
+    {
+        m_File.close();
+        return false;
+    }
+
+    m_Peak.resize(fft_size);
+    m_Buf.resize(m_Header.frame_size);
+    m_PeakCount = 0;
+    m_LastTime = 0;
+    m_Frames = 0;
+
+    return true;
+}
+
+/*! \brief Write the pending frame and close the file. */
+void CSpectrumLogWriter::close()
+{
+    if (!m_File.isOpen())
+        return;
+
+    if (m_PeakCount > 0)
+        writeFrame(QDateTime::currentMSecsSinceEpoch());
+
+    m_File.close();
+}
+
+/*! \brief Size of the file in bytes. */
+qint64 CSpectrumLogWriter::bytes() const
+{
+    return m_Header.header_size + m_Frames * m_Header.frame_size;
+}
+
+/*! \brief Add a new spectrum.
+ *  \param center The center frequency of the spectrum.
+ *  \param span The frequency range covered by the spectrum.
+ *  \param data The power spectrum in dBFS.
+ *  \param size The number of bins.
+ *  \return false if the FFT size has changed or the file could not be written.
+ *
+ * The spectrum is combined with the other spectra since the last written
+ * frame. A frame is written when the interval has passed or when the
+ * frequency range changes.
+ */
+bool CSpectrumLogWriter::write(qint64 center, double span, const float *data, int size)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    float *peak = m_Peak.data();
+    int i;
+
+    if (!m_File.isOpen() || (size != (int)m_Header.fft_size))
+        return false;
+
+    // don't mix different frequency ranges in one frame
+    if ((m_PeakCount > 0) && ((center != m_PeakCenter) || (span != m_PeakSpan)))
+    {
+        if (!writeFrame(now))
+            return false;
+    }
+
+    if (m_PeakCount == 0)
+    {
+        memcpy(peak, data, size * sizeof(float));
+        m_PeakCenter = center;
+        m_PeakSpan = span;
+    }
+    else
+    {
+        for (i = 0; i < size; i++)
+            peak[i] = (data[i] > peak[i]) ? data[i] : peak[i];
+    }
+    m_PeakCount++;
+
+    if (now - m_LastTime >= m_Interval)
+        return writeFrame(now);
+
+    return true;
+}
+
+/*! \brief Quantize and write the peak spectrum. */
+bool CSpectrumLogWriter::writeFrame(qint64 time)
+{
+    spectrum_log_frame *hdr = (spectrum_log_frame *)m_Buf.data();
+    quint8 *bins = (quint8 *)m_Buf.data() + sizeof(spectrum_log_frame);
+    const float *peak = m_Peak.constData();
+    const float scale = 1.0f / m_Header.db_step;
+    const int size = m_Header.fft_size;
+    float v;
+    int i;
+
+    hdr->time = time;
+    hdr->center = m_PeakCenter;
+    hdr->span = m_PeakSpan;
+    hdr->reserved = 0;
+
+    for (i = 0; i < size; i++)
+    {
+        v = (peak[i] - m_Header.db_min) * scale + 0.5f;
+        v = (v < 0.0f) ? 0.0f : v;
+        v = (v > 255.0f) ? 255.0f : v;
+        bins[i] = (quint8)v;
+    }
+
+    m_PeakCount = 0;
+    m_LastTime = time;
+
+    if (m_File.write(m_Buf.constData(), m_Buf.size()) != m_Buf.size())
+        return false;
+
+    m_Frames++;
+
+    return true;
+}
+
+
+CSpectrumLogReader::CSpectrumLogReader()
+    : m_Map(0), m_Frames(0)
+{
+    memset(&m_Header, 0, sizeof(m_Header));
+}
+
+CSpectrumLogReader::~CSpectrumLogReader()
+{
+    close();
+}
+
+/*! \brief Open and map a spectrum log.
+ *  \param name The file name.
+ *  \param max_fft_size The largest FFT size the caller can display.
+ *  \return false if the file can not be mapped, is not a spectrum log or
+ *          has an FFT size larger than max_fft_size.
+ */
+bool CSpectrumLogReader::open(const QString &name, int max_fft_size)
+{
+    qint64 size;
+
+    close();
+
+    m_File.setFileName(name);
+    if (!m_File.open(QIODevice::ReadOnly))
+        return false;
+
+    size = m_File.size();
+    if (size < (qint64)sizeof(m_Header))
+    {
+        m_File.close();
+        return false;
+    }
+
+    m_Map = m_File.map(0, size);
+    if (!m_Map)
+    {
+        m_File.close();
+        return false;
+    }
+
+    memcpy(&m_Header, m_Map, sizeof(m_Header));
+    if (memcmp(m_Header.magic, SPECTRUM_LOG_MAGIC, sizeof(m_Header.magic)) ||
+        (m_Header.version != SPECTRUM_LOG_VERSION) ||
+        (m_Header.header_size < sizeof(m_Header)) ||
+        (m_Header.fft_size == 0) ||
+        (m_Header.fft_size > (quint32)max_fft_size) ||
+        (m_Header.frame_size != sizeof(spectrum_log_frame) + m_Header.fft_size))
+    {
+        close();
+        return false;
+    }
+
+    // ignore a partially written frame at the end
+    m_Frames = (int)((size - m_Header.header_size) / m_Header.frame_size);
+
+    return true;
+}
+
+/*! \brief Unmap and close the file. */
+void CSpectrumLogReader::close()
+{
+    if (m_Map)
+        m_File.unmap(m_Map);
+
+    m_Map = 0;
+    m_Frames = 0;
+    m_File.close();
+}
+
+/*! \brief Header of frame i, 0 <= i < frames(). */
+const spectrum_log_frame &CSpectrumLogReader::frame(int i) const
+{
+    return *(const spectrum_log_frame *)(m_Map + m_Header.header_size +
+                                         (qint64)i * m_Header.frame_size);
+}
+
+/*! \brief Find a frame by time.
+ *  \param time The time in ms since the epoch (UTC).
+ *  \return The index of the first frame at or after time, frames() if there is none.
+ */
+int CSpectrumLogReader::findFrame(qint64 time) const
+{
+    int lo = 0;
+    int hi = m_Frames;
+    int mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (frame(mid).time < time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/*! \brief Get the spectrum of frame i in dBFS.
+ *  \param i The frame index, 0 <= i < frames().
+ *  \param data Buffer for fftSize() values.
+ */
+void CSpectrumLogReader::readFrame(int i, float *data) const
+{
+    const quint8 *bins = (const quint8 *)&frame(i) + sizeof(spectrum_log_frame);
+    const int size = m_Header.fft_size;
+    int n;
+
+    for (n = 0; n < size; n++)
+        data[n] = m_Header.db_min + m_Header.db_step * bins[n];
+}
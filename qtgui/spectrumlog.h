@@ -0,0 +1,140 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2012 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef SPECTRUMLOG_H
+#define SPECTRUMLOG_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+/*! \file spectrumlog.h
+ *  \brief Binary spectrum log.
+ *
+ * A spectrum log stores power spectra instead of I/Q samples. The file
+ * starts with a spectrum_log_header followed by frames of equal size:
+ * a spectrum_log_frame and fft_size bins quantized to one byte each,
+ * the same way as the waterfall history. Since all frames have the same
+ * size, frame i is at header_size + i * frame_size, and the timestamps
+ * increase so a frame can be found by time using binary search. The file
+ * is only ever appended to; a partially written frame at the end is
+ * ignored by the reader.
+ *
+ * All values are stored in the byte order of the host, which is little
+ * endian on all supported platforms.
+ */
+
+#define SPECTRUM_LOG_MAGIC    "GQRXSPEC"
+#define SPECTRUM_LOG_VERSION  1
+
+/*! \brief Header at the beginning of a spectrum log file. */
+struct spectrum_log_header
+{
+    char     magic[8];      /*!< SPECTRUM_LOG_MAGIC without the terminating 0. */
+    quint32  version;       /*!< SPECTRUM_LOG_VERSION. */
+    quint32  header_size;   /*!< Size of this header in bytes. */
+    quint32  fft_size;      /*!< Number of bins per frame. */
+    quint32  frame_size;    /*!< Size of a frame including its header in bytes. */
+    double   sample_rate;   /*!< Sample rate of the receiver. */
+    float    db_min;        /*!< Level of quantized value 0 in dBFS. */
+    float    db_step;       /*!< Step between quantized values in dB. */
+    qint64   start_time;    /*!< Start of the recording in ms since the epoch (UTC). */
+    quint32  reserved[4];   /*!< Zero. */
+};
+
+/*! \brief Header of each frame in a spectrum log file. */
+struct spectrum_log_frame
+{
+    qint64   time;          /*!< Time of the frame in ms since the epoch (UTC). */
+    qint64   center;        /*!< Center frequency of the bins in Hz. */
+    float    span;          /*!< Frequency range covered by the bins in Hz. */
+    quint32  reserved;      /*!< Zero. */
+};
+
+
+/*! \brief Write a spectrum log.
+ *
+ * Frames are passed to write() as they arrive from the FFT. At most one
+ * frame is written per interval; the frames in between are combined into
+ * their peak so that short signals are not lost.
+ */
+class CSpectrumLogWriter
+{
+public:
+    CSpectrumLogWriter();
+    ~CSpectrumLogWriter();
+
+    bool open(const QString &name, int fft_size, double sample_rate);
+    void close();
+    bool isOpen() const { return m_File.isOpen(); }
+
+    bool write(qint64 center, double span, const float *data, int size);
+
+    void setInterval(int ms) { m_Interval = ms; }
+    qint64 frames() const { return m_Frames; }
+    qint64 bytes() const;
+
+private:
+    QFile           m_File;
+    spectrum_log_header m_Header;
+    QVector<float>  m_Peak;       /*!< Peak of the frames since the last write. */
+    int             m_PeakCount;  /*!< Number of frames in m_Peak. */
+    qint64          m_PeakCenter; /*!< Center frequency of the frames in m_Peak. */
+    double          m_PeakSpan;   /*!< Span of the frames in m_Peak. */
+    qint64          m_LastTime;   /*!< Time of the last written frame. */
+    int             m_Interval;   /*!< Minimum time between written frames in ms. */
+    qint64          m_Frames;     /*!< Number of frames written. */
+    QByteArray      m_Buf;        /*!< Frame being written. */
+
+    bool writeFrame(qint64 time);
+};
+
+
+/*! \brief Read a spectrum log using a memory mapping.
+ *
+ * The whole file is mapped so that frames can be read in any order
+ * without seeking or buffering, regardless of the size of the file.
+ */
+class CSpectrumLogReader
+{
+public:
+    CSpectrumLogReader();
+    ~CSpectrumLogReader();
+
+    bool open(const QString &name, int max_fft_size);
+    void close();
+    bool isOpen() const { return m_Map != 0; }
+
+    int    frames() const { return m_Frames; }
+    int    fftSize() const { return m_Header.fft_size; }
+    double sampleRate() const { return m_Header.sample_rate; }
+
+    const spectrum_log_frame &frame(int i) const;
+    int  findFrame(qint64 time) const;
+    void readFrame(int i, float *data) const;
+
+private:
+    QFile           m_File;
+    uchar          *m_Map;        /*!< The mapped file. */
+    spectrum_log_header m_Header;
+    int             m_Frames;     /*!< Number of complete frames. */
+};
+
+#endif // SPECTRUMLOG_H
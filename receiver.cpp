@@ -23,21 +23,36 @@
 
 #include <gr_top_block.h>
 #include <gr_audio_sink.h>
-#include <gr_complex_to_xxx.h>
 #include <gr_multiply_const_ff.h>
-#include <gr_simple_squelch_cc.h>
 
 #include "receiver.h"
 #include "dsp/rx_source_osmosdr.h"
 #include "dsp/correct_iq_cc.h"
-#include "dsp/rx_filter.h"
 #include "dsp/rx_meter.h"
 #include "dsp/rx_demod_fm.h"
+#include "dsp/rx_demod_wfm.h"
 #include "dsp/rx_demod_am.h"
 #include "dsp/rx_fft.h"
 #include "dsp/rx_agc_xx.h"
 
 
+/* Fraction of the channel rate used as passband and transition width
+   by the decimation stages. */
+#define DDC_CUTOFF  0.40
+#define DDC_TRANS   0.15
+
+/* Squelch time constant in seconds (alpha = 0.001 at 96 ksps). */
+#define SQL_TIME_CONST 0.0104
+
+/* Squelch pre-roll in seconds; lets the AGC settle on the start of the signal. */
+#define SQL_PREROLL 0.01
+
+/* Channel spacing and rate used by additional VFOs. */
+#define VFO_CHANNEL_SPACING 96000.0
+
+/* Minimum width of the channel filter in Hz. */
+#define RX_FILTER_MIN_WIDTH 100
+
 
 /*! \brief Public contructor.
  *  \param input_device Input device specifier, e.g. hw:1 for FCD source.
@@ -47,41 +62,47 @@
  * \todo Option to use UHD device instead of FCD.
  */
 receiver::receiver(const std::string input_device, const std::string audio_device)
-    : d_bandwidth(1920000.0), d_bandwidth_int(96000.0), d_audio_rate(48000),
+    : d_bandwidth(1920000.0), d_bandwidth_int(channel_rate(DEMOD_FM)), d_audio_rate(48000),
       d_rf_freq(144800000.0), d_filter_offset(0.0),
+      d_zoom_center(0.0), d_zoom_span(0.0),
       d_demod(DEMOD_FM),
       d_recording_iq(false),
       d_recording_wav(false),
       d_sniffer_active(false),
-      d_running(false)
+      d_running(false),
+      d_nb_connected(false),
+      d_next_vfo(0)
 {
     tb = gr_make_top_block("gqrx");
 
     src = make_rx_source_osmosdr(input_device);
 
-    dc_corr = make_dc_corr_cc(0.01f);
+    iq_corr = make_correct_iq_cc(d_bandwidth);
     iq_fft = make_rx_fft_c(4096, 0);
 
     /** TODO replace fixed internal bandwidth with variable one */
-    const std::vector<float> taps = gr_firdes::low_pass(1, d_bandwidth, 40000, 15000, gr_firdes::WIN_HAMMING, 6.76);
-    std::cerr << "xlating filter taps: " << taps.size() << std::endl;
-    xlate = gr_make_freq_xlating_fir_filter_ccf(d_bandwidth/d_bandwidth_int, taps, -d_filter_offset, d_bandwidth);
+    ddc = make_rx_decimator_cc(d_bandwidth, d_bandwidth_int, DDC_CUTOFF*d_bandwidth_int,
+                               DDC_TRANS*d_bandwidth_int, d_filter_offset);
+    ddc->set_band_pass(-5000.0, 5000.0, 1000.0);
 
     nb = make_rx_nb_cc(d_bandwidth, 3.3, 2.5);
-    filter = make_rx_filter(d_bandwidth_int, 0, -5000.0, 5000.0, 1000.0); // TODO combine this with xlating filter
     agc = make_rx_agc_cc(d_bandwidth_int, true, -100, 0, 2, 100, false); // TODO is this one necessary?
-    sql = gr_make_simple_squelch_cc(-150.0, 0.001);
-    meter = make_rx_meter_c(DETECTOR_TYPE_RMS);
-    demod_ssb = gr_make_complex_to_real(1);
+    sql = make_rx_squelch_cc(-150.0, 1.0 / (d_bandwidth_int * SQL_TIME_CONST),
+                             (int) (d_bandwidth_int * SQL_PREROLL));
+    meter = make_rx_meter_c(DETECTOR_TYPE_RMS, d_bandwidth_int);
+    demod_ssb = make_rx_demod_ssb(channel_rate(DEMOD_SSB), 0.0);
+    demod_cw = make_rx_demod_ssb(channel_rate(DEMOD_CW), 700.0);
 
     /** TODO replace these with regular GR blocks */
     demod_fm = make_rx_demod_fm(d_bandwidth_int, d_audio_rate, 5000.0, 75.0e-6);
+    demod_wfm = make_rx_demod_wfm(channel_rate(DEMOD_WFM), d_audio_rate, 75000.0, 50.0e-6);
     demod_am = make_rx_demod_am(d_bandwidth_int, d_bandwidth_int, true);
     audio_rr = make_resampler_ff(d_bandwidth_int, d_audio_rate);
 
     audio_fft = make_rx_fft_f(3072);
 
     audio_gain = gr_make_multiply_const_ff(0.1);
+    audio_gain_r = gr_make_multiply_const_ff(0.1);
     audio_snk = audio_make_sink(d_audio_rate, audio_device, true);
 
     /* wav sink and source is created when rec/play is started */
@@ -89,21 +110,18 @@ receiver::receiver(const std::string input_device, const std::string audio_devic
     sniffer = make_sniffer_f();
     /* sniffer_rr is created at each activation. */
 
-    tb->connect(src, 0, nb, 0);
-    tb->connect(nb, 0, dc_corr, 0);
-    tb->connect(dc_corr, 0, iq_fft, 0);
-    tb->connect(dc_corr, 0, xlate, 0);
-    tb->connect(xlate, 0, filter, 0);
-
-    tb->connect(filter, 0, meter, 0);
-    tb->connect(filter, 0, sql, 0);
+    /* noise blanker is only connected when enabled */
+    connect_input(src);
+    tb->connect(iq_corr, 0, iq_fft, 0);
+    tb->connect(iq_corr, 0, ddc, 0);
+    tb->connect(ddc, 0, meter, 0);
+    tb->connect(ddc, 0, sql, 0);
     tb->connect(sql, 0, agc, 0);
     tb->connect(agc, 0, demod_fm, 0);
-    tb->connect(demod_fm, 0, audio_rr, 0);
-    tb->connect(audio_rr, 0, audio_fft, 0);
-    tb->connect(audio_rr, 0, audio_gain, 0);
+    connect_audio(d_demod);
 
     tb->connect(audio_gain, 0, audio_snk, 0);
+    tb->connect(audio_gain_r, 0, audio_snk, 1);
 }
 
 
@@ -158,9 +176,11 @@ void receiver::set_output_device(const std::string device)
     tb->lock();
 
     tb->disconnect(audio_gain, 0, audio_snk, 0);
+    tb->disconnect(audio_gain_r, 0, audio_snk, 1);
     audio_snk.reset();
     audio_snk = audio_make_sink(d_audio_rate, device, true);
     tb->connect(audio_gain, 0, audio_snk, 0);
+    tb->connect(audio_gain_r, 0, audio_snk, 1);
 
     tb->unlock();
 }
@@ -196,14 +216,36 @@ double receiver::get_rf_freq()
 /*! \brief Set RF sample rate.
  *  \param d_sample_rate The desired sample rate in Hz.
  *  \return RX_STATUS_ERROR if an error occurs.
+ *
+ * The decimation chain is re-planned for the new sample rate, and the
+ * additional VFOs are rebuilt for it. VFOs that no longer fit within the
+ * new bandwidth are removed.
  */
 receiver::status receiver::set_rf_sample_rate(double d_sample_rate)
 {
     src->set_sample_rate(d_sample_rate);
-    if (src->get_sample_rate() == d_sample_rate)
-        return STATUS_OK;
-    else
+    if (src->get_sample_rate() != d_sample_rate)
         return STATUS_ERROR;
+
+    if (d_sample_rate != d_bandwidth)
+    {
+        d_bandwidth = d_sample_rate;
+        nb->set_sample_rate(d_bandwidth);
+        iq_corr->set_sample_rate(d_bandwidth);
+        ddc->set_rates(d_bandwidth, d_bandwidth_int);
+        update_iq_fft_zoom();
+        rebuild_vfos();
+    }
+
+    return STATUS_OK;
+}
+
+/*! \brief Get the input sample rate.
+ *  \sa set_rf_sample_rate()
+ */
+double receiver::get_rf_sample_rate()
+{
+    return d_bandwidth;
 }
 
 
@@ -246,8 +288,7 @@ receiver::status receiver::set_rf_gain_mode(int gain_mode)
 receiver::status receiver::set_filter_offset(double offset_hz)
 {
     d_filter_offset = offset_hz;
-    //filter->set_offset(d_filter_offset);
-    xlate->set_center_freq(-d_filter_offset);
+    ddc->set_offset(d_filter_offset);
     return STATUS_OK;
 }
 
@@ -263,31 +304,37 @@ double receiver::get_filter_offset()
 
 receiver::status receiver::set_filter(double low, double high, filter_shape shape)
 {
-    double trans_width;
-
     if ((low >= high) || (abs(high-low) < RX_FILTER_MIN_WIDTH))
         return STATUS_ERROR;
 
+    /* complex taps use mirrored band edges, i.e. -high to -low */
+    ddc->set_band_pass(-high, -low, filter_trans_width(low, high, shape));
+
+    return STATUS_OK;
+}
+
+
+/*! \brief Calculate filter transition width.
+ *  \param low The lower filter edge.
+ *  \param high The upper filter edge.
+ *  \param shape The filter shape.
+ *  \return The transition width in Hz.
+ */
+double receiver::filter_trans_width(double low, double high, filter_shape shape)
+{
     switch (shape) {
 
     case FILTER_SHAPE_SOFT:
-        trans_width = abs(high-low)*0.2;
-        break;
+        return abs(high-low)*0.2;
 
     case FILTER_SHAPE_SHARP:
-        trans_width = abs(high-low)*0.01;
-        break;
+        return abs(high-low)*0.01;
 
     case FILTER_SHAPE_NORMAL:
     default:
-        trans_width = abs(high-low)*0.1;
-        break;
+        return abs(high-low)*0.1;
 
     }
-
-    filter->set_param(low, high, trans_width);
-
-    return STATUS_OK;
 }
 
 
@@ -317,20 +364,72 @@ receiver::status receiver::set_freq_corr(int ppm)
 }
 
 
+/*! \brief Set DC offset correction manually.
+ *  \param dci DC offset of the I channel.
+ *  \param dcq DC offset of the Q channel.
+ *
+ * This disables automatic DC offset estimation.
+ * \sa set_iq_corr_auto()
+ */
 receiver::status receiver::set_dc_corr(double dci, double dcq)
 {
-    /** DELETEME */
+    iq_corr->set_dc_offset(dci, dcq);
 
     return STATUS_OK;
 }
 
+/*! \brief Set I/Q imbalance correction manually.
+ *  \param gain Relative gain error of the Q channel (0.0 means balanced).
+ *  \param phase Phase error in radians.
+ *
+ * This disables automatic I/Q imbalance estimation.
+ * \sa set_iq_corr_auto()
+ */
 receiver::status receiver::set_iq_corr(double gain, double phase)
 {
-    /** DELETEME */
+    iq_corr->set_iq_imbalance(1.0 + gain, phase);
+
+    return STATUS_OK;
+}
+
+/*! \brief Enable or disable automatic DC and I/Q imbalance estimation.
+ *  \param dc_auto Whether the DC offset should be estimated automatically.
+ *  \param iq_auto Whether the I/Q imbalance should be estimated automatically.
+ */
+receiver::status receiver::set_iq_corr_auto(bool dc_auto, bool iq_auto)
+{
+    iq_corr->set_dc_auto(dc_auto);
+    iq_corr->set_iq_auto(iq_auto);
 
     return STATUS_OK;
 }
 
+/*! \brief Get current DC offset correction.
+ *  \param dci DC offset of the I channel (output).
+ *  \param dcq DC offset of the Q channel (output).
+ */
+void receiver::get_dc_corr(double &dci, double &dcq)
+{
+    float i, q;
+
+    iq_corr->get_dc_offset(i, q);
+    dci = i;
+    dcq = q;
+}
+
+/*! \brief Get current I/Q imbalance correction.
+ *  \param gain Relative gain error of the Q channel (output).
+ *  \param phase Phase error in radians (output).
+ */
+void receiver::get_iq_corr(double &gain, double &phase)
+{
+    float g, p;
+
+    iq_corr->get_iq_imbalance(g, p);
+    gain = g - 1.0;
+    phase = p;
+}
+
 
 /*! \brief Get current signal power.
  *  \param dbfs Whether to use dbfs or absolute power.
@@ -347,14 +446,119 @@ float receiver::get_signal_pwr(bool dbfs)
         return meter->get_level();
 }
 
-/*! \brief Get latest baseband FFT data. */
-void receiver::get_iq_fft_data(std::complex<float>* fftPoints, int &fftsize)
+/*! \brief Get peak, average, RMS and minimum signal level in dBFS.
+ *
+ * The levels are measured over the last complete window, see
+ * set_signal_window().
+ */
+rx_meter_level receiver::get_signal_levels()
+{
+    return meter->get_levels();
+}
+
+/*! \brief Get the signal levels of the windows completed since the last call.
+ *  \sa rx_meter_c::get_history()
+ */
+unsigned int receiver::get_signal_history(rx_meter_level *levels, unsigned int max_num,
+                                          unsigned int &pos)
+{
+    return meter->get_history(levels, max_num, pos);
+}
+
+/*! \brief Set the integration time of the signal meter.
+ *  \param seconds The window length in seconds.
+ */
+void receiver::set_signal_window(double seconds)
+{
+    meter->set_window(seconds);
+}
+
+/*! \brief Get latest baseband FFT data.
+ *  \param fftPoints Buffer for the power spectrum in dBFS, center in the middle.
+ *  \param fftsize The number of points (output), 0 if there is no new data.
+ *  \param center The center of the spectrum relative to the RF frequency (output).
+ *  \param span The frequency range covered by the spectrum (output).
+ *
+ * The center and span describe the data actually returned, which may lag
+ * behind set_iq_fft_zoom() by a frame.
+ */
+void receiver::get_iq_fft_data(float* fftPoints, int &fftsize, double &center, double &span)
+{
+    float zoom_freq;
+    int zoom_decim;
+
+    iq_fft->get_fft_data(fftPoints, fftsize, zoom_freq, zoom_decim);
+    if (fftsize) {
+        center = zoom_freq * d_bandwidth;
+        span = d_bandwidth / zoom_decim;
+    }
+}
+
+/*! \brief Set averaging mode of the baseband FFT.
+ *  \param mode The averaging mode (see rx_fft_avg).
+ *
+ * In the averaging modes all samples are used in FFTs overlapping by 50%.
+ */
+void receiver::set_iq_fft_averaging(int mode)
+{
+    iq_fft->set_averaging(mode);
+}
+
+/*! \brief Set size of the baseband FFT.
+ *  \param fftsize The new FFT size (at most MAX_FFT_SIZE).
+ *
+ * The FFT object is taken from rx_fft_cache so this is quick if the size
+ * has been prepared.
+ */
+void receiver::set_iq_fft_size(int fftsize)
+{
+    iq_fft->set_fft_size(fftsize);
+}
+
+/*! \brief Get size of the baseband FFT. */
+int receiver::get_iq_fft_size()
+{
+    return iq_fft->get_fft_size();
+}
+
+/*! \brief Zoom the baseband FFT to a part of the spectrum.
+ *  \param center The center of the displayed range relative to the RF frequency.
+ *  \param span The width of the displayed range, 0 or the sample rate for no zoom.
+ *
+ * The selected range is shifted to 0 Hz and decimated before the FFT, so
+ * that the FFT resolution follows the displayed span. The decimation is
+ * chosen so that the decimated spectrum covers at least 1.25 times the
+ * span, leaving the filter transition bands outside the display.
+ */
+void receiver::set_iq_fft_zoom(double center, double span)
+{
+    d_zoom_center = center;
+    d_zoom_span = span;
+    update_iq_fft_zoom();
+}
+
+/*! \brief Apply the FFT zoom for the current sample rate. */
+void receiver::update_iq_fft_zoom()
 {
-    iq_fft->get_fft_data(fftPoints, fftsize);
+    int decim = 1;
+
+    if (d_zoom_span > 0.0)
+        decim = (int) floor(d_bandwidth / (1.25 * d_zoom_span));
+
+    if (decim > MAX_ZOOM_DECIM)
+        decim = MAX_ZOOM_DECIM;
+
+    if (decim > 1)
+        iq_fft->set_zoom(d_zoom_center / d_bandwidth, decim);
+    else
+        iq_fft->set_zoom(0.0, 1);
 }
 
-/*! \brief Get latest audio FFT data. */
-void receiver::get_audio_fft_data(std::complex<float>* fftPoints, int &fftsize)
+/*! \brief Get latest audio FFT data.
+ *  \param fftPoints Buffer for the power spectrum in dBFS from 0 Hz to fs/2.
+ *  \param fftsize The number of points (output), 0 if there is no new data.
+ */
+void receiver::get_audio_fft_data(float* fftPoints, int &fftsize)
 {
     audio_fft->get_fft_data(fftPoints, fftsize);
 }
@@ -366,6 +570,8 @@ receiver::status receiver::set_nb_on(int nbid, bool on)
     else if (nbid == 2)
         nb->set_nb2_on(on);
 
+    update_nb();
+
     return STATUS_OK; // FIXME
 }
 
@@ -380,6 +586,147 @@ receiver::status receiver::set_nb_threshold(int nbid, float threshold)
 }
 
 
+/*! \brief Connect I/Q source to the receiver input.
+ *  \param blk The source block (hardware or file source).
+ *
+ * The source is connected to the noise blanker if it is in use, otherwise
+ * directly to the I/Q corrector.
+ */
+void receiver::connect_input(gr_basic_block_sptr blk)
+{
+    if (d_nb_connected)
+    {
+        tb->connect(blk, 0, nb, 0);
+        tb->connect(nb, 0, iq_corr, 0);
+    }
+    else
+    {
+        tb->connect(blk, 0, iq_corr, 0);
+    }
+}
+
+
+/*! \brief Disconnect I/Q source from the receiver input.
+ *  \sa connect_input()
+ */
+void receiver::disconnect_input(gr_basic_block_sptr blk)
+{
+    if (d_nb_connected)
+    {
+        tb->disconnect(blk, 0, nb, 0);
+        tb->disconnect(nb, 0, iq_corr, 0);
+    }
+    else
+    {
+        tb->disconnect(blk, 0, iq_corr, 0);
+    }
+}
+
+
+/*! \brief Get the block delivering audio at the audio rate.
+ *  \param rx_demod The demodulator.
+ *
+ * The FM demodulators resample to the audio rate themselves, the other
+ * demodulators are followed by audio_rr.
+ */
+gr_basic_block_sptr receiver::audio_output(demod rx_demod)
+{
+    switch (rx_demod) {
+
+    case DEMOD_NONE:
+    case DEMOD_SSB:
+    case DEMOD_CW:
+    case DEMOD_AM:
+        return audio_rr;
+
+    case DEMOD_WFM:
+        return demod_wfm;
+
+    case DEMOD_FM:
+    default:
+        return demod_fm;
+    }
+}
+
+
+/*! \brief Connect the audio output of a demodulator to the audio blocks.
+ *  \param rx_demod The demodulator, see audio_output().
+ *
+ * The audio sink is always stereo. Only the WFM demodulator has a right
+ * channel, for the others the same audio goes to both channels. The FFT
+ * and the sniffer get the left channel. During audio playback the output
+ * is terminated in the null sink.
+ */
+void receiver::connect_audio(demod rx_demod)
+{
+    gr_basic_block_sptr blk = audio_output(rx_demod);
+
+    if (wav_src)
+    {
+        tb->connect(blk, 0, audio_null_sink, 0);
+    }
+    else
+    {
+        tb->connect(blk, 0, audio_fft, 0);
+        tb->connect(blk, 0, audio_gain, 0);
+        tb->connect(blk, rx_demod == DEMOD_WFM ? 1 : 0, audio_gain_r, 0);
+    }
+
+    if (d_sniffer_active)
+        tb->connect(blk, 0, sniffer_rr, 0);
+}
+
+
+/*! \brief Disconnect the audio output of a demodulator from the audio blocks.
+ *  \sa connect_audio()
+ */
+void receiver::disconnect_audio(demod rx_demod)
+{
+    gr_basic_block_sptr blk = audio_output(rx_demod);
+
+    if (wav_src)
+    {
+        tb->disconnect(blk, 0, audio_null_sink, 0);
+    }
+    else
+    {
+        tb->disconnect(blk, 0, audio_fft, 0);
+        tb->disconnect(blk, 0, audio_gain, 0);
+        tb->disconnect(blk, rx_demod == DEMOD_WFM ? 1 : 0, audio_gain_r, 0);
+    }
+
+    if (d_sniffer_active)
+        tb->disconnect(blk, 0, sniffer_rr, 0);
+}
+
+
+/*! \brief Put noise blanker in or take it out of the flow graph.
+ *
+ * The noise blanker runs at the full input rate, so when both blankers
+ * are disabled it is removed from the flow graph.
+ */
+void receiver::update_nb()
+{
+    bool nb_on = nb->get_nb1_on() || nb->get_nb2_on();
+    gr_basic_block_sptr input;
+
+    if (nb_on == d_nb_connected)
+        return;
+
+    /* I/Q file source replaces the hardware source during playback */
+    if (iq_src)
+        input = iq_src;
+    else
+        input = src;
+
+    tb->lock();
+    disconnect_input(input);
+    d_nb_connected = nb_on;
+    connect_input(input);
+    tb->unlock();
+}
+
+
 /*! \brief Set squelch level.
  *  \param level_db The new level in dBFS.
  */
@@ -468,6 +815,11 @@ receiver::status receiver::set_demod(demod rx_demod)
         tb->disconnect(demod_ssb, 0, audio_rr, 0);
         break;
 
+    case DEMOD_CW:
+        tb->disconnect(agc, 0, demod_cw, 0);
+        tb->disconnect(demod_cw, 0, audio_rr, 0);
+        break;
+
     case DEMOD_AM:
         tb->disconnect(agc, 0, demod_am, 0);
         tb->disconnect(demod_am, 0, audio_rr, 0);
@@ -475,11 +827,20 @@ receiver::status receiver::set_demod(demod rx_demod)
 
     case DEMOD_FM:
         tb->disconnect(agc, 0, demod_fm, 0);
-        tb->disconnect(demod_fm, 0, audio_rr, 0);
+        break;
+
+    case DEMOD_WFM:
+        tb->disconnect(agc, 0, demod_wfm, 0);
+        break;
+
+    default:
         break;
 
     }
 
+    /* reconfigure channel for the new demodulator */
+    set_channel_rate(channel_rate(rx_demod));
+
 
     switch (rx_demod) {
 
@@ -490,6 +851,12 @@ receiver::status receiver::set_demod(demod rx_demod)
         tb->connect(demod_ssb, 0, audio_rr, 0);
         break;
 
+    case DEMOD_CW:
+        d_demod = rx_demod;
+        tb->connect(agc, 0, demod_cw, 0);
+        tb->connect(demod_cw, 0, audio_rr, 0);
+        break;
+
     case DEMOD_AM:
         d_demod = rx_demod;
         tb->connect(agc, 0, demod_am, 0);
@@ -497,19 +864,28 @@ receiver::status receiver::set_demod(demod rx_demod)
         break;
 
     case DEMOD_FM:
-        d_demod = DEMOD_FM;
+        d_demod = rx_demod;
         tb->connect(agc, 0, demod_fm, 0);
-        tb->connect(demod_fm, 0, audio_rr, 0);
+        break;
+
+    case DEMOD_WFM:
+        d_demod = rx_demod;
+        tb->connect(agc, 0, demod_wfm, 0);
         break;
 
     default:
         /* use FMN */
         d_demod = DEMOD_FM;
         tb->connect(agc, 0, demod_fm, 0);
-        tb->connect(demod_fm, 0, audio_rr, 0);
         break;
     }
 
+    /* FM and WFM deliver audio at the audio rate, the others through audio_rr */
+    if (audio_output(d_demod) != audio_output(current_demod)) {
+        disconnect_audio(current_demod);
+        connect_audio(d_demod);
+    }
+
     /* continue processing */
     tb->unlock();
 
@@ -517,12 +893,68 @@ receiver::status receiver::set_demod(demod rx_demod)
 }
 
 
+/*! \brief Get channel rate for a demodulator.
+ *  \param rx_demod The demodulator.
+ *  \return The channel rate in Hz.
+ *
+ * The rates are integer fractions of the audio rate or multiples thereof
+ * so that audio_rr and demod_fm can use small interpolation and
+ * decimation factors.
+ */
+double receiver::channel_rate(demod rx_demod)
+{
+    switch (rx_demod) {
+
+    case DEMOD_NONE:
+    case DEMOD_SSB:
+        return 12000.0;
+
+    case DEMOD_CW:
+        return 6000.0;
+
+    case DEMOD_WFM:
+        return 240000.0;
+
+    case DEMOD_AM:
+    case DEMOD_FM:
+    default:
+        return 48000.0;
+    }
+}
+
+
+/*! \brief Set new channel rate.
+ *  \param rate The new channel rate in Hz.
+ *
+ * Reconfigures the decimator and all rate dependent blocks between the
+ * decimator and the audio resampler. The relative rate of the FM
+ * demodulator and the audio resampler changes, so the caller must hold
+ * the flow graph lock.
+ */
+void receiver::set_channel_rate(double rate)
+{
+    if (rate == d_bandwidth_int)
+        return;
+
+    d_bandwidth_int = rate;
+
+    ddc->set_params(d_bandwidth, d_bandwidth_int, DDC_CUTOFF*d_bandwidth_int, DDC_TRANS*d_bandwidth_int);
+    agc->set_sample_rate(d_bandwidth_int);
+    meter->set_sample_rate(d_bandwidth_int);
+    sql->set_alpha(1.0 / (d_bandwidth_int * SQL_TIME_CONST));
+    sql->set_preroll((int) (d_bandwidth_int * SQL_PREROLL));
+    demod_fm->set_quad_rate(d_bandwidth_int);
+    audio_rr->set_rates((unsigned int) d_bandwidth_int, d_audio_rate);
+}
+
+
 /*! \brief Set maximum deviation of the FM demodulator.
  *  \param maxdev_hz The new maximum deviation in Hz.
  */
 receiver::status receiver::set_fm_maxdev(float maxdev_hz)
 {
     demod_fm->set_max_dev(maxdev_hz);
+    demod_wfm->set_max_dev(maxdev_hz);
 
     return STATUS_OK;
 }
@@ -531,11 +963,30 @@ receiver::status receiver::set_fm_maxdev(float maxdev_hz)
 receiver::status receiver::set_fm_deemph(double tau)
 {
     demod_fm->set_tau(tau);
+    demod_wfm->set_tau(tau);
 
     return STATUS_OK;
 }
 
 
+/*! \brief Enable or disable stereo decoding of broadcast FM.
+ *  \param enabled Whether to decode stereo when a pilot is received.
+ */
+receiver::status receiver::set_wfm_stereo(bool enabled)
+{
+    demod_wfm->set_stereo(enabled);
+
+    return STATUS_OK;
+}
+
+
+/*! \brief Get the stereo and RDS status of the WFM demodulator. */
+rx_wfm_status receiver::get_wfm_status()
+{
+    return demod_wfm->get_status();
+}
+
+
 /*! \brief Set AM DCR status.
  *  \param enabled Flag indicating whether DCR should be enabled or disabled.
  */
@@ -547,6 +998,40 @@ receiver::status receiver::set_am_dcr(bool enabled)
 }
 
 
+/*! \brief Select sideband for SSB and CW.
+ *  \param sideband The sideband, see rx_demod_ssb::sideband.
+ */
+receiver::status receiver::set_sideband(int sideband)
+{
+    demod_ssb->set_sideband(sideband);
+    demod_cw->set_sideband(sideband);
+
+    return STATUS_OK;
+}
+
+
+/*! \brief Set the CW pitch.
+ *  \param pitch_hz The audio frequency of a carrier at the receiver frequency.
+ */
+receiver::status receiver::set_cw_pitch(float pitch_hz)
+{
+    demod_cw->set_bfo(pitch_hz);
+
+    return STATUS_OK;
+}
+
+
+/*! \brief Select the AM detector.
+ *  \param detector Envelope or synchronous detector, see rx_demod_am::mode.
+ */
+receiver::status receiver::set_am_detector(int detector)
+{
+    demod_am->set_mode(detector);
+
+    return STATUS_OK;
+}
+
+
 receiver::status receiver::set_af_gain(float gain_db)
 {
     float k;
@@ -555,6 +1040,7 @@ receiver::status receiver::set_af_gain(float gain_db)
     k = pow(10.0, gain_db / 20.0);
     //std::cout << "G:" << gain_db << "dB / K:" << k << std::endl;
     audio_gain->set_k(k);
+    audio_gain_r->set_k(k);
 
     return STATUS_OK;
 }
@@ -587,8 +1073,9 @@ receiver::status receiver::start_audio_recording(const std::string filename)
 
     // not strictly necessary to lock but I think it is safer
     tb->lock();
-    wav_sink = gr_make_wavfile_sink(filename.c_str(), 1, 48000, 16);
+    wav_sink = gr_make_wavfile_sink(filename.c_str(), 2, 48000, 16);
     tb->connect(audio_gain, 0, wav_sink, 0);
+    tb->connect(audio_gain_r, 0, wav_sink, 1);
     tb->unlock();
     d_recording_wav = true;
 
@@ -619,6 +1106,7 @@ receiver::status receiver::stop_audio_recording()
     tb->lock();
     wav_sink->close();
     tb->disconnect(audio_gain, 0, wav_sink, 0);
+    tb->disconnect(audio_gain_r, 0, wav_sink, 1);
     wav_sink.reset();
     tb->unlock();
     d_recording_wav = false;
@@ -632,8 +1120,10 @@ receiver::status receiver::stop_audio_recording()
 /*! \brief Start audio playback. */
 receiver::status receiver::start_audio_playback(const std::string filename)
 {
+    gr_wavfile_source_sptr src;
+
     try {
-        wav_src = gr_make_wavfile_source(filename.c_str(), false);
+        src = gr_make_wavfile_source(filename.c_str(), false);
     }
     catch (std::runtime_error &e) {
         std::cout << "Error loading " << filename << ": " << e.what() << std::endl;
@@ -641,19 +1131,19 @@ receiver::status receiver::start_audio_playback(const std::string filename)
     }
 
     /** FIXME: We can only handle 48k for now (should maybe use the audio_rr)? */
-    if (wav_src->sample_rate() != 48000) {
-        std::cout << "BUG: Can not handle sample rate " << wav_src->sample_rate() << std::cout;
-        wav_src.reset();
+    if (src->sample_rate() != 48000) {
+        std::cout << "BUG: Can not handle sample rate " << src->sample_rate() << std::cout;
 
         return STATUS_ERROR;
     }
 
     stop();
     /* route demodulator output to null sink */
-    tb->disconnect(audio_rr, 0, audio_gain, 0);
-    tb->disconnect(audio_rr, 0, audio_fft, 0);
-    tb->connect(audio_rr, 0, audio_null_sink, 0);
+    disconnect_audio(d_demod);
+    wav_src = src;
+    connect_audio(d_demod);
     tb->connect(wav_src, 0, audio_gain, 0);
+    tb->connect(wav_src, wav_src->channels() > 1 ? 1 : 0, audio_gain_r, 0);
     tb->connect(wav_src, 0, audio_fft, 0);
     start();
 
@@ -667,14 +1157,14 @@ receiver::status receiver::stop_audio_playback()
     /* disconnect wav source and reconnect receiver */
     stop();
     tb->disconnect(wav_src, 0, audio_gain, 0);
+    tb->disconnect(wav_src, wav_src->channels() > 1 ? 1 : 0, audio_gain_r, 0);
     tb->disconnect(wav_src, 0, audio_fft, 0);
-    tb->disconnect(audio_rr, 0, audio_null_sink, 0);
-    tb->connect(audio_rr, 0, audio_gain, 0);
-    tb->connect(audio_rr, 0, audio_fft, 0);
-    start();
+    disconnect_audio(d_demod);
 
     /* delete wav_src since we can not change file name */
     wav_src.reset();
+    connect_audio(d_demod);
+    start();
 
     return STATUS_OK;
 }
@@ -744,11 +1234,11 @@ receiver::status receiver::start_iq_playback(const std::string filename, float s
     tb->lock();
 
     /* disconenct hardware source */
-    tb->disconnect(src, 0, nb, 0);
+    disconnect_input(src);
     tb->disconnect(src, 0, iq_sink, 0);
 
     /* connect I/Q source via throttle block */
-    tb->connect(iq_src, 0, nb, 0);
+    connect_input(iq_src);
     tb->connect(iq_src, 0, iq_sink, 0);
     tb->unlock();
 
@@ -769,11 +1259,11 @@ receiver::status receiver::stop_iq_playback()
     tb->lock();
 
     /* disconnect I/Q source and throttle block */
-    tb->disconnect(iq_src, 0, nb, 0);
+    disconnect_input(iq_src);
     tb->disconnect(iq_src, 0, iq_sink, 0);
 
     /* reconenct hardware source */
-    tb->connect(src, 0, nb, 0);
+    connect_input(src);
     tb->connect(src, 0, iq_sink, 0);
 
     tb->unlock();
@@ -800,7 +1290,7 @@ receiver::status receiver::start_sniffer(unsigned int samprate, int buffsize)
     sniffer->set_buffer_size(buffsize);
     sniffer_rr = make_resampler_ff(d_audio_rate, samprate);
     tb->lock();
-    tb->connect(audio_rr, 0, sniffer_rr, 0);
+    tb->connect(audio_output(d_demod), 0, sniffer_rr, 0);
     tb->connect(sniffer_rr, 0, sniffer, 0);
     tb->unlock();
     d_sniffer_active = true;
@@ -818,7 +1308,7 @@ receiver::status receiver::stop_sniffer()
     }
 
     tb->lock();
-    tb->disconnect(audio_rr, 0, sniffer_rr, 0);
+    tb->disconnect(audio_output(d_demod), 0, sniffer_rr, 0);
     tb->disconnect(sniffer_rr, 0, sniffer, 0);
     tb->unlock();
     d_sniffer_active = false;
@@ -834,3 +1324,353 @@ void receiver::get_sniffer_data(float * outbuff, int &num)
 {
     sniffer->get_samples(outbuff, num);
 }
+
+
+/*! \brief Map a receiver demodulator to the demodulator of an rx_vfo.
+ *
+ * VFOs have no raw I/Q and no wideband FM mode; these fall back to SSB
+ * and narrow band FM, respectively.
+ */
+static rx_vfo::demod_type vfo_demod(receiver::demod rx_demod)
+{
+    switch (rx_demod) {
+
+    case receiver::DEMOD_AM:
+        return rx_vfo::DEMOD_AM;
+
+    case receiver::DEMOD_FM:
+    case receiver::DEMOD_WFM:
+        return rx_vfo::DEMOD_FM;
+
+    case receiver::DEMOD_CW:
+        return rx_vfo::DEMOD_CW;
+
+    case receiver::DEMOD_NONE:
+    case receiver::DEMOD_SSB:
+    default:
+        return rx_vfo::DEMOD_SSB;
+    }
+}
+
+
+/*! \brief Add a new VFO.
+ *  \param offset_hz The frequency offset of the VFO from the RF center frequency.
+ *  \param rx_demod The demodulator to use.
+ *  \param audio_device The audio output device of the new VFO.
+ *  \return The ID of the new VFO or -1 if the VFO could not be created.
+ *
+ * Additional VFOs are received through a polyphase channelizer that splits the
+ * full input bandwidth into channels of approximately VFO_CHANNEL_SPACING. Each
+ * VFO selects the channel closest to its offset and does the final tuning at the
+ * channel rate, so the cost of each VFO is independent of the input sample rate.
+ *
+ * The channelizer is only part of the flow graph while there are VFOs.
+ */
+int receiver::add_vfo(double offset_hz, demod rx_demod, const std::string audio_device)
+{
+    vfo_channel vc;
+    int id;
+
+    if ((rx_demod < DEMOD_NONE) || (rx_demod >= DEMOD_NUM))
+        return -1;
+
+    if (fabs(offset_hz) > d_bandwidth / 2.0)
+        return -1;
+
+    /* same defaults as rx_vfo */
+    vc.offset = offset_hz;
+    vc.rx_demod = rx_demod;
+    vc.low = -5000.0;
+    vc.high = 5000.0;
+    vc.shape = FILTER_SHAPE_NORMAL;
+    vc.sql_level = -150.0;
+    vc.af_gain = -20.0;
+    vc.snk = audio_make_sink(d_audio_rate, audio_device, true);
+
+    tb->lock();
+
+    if (!chan)
+        connect_channelizer();
+
+    if (!connect_vfo(vc))
+    {
+        if (d_vfos.empty())
+            disconnect_channelizer();
+        tb->unlock();
+        return -1;
+    }
+
+    id = d_next_vfo++;
+    d_vfos[id] = vc;
+
+    tb->unlock();
+
+    return id;
+}
+
+
+/*! \brief Remove a VFO.
+ *  \param vfo_id The ID of the VFO as returned by add_vfo().
+ */
+receiver::status receiver::remove_vfo(int vfo_id)
+{
+    std::map<int, vfo_channel>::iterator it = d_vfos.find(vfo_id);
+
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    tb->lock();
+    tb->disconnect(chan, it->second.chan, it->second.vfo, 0);
+    tb->disconnect(it->second.vfo, 0, it->second.snk, 0);
+
+    d_vfos.erase(it);
+
+    if (d_vfos.empty())
+        disconnect_channelizer();
+    tb->unlock();
+
+    return STATUS_OK;
+}
+
+
+/*! \brief Set VFO offset.
+ *  \param vfo_id The ID of the VFO.
+ *  \param offset_hz The new frequency offset from the RF center frequency.
+ *
+ * If the new offset is within the current channel only the fine tuning of
+ * the VFO is changed, otherwise the VFO is moved to the new channel.
+ */
+receiver::status receiver::set_vfo_offset(int vfo_id, double offset_hz)
+{
+    std::map<int, vfo_channel>::iterator it = d_vfos.find(vfo_id);
+    double residual;
+    int ch;
+
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    ch = chan->channel_index(offset_hz, residual);
+    if (ch < 0)
+        return STATUS_ERROR;
+
+    it->second.offset = offset_hz;
+
+    if (ch == it->second.chan)
+    {
+        it->second.vfo->set_offset(residual);
+    }
+    else
+    {
+        tb->lock();
+        tb->disconnect(chan, it->second.chan, it->second.vfo, 0);
+        it->second.vfo->set_offset(residual);
+        tb->connect(chan, ch, it->second.vfo, 0);
+        it->second.chan = ch;
+        tb->unlock();
+    }
+
+    return STATUS_OK;
+}
+
+
+/*! \brief Set VFO channel filter.
+ *  \param vfo_id The ID of the VFO.
+ *  \sa set_filter()
+ */
+receiver::status receiver::set_vfo_filter(int vfo_id, double low, double high, filter_shape shape)
+{
+    std::map<int, vfo_channel>::iterator it = d_vfos.find(vfo_id);
+
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    if ((low >= high) || (abs(high-low) < RX_FILTER_MIN_WIDTH))
+        return STATUS_ERROR;
+
+    it->second.low = low;
+    it->second.high = high;
+    it->second.shape = shape;
+    it->second.vfo->set_filter(low, high, filter_trans_width(low, high, shape));
+
+    return STATUS_OK;
+}
+
+
+/*! \brief Select demodulator of a VFO. */
+receiver::status receiver::set_vfo_demod(int vfo_id, demod rx_demod)
+{
+    std::map<int, vfo_channel>::iterator it = d_vfos.find(vfo_id);
+
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    if ((rx_demod < DEMOD_NONE) || (rx_demod >= DEMOD_NUM))
+        return STATUS_ERROR;
+
+    it->second.rx_demod = rx_demod;
+    it->second.vfo->set_demod(vfo_demod(rx_demod));
+
+    return STATUS_OK;
+}
+
+
+/*! \brief Set squelch level of a VFO in dBFS. */
+receiver::status receiver::set_vfo_sql_level(int vfo_id, double level_db)
+{
+    std::map<int, vfo_channel>::iterator it = d_vfos.find(vfo_id);
+
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    it->second.sql_level = level_db;
+    it->second.vfo->set_sql_level(level_db);
+
+    return STATUS_OK;
+}
+
+
+/*! \brief Set audio gain of a VFO in dB. */
+receiver::status receiver::set_vfo_af_gain(int vfo_id, float gain_db)
+{
+    std::map<int, vfo_channel>::iterator it = d_vfos.find(vfo_id);
+
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    it->second.af_gain = gain_db;
+    it->second.vfo->set_af_gain(gain_db);
+
+    return STATUS_OK;
+}
+
+
+/*! \brief Get signal power of a VFO.
+ *  \sa get_signal_pwr()
+ */
+float receiver::get_vfo_signal_pwr(int vfo_id, bool dbfs)
+{
+    std::map<int, vfo_channel>::iterator it = d_vfos.find(vfo_id);
+
+    if (it == d_vfos.end())
+        return dbfs ? -200.0 : 0.0;
+
+    return it->second.vfo->get_signal_pwr(dbfs);
+}
+
+
+/*! \brief Create the channelizer and connect it to the flow graph.
+ *
+ * The number of channels is rounded to an even number, which is required
+ * by the 2x oversampling filter bank; the channel spacing is therefore only
+ * approximately VFO_CHANNEL_SPACING.
+ *
+ * The caller must hold the flow graph lock.
+ */
+void receiver::connect_channelizer()
+{
+    unsigned int num_chan;
+    unsigned int i;
+
+    num_chan = 2 * (unsigned int) floor(d_bandwidth / (2.0 * VFO_CHANNEL_SPACING) + 0.5);
+    if (num_chan < 2)
+        num_chan = 2;
+
+    chan = make_rx_channelizer(d_bandwidth, num_chan);
+    for (i = 0; i < chan->num_channels(); i++)
+        chan_null.push_back(gr_make_null_sink(sizeof(gr_complex)));
+
+    tb->connect(iq_corr, 0, chan, 0);
+    for (i = 0; i < chan->num_channels(); i++)
+        tb->connect(chan, i, chan_null[i], 0);
+}
+
+
+/*! \brief Remove the channelizer from the flow graph.
+ *
+ * Called when the last VFO has been removed so that we do not
+ * waste CPU on the filter bank when no VFOs are in use.
+ *
+ * The caller must hold the flow graph lock.
+ */
+void receiver::disconnect_channelizer()
+{
+    unsigned int i;
+
+    if (!chan)
+        return;
+
+    tb->disconnect(iq_corr, 0, chan, 0);
+    for (i = 0; i < chan->num_channels(); i++)
+        tb->disconnect(chan, i, chan_null[i], 0);
+
+    chan_null.clear();
+    chan.reset();
+}
+
+
+/*! \brief Create a VFO and connect it between the channelizer and its audio sink.
+ *  \param vc The VFO bookkeeping; the vfo and chan fields are updated.
+ *  \return False if the offset is outside the channelizer bandwidth.
+ *
+ * The VFO is created from scratch using the current channelizer rates and the
+ * settings stored in vc. The caller must hold the flow graph lock.
+ */
+bool receiver::connect_vfo(vfo_channel &vc)
+{
+    double residual;
+
+    vc.chan = chan->channel_index(vc.offset, residual);
+    if (vc.chan < 0)
+        return false;
+
+    vc.vfo = make_rx_vfo(chan->channel_rate(), chan->channel_spacing(), d_audio_rate, residual);
+    vc.vfo->set_demod(vfo_demod(vc.rx_demod));
+    vc.vfo->set_filter(vc.low, vc.high, filter_trans_width(vc.low, vc.high, vc.shape));
+    vc.vfo->set_sql_level(vc.sql_level);
+    vc.vfo->set_af_gain(vc.af_gain);
+
+    tb->connect(chan, vc.chan, vc.vfo, 0);
+    tb->connect(vc.vfo, 0, vc.snk, 0);
+
+    return true;
+}
+
+
+/*! \brief Recreate the channelizer and the VFOs after a sample rate change.
+ *
+ * Both the channelizer and the VFOs are designed for a given input rate, so
+ * they are replaced by new instances and the VFO settings are restored.
+ * VFOs that are outside the new bandwidth are removed.
+ */
+void receiver::rebuild_vfos()
+{
+    std::map<int, vfo_channel>::iterator it;
+
+    if (!chan)
+        return;
+
+    tb->lock();
+
+    for (it = d_vfos.begin(); it != d_vfos.end(); ++it)
+    {
+        tb->disconnect(chan, it->second.chan, it->second.vfo, 0);
+        tb->disconnect(it->second.vfo, 0, it->second.snk, 0);
+    }
+    disconnect_channelizer();
+
+    connect_channelizer();
+
+    it = d_vfos.begin();
+    while (it != d_vfos.end())
+    {
+        if (connect_vfo(it->second))
+            ++it;
+        else
+            d_vfos.erase(it++);
+    }
+
+    if (d_vfos.empty())
+        disconnect_channelizer();
+
+    tb->unlock();
+}
@@ -23,9 +23,7 @@
 
 #include <gr_top_block.h>
 #include <gr_audio_sink.h>
-#include <gr_complex_to_xxx.h>
 #include <gr_multiply_const_ff.h>
-#include <gr_simple_squelch_cc.h>
 #include <gr_file_sink.h>
 #include <gr_file_source.h>
 #include <gr_throttle.h>
@@ -37,14 +35,20 @@
 #include "dsp/correct_iq_cc.h"
 #include "dsp/rx_source_osmosdr.h"
 #include "dsp/rx_noise_blanker_cc.h"
-#include "dsp/rx_filter.h"
 #include "dsp/rx_meter.h"
+#include "dsp/rx_squelch.h"
 #include "dsp/rx_agc_xx.h"
 #include "dsp/rx_demod_fm.h"
+#include "dsp/rx_demod_wfm.h"
 #include "dsp/rx_demod_am.h"
+#include "dsp/rx_demod_ssb.h"
 #include "dsp/rx_fft.h"
 #include "dsp/resampler_ff.h"
 #include "dsp/sniffer_f.h"
+#include "dsp/rx_channelizer.h"
+#include "dsp/rx_vfo.h"
+#include "dsp/rx_decimator.h"
+#include <map>
 
 
 
@@ -76,7 +80,9 @@ public:
         DEMOD_AM   = 1,  /*!< Amplitude modulation. */
         DEMOD_FM   = 2,  /*!< Frequency modulation. */
         DEMOD_SSB  = 3,  /*!< Single Side Band. */
-        DEMOD_NUM  = 4   /*!< Included for convenience. */
+        DEMOD_WFM  = 4,  /*!< Wideband (broadcast) FM. */
+        DEMOD_CW   = 5,  /*!< CW (SSB with BFO). */
+        DEMOD_NUM  = 6   /*!< Included for convenience. */
     };
 
     /*! \brief Filter shape (convenience wrappers for "transition width"). */
@@ -100,6 +106,7 @@ public:
     double get_rf_freq();
 
     status set_rf_sample_rate(double d_sample_rate);
+    double get_rf_sample_rate();
 
     status set_rf_gain(float gain_db);
     status set_rf_gain_mode(int gain_mode);
@@ -116,12 +123,23 @@ public:
     status set_freq_corr(int ppm);
     status set_dc_corr(double dci, double dcq);
     status set_iq_corr(double gain, double phase);
+    status set_iq_corr_auto(bool dc_auto, bool iq_auto);
+    void   get_dc_corr(double &dci, double &dcq);
+    void   get_iq_corr(double &gain, double &phase);
 
 
     float get_signal_pwr(bool dbfs);
-
-    void get_iq_fft_data(std::complex<float>* fftPoints, int &fftsize);
-    void get_audio_fft_data(std::complex<float>* fftPoints, int &fftsize);
+    rx_meter_level get_signal_levels();
+    unsigned int get_signal_history(rx_meter_level *levels, unsigned int max_num,
+                                    unsigned int &pos);
+    void set_signal_window(double seconds);
+
+    void get_iq_fft_data(float* fftPoints, int &fftsize, double &center, double &span);
+    void set_iq_fft_averaging(int mode);
+    void set_iq_fft_size(int fftsize);
+    int  get_iq_fft_size();
+    void set_iq_fft_zoom(double center, double span);
+    void get_audio_fft_data(float* fftPoints, int &fftsize);
 
     /* Noise blanker */
     status set_nb_on(int nbid, bool on);
@@ -144,9 +162,16 @@ public:
     /* FM parameters */
     status set_fm_maxdev(float maxdev_hz);
     status set_fm_deemph(double tau);
+    status set_wfm_stereo(bool enabled);
+    rx_wfm_status get_wfm_status();
 
     /* AM parameters */
     status set_am_dcr(bool enabled);
+    status set_am_detector(int detector);
+
+    /* SSB and CW parameters */
+    status set_sideband(int sideband);
+    status set_cw_pitch(float pitch_hz);
 
     /* Audio parameters */
     status set_af_gain(float gain_db);
@@ -166,16 +191,60 @@ public:
     status stop_sniffer();
     void   get_sniffer_data(float * outbuff, int &num);
 
+    /* additional VFOs */
+    int    add_vfo(double offset_hz, demod rx_demod, const std::string audio_device="");
+    status remove_vfo(int vfo_id);
+    status set_vfo_offset(int vfo_id, double offset_hz);
+    status set_vfo_filter(int vfo_id, double low, double high, filter_shape shape);
+    status set_vfo_demod(int vfo_id, demod rx_demod);
+    status set_vfo_sql_level(int vfo_id, double level_db);
+    status set_vfo_af_gain(int vfo_id, float gain_db);
+    float  get_vfo_signal_pwr(int vfo_id, bool dbfs);
+
+private:
+    static double channel_rate(demod rx_demod);
+    void   set_channel_rate(double rate);
+    double filter_trans_width(double low, double high, filter_shape shape);
+    void   connect_channelizer();
+    void   disconnect_channelizer();
+    void   rebuild_vfos();
+    void   connect_input(gr_basic_block_sptr blk);
+    void   disconnect_input(gr_basic_block_sptr blk);
+    void   update_nb();
+    void   update_iq_fft_zoom();
+    gr_basic_block_sptr audio_output(demod rx_demod);
+    void   connect_audio(demod rx_demod);
+    void   disconnect_audio(demod rx_demod);
+
+    /*! \brief Bookkeeping for one additional VFO. */
+    struct vfo_channel {
+        rx_vfo_sptr       vfo;       /*!< The VFO channel. */
+        audio_sink::sptr  snk;       /*!< Audio sink of this VFO. */
+        int               chan;      /*!< Channelizer output the VFO is connected to. */
+        double            offset;    /*!< Offset from the RF center frequency. */
+        demod             rx_demod;  /*!< Demodulator. */
+        double            low;       /*!< Filter low cut. */
+        double            high;      /*!< Filter high cut. */
+        filter_shape      shape;     /*!< Filter shape. */
+        double            sql_level; /*!< Squelch level in dBFS. */
+        float             af_gain;   /*!< Audio gain in dB. */
+    };
+
+    bool   connect_vfo(vfo_channel &vc);
+
 private:
     bool   d_running;          /*!< Whether receiver is running or not. */
     float  d_bandwidth;        /*!< Receiver bandwidth. */
-    float  d_bandwidth_int;    /*!< Internal bandwidth due to fcd and hardcoded values. FIXME */
+    float  d_bandwidth_int;    /*!< Channel rate, depends on the demodulator. */
     int    d_audio_rate;       /*!< Audio output rate. */
     double d_rf_freq;          /*!< Current RF frequency. */
     double d_filter_offset;    /*!< Current filter offset (tune within passband). */
+    double d_zoom_center;      /*!< Center of the baseband FFT relative to the RF frequency. */
+    double d_zoom_span;        /*!< Requested span of the baseband FFT. */
     bool   d_recording_iq;     /*!< Whether we are recording I/Q data. */
     bool   d_recording_wav;    /*!< Whether we are recording WAV file. */
     bool   d_sniffer_active;   /*!< Only one data decoder allowed. */
+    bool   d_nb_connected;     /*!< Whether the noise blanker is in the flow graph. */
 
     demod  d_demod;          /*!< Current demodulator. */
 
@@ -183,21 +252,23 @@ private:
 
     rx_source_base_sptr       src;       /*!< Real time I/Q source. */
 
-    dc_corr_cc_sptr           dc_corr;   /*!< DC corrector block. */
+    correct_iq_cc_sptr        iq_corr;   /*!< DC and I/Q imbalance corrector block. */
 
     rx_fft_c_sptr             iq_fft;     /*!< Baseband FFT block. */
     rx_fft_f_sptr             audio_fft;  /*!< Audio FFT block. */
     rx_nb_cc_sptr             nb;         /*!< Noise blanker. */
-    gr_freq_xlating_fir_filter_ccf_sptr xlate; /*!< Frequency xlating fir filter to sample down to internally used 96kHz. */
-    rx_filter_sptr            filter;     /*!< Bandpass filter. */
+    rx_decimator_cc_sptr      ddc;        /*!< Tuning, decimation to channel rate and bandpass filter. */
     rx_meter_c_sptr           meter;      /*!< Signal strength. */
     rx_agc_cc_sptr            agc;        /*!< Receiver AGC. */
-    gr_simple_squelch_cc_sptr sql;        /*!< Squelch. */
-    gr_complex_to_real_sptr   demod_ssb;  /*!< SSB demodulator. */
-    rx_demod_fm_sptr          demod_fm;   /*!< FM demodulator. */
+    rx_squelch_cc_sptr        sql;        /*!< Squelch. */
+    rx_demod_ssb_sptr         demod_ssb;  /*!< SSB demodulator. */
+    rx_demod_ssb_sptr         demod_cw;   /*!< CW demodulator. */
+    rx_demod_fm_sptr          demod_fm;   /*!< FM demodulator with audio resampler. */
+    rx_demod_wfm_sptr         demod_wfm;  /*!< Broadcast FM stereo and RDS demodulator. */
     rx_demod_am_sptr          demod_am;   /*!< AM demodulator. */
-    resampler_ff_sptr         audio_rr;   /*!< Audio resampler. */
-    gr_multiply_const_ff_sptr audio_gain; /*!< Audio gain block. */
+    resampler_ff_sptr         audio_rr;   /*!< Audio resampler (AM and SSB). */
+    gr_multiply_const_ff_sptr audio_gain; /*!< Audio gain block, left channel. */
+    gr_multiply_const_ff_sptr audio_gain_r; /*!< Audio gain block, right channel. */
 
     gr_file_sink_sptr         iq_sink;    /*!< I/Q file sink. */
     gr_file_source_sptr       iq_src;     /*!< I/Q file source. */
@@ -210,6 +281,11 @@ private:
 
     audio_sink::sptr          audio_snk;  /*!< Audio sink. */
 
+    rx_channelizer_sptr       chan;       /*!< Channelizer for additional VFOs (created on demand). */
+    std::vector<gr_null_sink_sptr> chan_null; /*!< Null sinks terminating the channelizer outputs. */
+    std::map<int, vfo_channel> d_vfos;    /*!< Additional VFOs indexed by ID. */
+    int                       d_next_vfo; /*!< ID of the next VFO. */
+
 protected:
 
 